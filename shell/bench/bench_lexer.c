@@ -0,0 +1,97 @@
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+// ############## LLM Generated Code Begins ##############
+// Lexer throughput on very long lines: each SIMD scanner against the
+// scalar one and against the old strtok-based split
+
+#define LINE_SIZE (4 << 20)
+#define ROUNDS 20
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Build a line of words with the given average length; every eighth word
+// is quoted so the quote paths are exercised too
+static char* make_line(size_t size, int word_len) {
+    char* line = malloc(size + 1);
+    size_t n = 0;
+    unsigned seed = 12345;
+    int words = 0;
+
+    while (n + word_len + 8 < size) {
+        int len = word_len / 2 + (int)((seed = seed * 1103515245 + 12345) >> 16) % word_len;
+        bool quoted = (++words % 8) == 0;
+        if (quoted) line[n++] = '"';
+        for (int i = 0; i < len; i++) {
+            line[n++] = 'a' + (i + words) % 26;
+        }
+        if (quoted) line[n++] = '"';
+        line[n++] = (words % 50 == 0) ? '|' : ' ';
+    }
+    line[n] = '\0';
+    return line;
+}
+
+static void split_strtok(char* input, size_t* count) {
+    *count = 0;
+    for (char* t = strtok(input, " \t\n"); t != NULL; t = strtok(NULL, " \t\n")) {
+        (*count)++;
+    }
+}
+
+static void run(const char* label, const char* line, size_t len) {
+    token_list_t tokens = {NULL, 0, 0};
+    lex_line(line, len, &tokens);
+
+    double start = now_seconds();
+    for (int r = 0; r < ROUNDS; r++) {
+        lex_line(line, len, &tokens);
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("  %-8s %8.1f MB/s  %d tokens\n", label,
+           (double)len * ROUNDS / elapsed / 1e6, tokens.count);
+    free_tokens(&tokens);
+}
+
+int main() {
+    const int word_lens[] = {4, 16, 64, 256};
+    const char* names[] = {"scalar", "sse2", "avx2"};
+
+    for (size_t w = 0; w < sizeof(word_lens) / sizeof(word_lens[0]); w++) {
+        char* line = make_line(LINE_SIZE, word_lens[w]);
+        size_t len = strlen(line);
+        printf("words of ~%d bytes, %zu byte line\n", word_lens[w], len);
+
+        for (int impl = LEXER_SCALAR; impl <= LEXER_AVX2; impl++) {
+            if (lexer_set_impl((lexer_impl_t)impl)) {
+                run(names[impl], line, len);
+            } else {
+                printf("  %-8s unsupported\n", names[impl]);
+            }
+        }
+
+        // The old split copied the line and ran strtok over it
+        char* copy = malloc(len + 1);
+        size_t count = 0;
+        double start = now_seconds();
+        for (int r = 0; r < ROUNDS; r++) {
+            memcpy(copy, line, len + 1);
+            split_strtok(copy, &count);
+        }
+        double elapsed = now_seconds() - start;
+        printf("  %-8s %8.1f MB/s  %zu words (no quoting)\n", "strtok",
+               (double)len * ROUNDS / elapsed / 1e6, count);
+
+        free(copy);
+        free(line);
+    }
+    return 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,545 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+// ############## LLM Generated Code Begins ##############
+// End-to-end latency of the interactive shell: shell.out runs on a
+// pseudo-terminal and scripted sessions time how long it takes for the
+// prompt to come back after Enter, Ctrl-Z, Ctrl-C, fg and bg, and how
+// long the shell leaves a thousand finished background jobs unreaped.
+//
+//   bench_pty.out [-n ITERATIONS] [-j JOBS] [SHELL]
+
+#define OUT_SIZE (1 << 20)
+#define TIMEOUT 10.0
+#define WARMUP 5
+
+static int master = -1;
+static pid_t shell_pid;
+static pid_t shell_pgrp;
+static char prompt[512];
+static char out[OUT_SIZE];
+static size_t out_len;
+static double first_byte;
+static char home[] = "/tmp/bench_pty.XXXXXX";
+static char fifo[PATH_MAX];
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Remove the shell's home, first releasing any jobs still blocked on the
+// FIFO
+static void remove_home() {
+    if (fifo[0] != '\0') {
+        int fd = open(fifo, O_WRONLY | O_NONBLOCK);
+        if (fd != -1) {
+            close(fd);
+        }
+        unlink(fifo);
+    }
+    char log_path[PATH_MAX];
+    snprintf(log_path, sizeof(log_path), "%s/.shell_log", home);
+    unlink(log_path);
+    rmdir(home);
+}
+
+static void fail(const char* what) {
+    fprintf(stderr, "bench_pty: %s\n", what);
+    if (out_len > 0) {
+        size_t tail = out_len > 512 ? 512 : out_len;
+        fprintf(stderr, "last output:\n%.*s\n", (int)tail, out + out_len - tail);
+    }
+    if (shell_pgrp > 0) {
+        kill(-shell_pgrp, SIGKILL);
+    }
+    if (shell_pid > 0) {
+        kill(shell_pid, SIGKILL);
+    }
+    remove_home();
+    exit(1);
+}
+
+// Latencies of one step, in seconds
+typedef struct {
+    const char* name;
+    double* samples;
+    int count;
+    int cap;
+} series_t;
+
+static void add_sample(series_t* s, double value) {
+    if (s->count == s->cap) {
+        s->cap = s->cap ? s->cap * 2 : 64;
+        s->samples = realloc(s->samples, s->cap * sizeof(double));
+    }
+    s->samples[s->count++] = value;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const series_t* s, double p) {
+    int i = (int)(p * (s->count - 1) + 0.5);
+    return s->samples[i];
+}
+
+static void report(series_t* s) {
+    if (s->count == 0) {
+        return;
+    }
+    qsort(s->samples, s->count, sizeof(double), compare_doubles);
+    double sum = 0;
+    for (int i = 0; i < s->count; i++) {
+        sum += s->samples[i];
+    }
+    printf("%-18s n=%-5d mean %8.1f  p50 %8.1f  p90 %8.1f  p99 %8.1f  max %8.1f us\n",
+           s->name, s->count, sum / s->count * 1e6, percentile(s, 0.5) * 1e6,
+           percentile(s, 0.9) * 1e6, percentile(s, 0.99) * 1e6,
+           s->samples[s->count - 1] * 1e6);
+    free(s->samples);
+    s->samples = NULL;
+    s->count = s->cap = 0;
+}
+
+static void send_input(const char* text) {
+    size_t len = strlen(text);
+    if (write(master, text, len) != (ssize_t)len) {
+        fail("write to terminal failed");
+    }
+    out_len = 0;
+    first_byte = 0;
+}
+
+// Read whatever the shell wrote, up to deadline; returns false on timeout
+static bool read_output(double deadline) {
+    double left = deadline - now_seconds();
+    if (left <= 0) {
+        return false;
+    }
+    struct pollfd pfd = {master, POLLIN, 0};
+    int ready = poll(&pfd, 1, (int)(left * 1000) + 1);
+    if (ready <= 0) {
+        return ready == 0 ? false : errno == EINTR;
+    }
+    // Keep the tail when a flood of output fills the buffer
+    if (out_len > OUT_SIZE - 4096) {
+        memmove(out, out + out_len - 1024, 1024);
+        out_len = 1024;
+    }
+    ssize_t n = read(master, out + out_len, OUT_SIZE - 1 - out_len);
+    if (n <= 0) {
+        fail("shell closed the terminal");
+    }
+    if (out_len == 0 && first_byte == 0) {
+        first_byte = now_seconds();
+    }
+    out_len += n;
+    out[out_len] = '\0';
+    return true;
+}
+
+// Wait for the prompt and return the time it was complete
+static double expect_prompt() {
+    double deadline = now_seconds() + TIMEOUT;
+    while (memmem(out, out_len, prompt, strlen(prompt)) == NULL) {
+        if (!read_output(deadline)) {
+            fail("timed out waiting for the prompt");
+        }
+    }
+    return now_seconds();
+}
+
+// Wait until a job holds the terminal and has exec'd name; returns its pid
+static pid_t expect_foreground(const char* name) {
+    double deadline = now_seconds() + TIMEOUT;
+    while (now_seconds() < deadline) {
+        pid_t pgrp = tcgetpgrp(master);
+        if (pgrp > 0 && pgrp != shell_pgrp) {
+            char path[64], comm[32] = "";
+            snprintf(path, sizeof(path), "/proc/%d/comm", (int)pgrp);
+            FILE* f = fopen(path, "r");
+            if (f != NULL) {
+                if (fgets(comm, sizeof(comm), f) == NULL) {
+                    comm[0] = '\0';
+                }
+                fclose(f);
+            }
+            comm[strcspn(comm, "\n")] = '\0';
+            if (strcmp(comm, name) == 0) {
+                return pgrp;
+            }
+        }
+        // Drain output so the shell never blocks on a full terminal
+        struct pollfd pfd = {master, POLLIN, 0};
+        if (poll(&pfd, 1, 0) > 0) {
+            read_output(deadline);
+        }
+        usleep(20);
+    }
+    fail("timed out waiting for a foreground job");
+    return -1;
+}
+
+// The prompt shell.out prints in its home directory
+static void build_prompt() {
+    struct passwd* pw = getpwuid(getuid());
+    char host[HOST_NAME_MAX + 1];
+    gethostname(host, sizeof(host));
+    host[HOST_NAME_MAX] = '\0';
+    snprintf(prompt, sizeof(prompt), "<%s@%s:~> ", pw ? pw->pw_name : "unknown", host);
+}
+
+// Start the shell on a new terminal with echo off. Like a terminal
+// emulator, a session leader owns the terminal and runs the shell as its
+// child, which can then move to a process group of its own.
+static void start_shell(const char* shell) {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master == -1 || grantpt(master) == -1 || unlockpt(master) == -1) {
+        fail("cannot open a pseudo-terminal");
+    }
+    // Kept open here too: with no slave open a read of the master fails,
+    // which would race with the child opening it
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave == -1) {
+        fail("cannot open the terminal");
+    }
+
+    shell_pid = fork();
+    if (shell_pid == -1) {
+        fail("fork failed");
+    }
+    if (shell_pid == 0) {
+        setsid();
+        ioctl(slave, TIOCSCTTY, 0);
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        tio.c_lflag &= ~ECHO;
+        tcsetattr(slave, TCSANOW, &tio);
+        dup2(slave, 0);
+        dup2(slave, 1);
+        dup2(slave, 2);
+        close(slave);
+        close(master);
+        if (chdir(home) == -1) {
+            _exit(127);
+        }
+        // Nothing inherited from the caller should change what is measured
+        unsetenv("EVENTLOG");
+        unsetenv("SHELL_TRACE");
+        setenv("TERM", "dumb", 1);
+        pid_t pid = fork();
+        if (pid == 0) {
+            execl(shell, shell, (char*)NULL);
+            _exit(127);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        _exit(WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+    }
+    close(slave);
+    expect_prompt();
+    // The shell took the terminal for its own group at startup
+    shell_pgrp = tcgetpgrp(master);
+}
+
+// Enter on an empty line, an assignment and a program, one at a time
+static void bench_enter(int iterations) {
+    const char* lines[] = {"\n", "x=1\n", "/bin/true\n"};
+    const char* names[] = {"enter/empty", "enter/assign", "enter/program"};
+    for (int l = 0; l < 3; l++) {
+        series_t prompt_lat = {names[l], NULL, 0, 0};
+        double total = 0;
+        for (int i = -WARMUP; i < iterations; i++) {
+            double start = now_seconds();
+            send_input(lines[l]);
+            double done = expect_prompt();
+            if (i >= 0) {
+                add_sample(&prompt_lat, done - start);
+                total += done - start;
+            }
+        }
+        report(&prompt_lat);
+        printf("%-18s %.0f commands/s\n", "", iterations / total);
+    }
+}
+
+// Output arrives before the prompt: time to the first byte and to the
+// prompt for a command that prints
+static void bench_output(int iterations) {
+    series_t first = {"output/first-byte", NULL, 0, 0};
+    series_t done = {"output/prompt", NULL, 0, 0};
+    for (int i = -WARMUP; i < iterations; i++) {
+        double start = now_seconds();
+        send_input("echo hello\n");
+        double end = expect_prompt();
+        if (i >= 0) {
+            add_sample(&first, first_byte - start);
+            add_sample(&done, end - start);
+        }
+    }
+    report(&first);
+    report(&done);
+}
+
+// Start a foreground job, stop it, resume it in the background, bring it
+// back and interrupt it
+static void bench_job_control(int iterations) {
+    series_t spawn = {"jobs/spawn", NULL, 0, 0};
+    series_t ctrl_z = {"jobs/ctrl-z", NULL, 0, 0};
+    series_t bg = {"jobs/bg", NULL, 0, 0};
+    series_t fg = {"jobs/fg", NULL, 0, 0};
+    series_t ctrl_c = {"jobs/ctrl-c", NULL, 0, 0};
+    for (int i = -WARMUP; i < iterations; i++) {
+        double start = now_seconds();
+        send_input("sleep 1000\n");
+        expect_foreground("sleep");
+        double t_spawn = now_seconds() - start;
+
+        start = now_seconds();
+        send_input("\x1a");
+        double t_stop = expect_prompt() - start;
+
+        start = now_seconds();
+        send_input("bg\n");
+        double t_bg = expect_prompt() - start;
+
+        start = now_seconds();
+        send_input("fg\n");
+        expect_foreground("sleep");
+        double t_fg = now_seconds() - start;
+
+        start = now_seconds();
+        send_input("\x03");
+        double t_int = expect_prompt() - start;
+
+        if (i >= 0) {
+            add_sample(&spawn, t_spawn);
+            add_sample(&ctrl_z, t_stop);
+            add_sample(&bg, t_bg);
+            add_sample(&fg, t_fg);
+            add_sample(&ctrl_c, t_int);
+        }
+    }
+    report(&spawn);
+    report(&ctrl_z);
+    report(&bg);
+    report(&fg);
+    report(&ctrl_c);
+}
+
+// Check whether a process or one of its descendants has path open
+static bool holds_file(pid_t pid, const char* path) {
+    char dir_path[64];
+    snprintf(dir_path, sizeof(dir_path), "/proc/%d/fd", (int)pid);
+    DIR* dir = opendir(dir_path);
+    if (dir == NULL) {
+        return false;
+    }
+    bool found = false;
+    struct dirent* entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        char link[PATH_MAX + 80], target[PATH_MAX];
+        snprintf(link, sizeof(link), "%s/%s", dir_path, entry->d_name);
+        ssize_t n = readlink(link, target, sizeof(target) - 1);
+        if (n > 0) {
+            target[n] = '\0';
+            found = strcmp(target, path) == 0;
+        }
+    }
+    closedir(dir);
+    if (found) {
+        return true;
+    }
+
+    // A background job is a subshell that runs its command as a child
+    char children_path[80];
+    snprintf(children_path, sizeof(children_path), "/proc/%d/task/%d/children", (int)pid, (int)pid);
+    FILE* f = fopen(children_path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    int child;
+    while (!found && fscanf(f, "%d", &child) == 1) {
+        found = holds_file(child, path);
+    }
+    fclose(f);
+    return found;
+}
+
+// Start that many background jobs blocked on a FIFO, release them all at once
+// and time, for each, from its exit to the shell reaping it. A zombie
+// still answers kill(pid, 0); a reaped process does not.
+static void bench_reap(int jobs) {
+    snprintf(fifo, sizeof(fifo), "%s/release", home);
+    if (mkfifo(fifo, 0600) == -1) {
+        fail("mkfifo failed");
+    }
+    // Held open so the jobs' opens never block; closing it is the release
+    int hold = open(fifo, O_RDWR);
+
+    series_t launch = {"reap/launch &", NULL, 0, 0};
+    series_t reap = {"reap/exit-to-reap", NULL, 0, 0};
+    pid_t* pids = calloc(jobs, sizeof(pid_t));
+    int* pidfds = calloc(jobs, sizeof(int));
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    char line[PATH_MAX + 16];
+    snprintf(line, sizeof(line), "cat %s &\n", fifo);
+
+    for (int i = 0; i < jobs; i++) {
+        double start = now_seconds();
+        send_input(line);
+        double done = expect_prompt();
+        add_sample(&launch, done - start);
+        // The shell announces each job as "[id] pid"
+        int id, pid;
+        char* p = memchr(out, '[', out_len);
+        if (p == NULL || sscanf(p, "[%d] %d", &id, &pid) != 2) {
+            fail("no job announcement");
+        }
+        pids[i] = pid;
+        pidfds[i] = (int)syscall(SYS_pidfd_open, pid, 0);
+        if (pidfds[i] == -1) {
+            fail("pidfd_open failed");
+        }
+        struct epoll_event ev = {EPOLLIN, {.u32 = (uint32_t)i}};
+        epoll_ctl(epfd, EPOLL_CTL_ADD, pidfds[i], &ev);
+    }
+    report(&launch);
+
+    // A job that opens the FIFO after the release would block for good
+    double deadline = now_seconds() + TIMEOUT;
+    for (int i = 0; i < jobs; i++) {
+        while (!holds_file(pids[i], fifo)) {
+            if (now_seconds() > deadline) {
+                fail("jobs never opened the FIFO");
+            }
+            usleep(100);
+        }
+    }
+
+    double* exited = calloc(jobs, sizeof(double));
+    // Jobs seen to exit but not yet reaped, by index
+    int* zombies = calloc(jobs, sizeof(int));
+    int zombie_count = 0, reaped = 0;
+    deadline = now_seconds() + TIMEOUT;
+    double released = now_seconds();
+    close(hold);
+    while (reaped < jobs && now_seconds() < deadline) {
+        struct epoll_event events[256];
+        int n = epoll_wait(epfd, events, 256, zombie_count > 0 ? 0 : 100);
+        double now = now_seconds();
+        for (int e = 0; e < n; e++) {
+            int i = (int)events[e].data.u32;
+            exited[i] = now;
+            epoll_ctl(epfd, EPOLL_CTL_DEL, pidfds[i], NULL);
+            zombies[zombie_count++] = i;
+        }
+        for (int z = 0; z < zombie_count; z++) {
+            int i = zombies[z];
+            if (kill(pids[i], 0) == -1 && errno == ESRCH) {
+                add_sample(&reap, now_seconds() - exited[i]);
+                zombies[z--] = zombies[--zombie_count];
+                reaped++;
+            }
+        }
+        if (zombie_count > 0) {
+            usleep(50);
+        }
+    }
+    printf("%-18s %d of %d jobs reaped %.1f ms after release\n", "",
+           reaped, jobs, (now_seconds() - released) * 1e3);
+    report(&reap);
+
+    // The completions are reported at the next prompt
+    double start = now_seconds();
+    send_input("\n");
+    double done = expect_prompt();
+    printf("%-18s completion notices printed in %.1f ms\n", "", (done - start) * 1e3);
+
+    for (int i = 0; i < jobs; i++) {
+        close(pidfds[i]);
+    }
+    close(epfd);
+    free(zombies);
+    free(exited);
+    free(pidfds);
+    free(pids);
+}
+
+int main(int argc, char** argv) {
+    int iterations = 200;
+    int jobs = 1000;
+    const char* shell = "./shell.out";
+    int opt;
+    while ((opt = getopt(argc, argv, "n:j:")) != -1) {
+        if (opt == 'n') {
+            iterations = atoi(optarg);
+        } else if (opt == 'j') {
+            jobs = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-n ITERATIONS] [-j JOBS] [SHELL]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (optind < argc) {
+        shell = argv[optind];
+    }
+    char shell_path[PATH_MAX];
+    if (realpath(shell, shell_path) == NULL || access(shell_path, X_OK) == -1) {
+        fprintf(stderr, "bench_pty: %s: not executable\n", shell);
+        return 2;
+    }
+    if (iterations < 1 || jobs < 1) {
+        fprintf(stderr, "bench_pty: counts must be positive\n");
+        return 2;
+    }
+
+    // Every job costs the shell and us a pidfd
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    if (mkdtemp(home) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    build_prompt();
+    start_shell(shell_path);
+
+    bench_enter(iterations);
+    bench_output(iterations);
+    bench_job_control(iterations / 4 > 0 ? iterations / 4 : 1);
+    bench_reap(jobs);
+
+    kill(-shell_pgrp, SIGTERM);
+    waitpid(shell_pid, NULL, 0);
+    close(master);
+    remove_home();
+    return 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,359 @@
+#define _GNU_SOURCE
+#include "parser.h"
+#include "executor.h"
+#include "expand.h"
+#include "utils.h"
+#include "jobs.h"
+#include "intrinsics.h"
+#include "variables.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+// ############## LLM Generated Code Begins ##############
+// ns/op of the shell's hot internals: parsing, path formatting, the job
+// table, the command log and command substitution capture. Run with a name filter to measure only the
+// cases whose names contain it, e.g. bench_shell.out jobs
+
+#define REPS 7
+#define WARMUP_REPS 2
+// Each rep runs long enough to swamp the clock's own cost
+#define REP_SECONDS 0.01
+#define LINES 2048
+
+typedef void (*op_fn)(long i);
+
+static const char* filter = NULL;
+static char* lines[LINES];
+static char home[] = "/tmp/bench_shell.XXXXXX";
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static bool selected(const char* name) {
+    return filter == NULL || strstr(name, filter) != NULL;
+}
+
+static void report(const char* name, double* ns, int reps, long iters) {
+    qsort(ns, reps, sizeof(double), compare_doubles);
+    double median = ns[reps / 2];
+    printf("%-32s %10.1f ns/op  min %10.1f  spread %5.1f%%  (%ld x %d)\n",
+           name, median, ns[0], median > 0 ? (ns[reps - 1] - ns[0]) / median * 100 : 0,
+           iters, reps);
+}
+
+static double run_op(op_fn op, long iters) {
+    double start = now_seconds();
+    for (long i = 0; i < iters; i++) {
+        op(i);
+    }
+    return now_seconds() - start;
+}
+
+// Double the iteration count until one rep takes REP_SECONDS, warm up,
+// then report the median of REPS reps
+static void measure(const char* name, op_fn op) {
+    if (!selected(name)) {
+        return;
+    }
+    long iters = 1;
+    while (run_op(op, iters) < REP_SECONDS && iters < (1L << 30)) {
+        iters *= 2;
+    }
+    for (int r = 0; r < WARMUP_REPS; r++) {
+        run_op(op, iters);
+    }
+    double ns[REPS];
+    for (int r = 0; r < REPS; r++) {
+        ns[r] = run_op(op, iters) * 1e9 / iters;
+    }
+    report(name, ns, REPS, iters);
+}
+
+// Keep the scheduler from migrating us between runs
+static void pin_cpu() {
+    int cpu = sched_getcpu();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu < 0 ? 0 : cpu, &set);
+    if (sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity");
+        return;
+    }
+    printf("pinned to cpu %d\n", cpu < 0 ? 0 : cpu);
+}
+
+// Parsing
+
+static const char* cached_line = "cat file.txt | grep -v foo > out.txt && echo \"done $HOME\" &";
+
+static void op_parse_cached(long i) {
+    parse_input(cached_line);
+}
+
+// More distinct lines than the parse cache holds, so every lookup misses
+static void op_parse_uncached(long i) {
+    parse_input(lines[i % LINES]);
+}
+
+static void op_split_command(long i) {
+    char buf[256];
+    char* argv[64];
+    int argc;
+    strcpy(buf, lines[i % LINES]);
+    split_command(buf, argv, &argc);
+}
+
+// Paths
+
+static void op_format_path(long i) {
+    free(format_path("/home/user/projects/shell/src/deeply/nested/dir", "/home/user"));
+}
+
+static void op_format_path_outside(long i) {
+    free(format_path("/usr/local/share/doc", "/home/user"));
+}
+
+static void op_is_subdirectory(long i) {
+    is_subdirectory("/home/user/projects/shell/src", "/home/user");
+}
+
+// Job table
+
+static void op_add_remove_job(long i) {
+    int id = add_job(0, "sleep 100", false);
+    remove_job(find_job_by_id(id));
+}
+
+static int table_size;
+
+static void op_find_job_by_pid(long i) {
+    // Spread the lookups over the table, misses included
+    find_job_by_pid(4000000 + (pid_t)(i % (table_size + 1)));
+}
+
+static void op_check_jobs(long i) {
+    check_jobs();
+}
+
+// Fill the table with n jobs under pids no child of ours holds, so
+// check_jobs walks them all without reaping any
+static void fill_jobs(int n) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].job_id != 0) {
+            remove_job(&jobs[i]);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        int id = add_job(0, "sleep 100", false);
+        job_t* job = find_job_by_id(id);
+        job->pid = 4000000 + i;
+        job->pgid = job->pid;
+    }
+    table_size = n;
+}
+
+// Command log
+
+static void write_log(int entries) {
+    char path[sizeof(home) + 16];
+    snprintf(path, sizeof(path), "%s/.shell_log", home);
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        perror("fopen");
+        exit(1);
+    }
+    for (int i = 0; i < entries; i++) {
+        fprintf(f, "echo entry %d\n", i);
+    }
+    fclose(f);
+}
+
+static void op_read_log(long i) {
+    int count;
+    char** entries = read_log_entries(&count);
+    for (int j = 0; j < count; j++) {
+        free(entries[j]);
+    }
+    free(entries);
+}
+
+// Each add grows the log, so it is reset to the given size before every
+// call and only the call itself is timed
+static void measure_add_log(const char* name, int entries) {
+    if (!selected(name)) {
+        return;
+    }
+    const long iters = 200;
+    double ns[REPS];
+    for (int r = -WARMUP_REPS; r < REPS; r++) {
+        double total = 0;
+        for (long i = 0; i < iters; i++) {
+            write_log(entries);
+            double start = now_seconds();
+            add_log_entry(lines[i % LINES]);
+            total += now_seconds() - start;
+        }
+        if (r >= 0) {
+            ns[r] = total * 1e9 / iters;
+        }
+    }
+    report(name, ns, REPS, iters);
+}
+
+// Command substitution: $(cat file) captured through a pipe, against the
+// temp-file baseline of redirecting the output and reading it back
+
+#define CAPTURE_BYTES (1 << 20)
+
+static char capture_cmd[sizeof(home) + 32];
+static char tempfile_cmd[2 * sizeof(home) + 48];
+static char tempfile_path[sizeof(home) + 16];
+
+static void op_capture_pipe(long i) {
+    capture_buf_t buf = {NULL, 0, 0};
+    capture_command(capture_cmd, &buf);
+    free(buf.data);
+}
+
+static void op_capture_tempfile(long i) {
+    capture_buf_t buf = {NULL, 0, 0};
+    execute_command(tempfile_cmd);
+    int fd = open(tempfile_path, O_RDONLY);
+    if (fd == -1) {
+        perror("open");
+        exit(1);
+    }
+    ssize_t n;
+    do {
+        if (!capture_reserve(&buf, 65536)) {
+            exit(1);
+        }
+        n = read(fd, buf.data + buf.len, buf.cap - buf.len - 1);
+        if (n > 0) {
+            buf.len += n;
+        }
+    } while (n > 0);
+    close(fd);
+    free(buf.data);
+}
+
+// Write the captured file, of size bytes, and the commands reading it
+static void write_capture_data(size_t size) {
+    char data_path[sizeof(home) + 16];
+    snprintf(data_path, sizeof(data_path), "%s/capture", home);
+    FILE* f = fopen(data_path, "w");
+    if (f == NULL) {
+        perror("fopen");
+        exit(1);
+    }
+    for (size_t n = 0; n < size; n += 64) {
+        fprintf(f, "%.*s\n", (int)(size - n < 64 ? size - n - 1 : 63),
+                "capture capture capture capture capture capture capture capture");
+    }
+    fclose(f);
+    snprintf(tempfile_path, sizeof(tempfile_path), "%s/capture.out", home);
+    snprintf(capture_cmd, sizeof(capture_cmd), "cat %s", data_path);
+    snprintf(tempfile_cmd, sizeof(tempfile_cmd), "cat %s > %s", data_path, tempfile_path);
+}
+
+static void make_lines() {
+    static const char* words[] = {"ls", "-la", "grep", "foo", "src/*.c", "|", "wc", "-l",
+                                  ">", "out.txt", "echo", "\"a b\"", "&&", "cat", "sort", "-u"};
+    unsigned seed = 12345;
+    for (int i = 0; i < LINES; i++) {
+        char buf[256];
+        // A unique leading word, so no two lines share a cache entry
+        int n = snprintf(buf, sizeof(buf), "cmd%d", i);
+        int count = 4 + i % 8;
+        bool operand = true;
+        for (int w = 0; w < count; w++) {
+            seed = seed * 1103515245 + 12345;
+            const char* word = words[(seed >> 16) % 16];
+            bool op = strcmp(word, "|") == 0 || strcmp(word, ">") == 0 || strcmp(word, "&&") == 0;
+            // Keep the line valid: no two operators in a row, none last
+            if (op && (!operand || w == count - 1)) {
+                word = "arg";
+                op = false;
+            }
+            n += snprintf(buf + n, sizeof(buf) - n, " %s", word);
+            operand = !op;
+        }
+        lines[i] = strdup(buf);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        filter = argv[1];
+    }
+    if (mkdtemp(home) == NULL) {
+        perror("mkdtemp");
+        return 1;
+    }
+    set_shell_home(home);
+    init_variables();
+    init_jobs();
+    pin_cpu();
+    make_lines();
+
+    measure("parse_input/cached", op_parse_cached);
+    measure("parse_input/uncached", op_parse_uncached);
+    measure("split_command", op_split_command);
+    measure("format_path/inside_home", op_format_path);
+    measure("format_path/outside_home", op_format_path_outside);
+    measure("is_subdirectory", op_is_subdirectory);
+
+    measure("jobs/add_remove", op_add_remove_job);
+    const int sizes[] = {16, 128, 512};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        char name[64];
+        fill_jobs(sizes[s]);
+        snprintf(name, sizeof(name), "jobs/find_job_by_pid/%d", sizes[s]);
+        measure(name, op_find_job_by_pid);
+        snprintf(name, sizeof(name), "jobs/check_jobs/%d", sizes[s]);
+        measure(name, op_check_jobs);
+    }
+    fill_jobs(0);
+
+    const int entries[] = {0, 8, 15};
+    for (size_t e = 0; e < sizeof(entries) / sizeof(entries[0]); e++) {
+        char name[64];
+        write_log(entries[e]);
+        snprintf(name, sizeof(name), "log/read_log_entries/%d", entries[e]);
+        measure(name, op_read_log);
+        snprintf(name, sizeof(name), "log/add_log_entry/%d", entries[e]);
+        measure_add_log(name, entries[e]);
+    }
+
+    const size_t capture_sizes[] = {64, CAPTURE_BYTES};
+    for (size_t c = 0; c < sizeof(capture_sizes) / sizeof(capture_sizes[0]); c++) {
+        char name[64];
+        write_capture_data(capture_sizes[c]);
+        snprintf(name, sizeof(name), "capture/pipe/%zu", capture_sizes[c]);
+        measure(name, op_capture_pipe);
+        snprintf(name, sizeof(name), "capture/tempfile/%zu", capture_sizes[c]);
+        measure(name, op_capture_tempfile);
+    }
+
+    char path[sizeof(home) + 16];
+    snprintf(path, sizeof(path), "%s/.shell_log", home);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/capture", home);
+    unlink(path);
+    unlink(tempfile_path);
+    rmdir(home);
+    return 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
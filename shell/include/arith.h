@@ -0,0 +1,12 @@
+#ifndef ARITH_H
+#define ARITH_H
+
+#include <stdbool.h>
+
+// Evaluate the text of $((...)) with C integer semantics: precedence,
+// ?:, short-circuit && and ||, and assignments (=, +=, ++, ...) to shell
+// variables. Prints a message and returns false on a syntax error or
+// division by zero.
+bool eval_arith(const char* expr, long long* result);
+
+#endif
\ No newline at end of file
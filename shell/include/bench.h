@@ -0,0 +1,10 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdbool.h>
+
+// bench [-n RUNS] [-w WARMUP] [-f text|csv|json] command...
+// bench [-n RUNS] [-w WARMUP] [-f text|csv|json] --compare COMMAND COMMAND
+bool bench_command(int argc, char** argv);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef CONDITION_H
+#define CONDITION_H
+
+#include <stdbool.h>
+
+// test EXPR and [ EXPR ]: succeed when the expression is true
+bool test_command(int argc, char** argv);
+
+// true, : and false
+bool true_command(int argc, char** argv);
+bool false_command(int argc, char** argv);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include <sys/resource.h>
+#include "jobs.h"
+
+// Job lifecycle events, one JSON object per line, written to the file
+// named by $EVENTLOG or to a stream socket given as unix:PATH. The file
+// is rotated to PATH.1 once it would grow past $EVENTLOG_SIZE (10M by
+// default). Events are batched in memory and written from the timer
+// loop, so logging never waits on a slow reader.
+
+// Record spawn, stop, continue, fg or bg for a job
+void log_job_event(const char* event, const job_t* job);
+
+// Record that a job exited with the given wait status and usage
+void log_job_exit(const job_t* job, int status, const struct rusage* usage);
+
+// Write out the pending events now
+void flush_event_log();
+
+// Seconds since the epoch; safe to call from a signal handler
+double event_time();
+
+#endif
\ No newline at end of file
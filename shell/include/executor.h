@@ -3,8 +3,38 @@
 #define EXECUTOR_H
 
 #include <stdbool.h>
+#include <sys/types.h>
+#include <signal.h>
+#include "jobs.h"
 
+// Parse and run a command line or script
 bool execute_command(const char* command);
-bool execute_pipeline(char* command);
+
+// Run one pipeline in the current process; returns its exit status
+int execute_pipeline(char* command);
+
+// Run one pipeline as a foreground or background job; intrinsics and
+// assignments without pipes run in the shell itself
+int run_foreground(char* command);
+int run_background(char* command);
+
+// Fork a job's process in its own process group with the job's priority
+// and CPU set; background jobs read stdin from /dev/null
+pid_t spawn_job(const char* command, const job_t* job, bool foreground);
+
+// Fork and exec argv as a foreground job labelled command. path is the
+// resolved program, or NULL to search PATH in the child.
+int run_argv_foreground(const char* command, char** argv, const char* path);
+
+// Keep the SIGCHLD handler from reaping a foreground child, and its
+// status and usage with it, before the shell waits for it
+void block_sigchld(sigset_t* old_mask);
+
+// Flush output and terminate a forked child without touching stdin
+__attribute__((noreturn)) void child_exit(int status);
+
+// Exit status of the last command ($?)
+int get_last_status();
+void set_last_status(int status);
 
 #endif
\ No newline at end of file
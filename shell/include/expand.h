@@ -0,0 +1,75 @@
+#ifndef EXPAND_H
+#define EXPAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "lexer.h"
+#include "wildcard.h"
+
+// Growable byte buffer used to capture command output in memory
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} capture_buf_t;
+
+// Make sure at least extra bytes are free at the end of the buffer
+bool capture_reserve(capture_buf_t* buf, size_t extra);
+
+// Append raw bytes to buf, keeping room for a terminating NUL
+bool capture_append(capture_buf_t* buf, const char* src, size_t n);
+
+// Run a command and append its standard output to buf
+bool capture_command(const char* command, capture_buf_t* buf);
+
+// Exit status of the last command substitution, or -1 if none ran since
+// the last call. A line made only of assignments exits with it.
+int take_substitution_status();
+
+// NUL-terminated strings stored back to back in one buffer
+struct word_list {
+    capture_buf_t text;
+    size_t* offsets;
+    size_t count;
+    size_t cap;
+};
+
+bool word_list_add(word_list_t* list, const char* word, size_t len);
+void free_word_list(word_list_t* list);
+
+typedef struct {
+    token_type_t type;
+    char* target;
+} redirection_t;
+
+// One simple command after expansion
+typedef struct {
+    char** argv;              // NULL-terminated, points into words
+    int argc;
+    size_t argv_cap;
+    int assignments;          // Leading NAME=value words of argv
+    word_list_t words;
+    redirection_t* redirs;    // In the order they were written
+    int redir_count;
+} expanded_cmd_t;
+
+// Lex and expand a command without pipes: parameters, $(...), field
+// splitting, globbing and quote removal. Leading NAME=value words and
+// redirection targets are expanded but never split or globbed.
+bool expand_simple_command(const char* command, expanded_cmd_t* cmd);
+void free_expanded_cmd(expanded_cmd_t* cmd);
+
+// Expand already lexed tokens into cmd, reusing the buffers it holds from
+// an earlier call. Leading assignments are recognised only if asked for.
+bool expand_tokens(const char* text, const token_t* tokens, int count, bool assignments, expanded_cmd_t* cmd);
+
+// Point argv at the current words after they were filled in directly
+bool finish_expanded_cmd(expanded_cmd_t* cmd);
+
+// Expand one word into a single string without splitting or globbing
+char* expand_word(const char* word, size_t len);
+
+// Remove quotes and escapes from a word without expanding it
+char* dequote_word(const char* word, size_t len);
+
+#endif
\ No newline at end of file
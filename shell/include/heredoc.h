@@ -0,0 +1,21 @@
+#ifndef HEREDOC_H
+#define HEREDOC_H
+
+#include <stddef.h>
+#include "expand.h"
+
+// Store data in a sealed in-memory file and return a descriptor positioned
+// at its start, or -1 on failure
+int heredoc_create(const char* data, size_t len);
+
+// Read the body of every <<WORD in line from the input stream and return
+// a copy of line where each one is replaced by a here-string holding its
+// body, so the command text carries its input wherever it is run later.
+// When typed is not NULL each line read is appended to it after a newline.
+char* collect_heredocs(const char* line, capture_buf_t* typed);
+
+// Copy of a command for listings and logs. Here-documents become quoted
+// here-strings, so every quoted here-string operand is shown as '...'
+char* heredoc_summary(const char* command);
+
+#endif
\ No newline at end of file
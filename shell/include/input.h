@@ -3,6 +3,17 @@
 
 #define MAX_INPUT_SIZE 4096
 
+#include <stdbool.h>
+
 char* get_user_input();
 
+// Read lines from fd or from a string instead of the terminal, with no
+// limit on line length
+void input_from_fd(int fd);
+bool input_from_string(const char* text);
+bool input_is_batch();
+
+// Whether a batch line can be returned without reading again
+bool input_pending();
+
 #endif
\ No newline at end of file
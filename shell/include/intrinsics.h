@@ -6,12 +6,36 @@
 bool hop_command(int argc, char** argv);
 void set_shell_home(char* dir);
 void add_log_entry(const char* cmd);
+// Read the command log, oldest first; the caller frees each entry and
+// the array
+char** read_log_entries(int* count);
 bool reveal_command(int argc, char** argv);
 bool log_command(int argc, char** argv);
 bool is_intrinsic(const char* cmd);
 bool execute_intrinsic(const char* cmd, int argc, char** argv);
-bool activities_command();
+
+// Run an intrinsic and return its exit status: 0 or 1 from its result,
+// unless it reported another one with set_intrinsic_status
+int run_intrinsic_status(const char* cmd, int argc, char** argv);
+void set_intrinsic_status(int status);
+bool activities_command(int argc, char** argv);
 bool ping_command(int argc, char** argv);
 bool fg_command(int argc, char** argv);
 bool bg_command(int argc, char** argv);
+bool export_command(int argc, char** argv);
+bool unset_command(int argc, char** argv);
+bool read_line_command(int argc, char** argv);
+bool stats_command(int argc, char** argv);
+bool test_command(int argc, char** argv);
+bool true_command(int argc, char** argv);
+bool false_command(int argc, char** argv);
+bool parallel_command(int argc, char** argv);
+bool submit_command(int argc, char** argv);
+bool sched_command(int argc, char** argv);
+bool time_command(int argc, char** argv);
+bool limit_command(int argc, char** argv);
+bool timeout_command(int argc, char** argv);
+bool peek_command(int argc, char** argv);
+bool wait_command(int argc, char** argv);
+bool bench_command(int argc, char** argv);
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef JOB_LIMITS_H
+#define JOB_LIMITS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/resource.h>
+
+// Limits given to a job at launch. The rlimits hold for each process of
+// the job; the cgroup ones for the job as a whole.
+typedef struct {
+    rlim_t address_space;   // -v: RLIMIT_AS in bytes
+    rlim_t cpu_seconds;     // -t: RLIMIT_CPU
+    rlim_t open_files;      // -n: RLIMIT_NOFILE
+    long long memory_max;   // -m: memory.max in bytes, 0 for none
+    int cpu_percent;        // -q: cpu.max as a percentage of one CPU, 0 for none
+} job_limits_t;
+
+void init_job_limits(job_limits_t* limits);
+bool has_cgroup_limits(const job_limits_t* limits);
+
+// Parse a limit option and its value. Returns 1 when it was one, 0 when
+// opt is not a limit option and -1 for a bad value.
+int parse_limit_option(const char* opt, const char* value, job_limits_t* limits);
+
+// Create the cgroup of a job before it starts; returns its directory, or
+// NULL when there is no writable cgroup v2 hierarchy with the controllers
+char* create_job_cgroup(int job_id, const job_limits_t* limits);
+
+// Remove a job's cgroup once its processes are gone
+void remove_job_cgroup(const char* cgroup);
+
+// Called in a job's child: join its cgroup and set its rlimits
+void apply_job_limits(const job_limits_t* limits, const char* cgroup);
+
+// Describe the limits next to the job's current usage
+void format_job_limits(const job_limits_t* limits, const char* cgroup, long vm_kb,
+                       double cpu_time, int open_files, char* out, size_t size);
+
+#endif
\ No newline at end of file
@@ -2,24 +2,60 @@
 #define JOBS_H
 
 #include <stdbool.h>
+#include <signal.h>
 #include <sys/types.h>
+#include <sys/resource.h>
+#include "job_limits.h"
+#include "spool.h"
 
 typedef enum {
     JOB_RUNNING,
-    JOB_STOPPED
+    JOB_STOPPED,
+    JOB_QUEUED         // Waiting for a free slot; pid is still 0
 } job_state_t;
 
 typedef struct {
     int job_id;
     pid_t pid;
-    char* command;
+    char* command;     // Text shown in listings and logs
+    char* script;      // Text to run when it differs from command, or NULL
+    char* name;        // First word of command
     bool completed;
     int status;
     job_state_t state;
     pid_t pgid;        // Process group ID
+    int priority;      // Nice value applied at start, with a matching IO priority
+    bool idle;         // Run in the idle CPU and IO classes instead
+    char* cpus;        // CPU list such as "0-3,6", or NULL for any CPU
+    bool demoted;      // Lowered while another job has the foreground
+    struct rusage usage;// Final accounting, from wait4 when the job is reaped
+    double cpu_time;   // User and system seconds of the process group
+    long rss_kb;       // Resident memory of the process group
+    long vm_kb;        // Largest address space of one of its processes
+    int open_files;    // Most files open in one of its processes
+    job_limits_t limits;
+    char* cgroup;      // Directory of the job's own cgroup, or NULL
+    double deadline;   // Seconds the job may run, or 0
+    double grace;      // Seconds between SIGTERM and SIGKILL once it expires
+    double expires_at; // Monotonic time of the deadline once started
+    bool timed_out;    // SIGTERM was sent because the deadline passed
+    spool_t* spool;    // Buffered output of a background job, or NULL
+    int pidfd;         // Handle on the job's process, immune to PID reuse, or -1
+    double started_at; // Wall clock time the job started, or 0
+    double ended_at;   // Wall clock time the SIGCHLD handler reaped it, or 0
 } job_t;
 
-#define MAX_JOBS 100
+// Scheduling options given when a background job is submitted
+typedef struct {
+    int priority;
+    bool idle;
+    const char* cpus;
+    job_limits_t limits;
+    double deadline;
+    double grace;
+} job_opts_t;
+
+#define MAX_JOBS 1024
 
 extern job_t jobs[MAX_JOBS];
 void init_jobs();
@@ -48,14 +84,41 @@ job_t* get_foreground_job();
 // Set current foreground job
 void set_foreground_job(int job_id);
 
+// Queue a background job, starting it at once if the running limit
+// allows; returns its job ID or -1
+int submit_job(const char* command, const job_opts_t* opts);
+
+// Submit a command run with & as a job; a leading "limit OPTIONS" sets
+// the job's limits instead of running as a command
+int submit_background(const char* command);
+
+// Start queued jobs, best priority first, while slots are free
+void dispatch_jobs();
+
+// Start a queued job now regardless of the limit
+bool start_queued_job(job_t* job, bool foreground);
+
+// Apply a job's priority and CPU set to the calling process
+void apply_job_sched(const job_t* job);
+
+// Free a job's table entry
+void remove_job(job_t* job);
+
+// Set by the SIGCHLD handler when a job finished, so a slot may be free
+extern volatile sig_atomic_t jobs_reaped;
+
 // Clear foreground job
 void clear_foreground_job();
 
 // Get most recent job
 int get_most_recent_job();
 
-// List all running or stopped processes
-bool activities_command();
+// Fill out with the jobs still running, stopped or queued, sorted by
+// command name, and return how many there are
+int list_jobs(job_t** out);
+
+// List all running or stopped processes; activities -w watches them
+bool activities_command(int argc, char** argv);
 
 // Send signal to process
 bool ping_command(int argc, char** argv);
@@ -66,4 +129,25 @@ bool fg_command(int argc, char** argv);
 // Background command implementation
 bool bg_command(int argc, char** argv);
 
+// submit [-p NICE|idle] [-c CPUS] command...
+bool submit_command(int argc, char** argv);
+
+// limit [-v SIZE] [-t SECS] [-n FILES] [-m SIZE] [-q PERCENT] command...
+bool limit_command(int argc, char** argv);
+
+// timeout [-g GRACE] DURATION command...
+bool timeout_command(int argc, char** argv);
+
+// sched [-j LIMIT] [-i LEVEL] [-o SIZE]: show or set the running job
+// limit, how far background jobs are lowered while a foreground job runs
+// and the size of the output spool of new background jobs
+bool sched_command(int argc, char** argv);
+
+// peek [-n LINES] [JOB]: print the last lines a spooled job wrote
+bool peek_command(int argc, char** argv);
+
+// wait [-n] [--timeout DURATION] [JOB...]: wait for the jobs, or for the
+// first of them with -n; the status is the last finished job's
+bool wait_command(int argc, char** argv);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    TOK_WORD,
+    TOK_PIPE,        // |
+    TOK_AMP,         // &
+    TOK_SEMI,        // ;
+    TOK_NEWLINE,     // unquoted newline, a separator like ;
+    TOK_AND_IF,      // &&
+    TOK_OR_IF,       // ||
+    TOK_LT,          // <
+    TOK_GT,          // >
+    TOK_DGT,         // >>
+    TOK_HEREDOC,     // <<
+    TOK_HEREDOC_TAB, // <<-
+    TOK_HERESTRING   // <<<
+} token_type_t;
+
+// A token is a slice of the input; words keep their quotes and $(...)
+typedef struct {
+    token_type_t type;
+    uint32_t offset;
+    uint32_t length;
+} token_t;
+
+typedef struct {
+    token_t* tokens;
+    int count;
+    int cap;
+} token_list_t;
+
+typedef enum {
+    LEXER_SCALAR,
+    LEXER_SSE2,
+    LEXER_AVX2
+} lexer_impl_t;
+
+// Tokenize input into out (which is reset first). Returns false on an
+// unterminated quote or command substitution.
+bool lex_line(const char* input, size_t len, token_list_t* out);
+void free_tokens(token_list_t* list);
+
+// Copy a word to dst without its quotes and escapes and return the new
+// length; dst may equal src since the output never outgrows the input
+size_t lex_dequote(const char* src, size_t len, char* dst);
+
+// Given a pointer at "$(", return the position just past the matching ")"
+// or NULL if the substitution is unterminated
+const char* skip_substitution(const char* p);
+
+// Text of an operator token
+const char* token_text(token_type_t type);
+
+// Check whether a token redirects input or output
+bool is_redirection_token(token_type_t type);
+
+// Select the special-character scanner; returns false if the CPU lacks it
+bool lexer_set_impl(lexer_impl_t impl);
+lexer_impl_t lexer_get_impl();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdbool.h>
+
+// activities -w [INTERVAL_MS] [-n COUNT]
+// Redraws the job list every interval with CPU%, RSS, state and I/O
+// rates until q, Ctrl+C or COUNT refreshes. Each process of a job keeps
+// its /proc files open and is re-read with pread.
+bool watch_command(int argc, char** argv);
+
+// Refresh cpu_time, rss_kb, vm_kb and open_files of every started job
+// from the /proc files of its process tree, kept open between calls
+void sample_jobs_usage();
+
+#endif
\ No newline at end of file
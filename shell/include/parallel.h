@@ -0,0 +1,13 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdbool.h>
+
+// parallel [-j N] [-X] cmd [args with {}] [::: inputs...]
+// Runs cmd once per input (or per batch of inputs with -X), at most N at
+// a time, printing each job's output in one piece when it finishes.
+// Under -X a word containing {} is repeated once per input of the batch.
+// Inputs are read from stdin, one per line, when ::: is not given.
+bool parallel_command(int argc, char** argv);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef PARSE_CACHE_H
+#define PARSE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lexer.h"
+#include "vm.h"
+
+// Bounded LRU cache of the state-independent parse stages of a line:
+// its tokens, whether it is grammatically valid and, if it is, its
+// compiled program. Expansion depends on variables and the cwd, so it
+// always runs afresh when the program does.
+
+// Longer lines are lexed every time rather than pinned in memory
+#define PARSE_CACHE_MAX_LINE 65536
+
+// Lex a line through the cache; out is reset and filled with a copy
+bool lex_cached(const char* line, size_t len, token_list_t* out);
+
+// Cached parse_status_t of a line, or -1 if it was never parsed. A valid
+// line counts only with its program, which is returned with a reference
+// for the caller to release.
+int cached_parse_result(const char* line, size_t len, program_t** prog);
+
+// Remember a parse result; the entry takes its own reference to prog
+void cache_parse_result(const char* line, size_t len, int status, program_t* prog);
+
+typedef struct {
+    uint64_t lex_hits;
+    uint64_t lex_misses;
+    uint64_t parse_hits;
+    uint64_t parse_misses;
+    uint64_t evictions;
+    size_t entries;
+} parse_cache_stats_t;
+
+void get_parse_cache_stats(parse_cache_stats_t* stats);
+
+// Intrinsic
+bool stats_command(int argc, char** argv);
+
+#endif
\ No newline at end of file
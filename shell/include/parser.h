@@ -2,7 +2,24 @@
 #define PARSER_H
 
 #include <stdbool.h>
+#include "vm.h"
+
+typedef enum {
+    PARSE_OK,
+    PARSE_INCOMPLETE,    // Valid so far, but a compound command is still open
+    PARSE_ERROR
+} parse_status_t;
 
 bool parse_input(const char* input);
 
-#endif 
\ No newline at end of file
+// Parse a script and, when prog is not NULL, compile it to a new program
+parse_status_t parse_script(const char* input, program_t** prog);
+
+// Find the stages of the pipeline in tokens: the index of each pipe token
+// between two stages, and per stage the index of the first redirection
+// after a compound command, or -1 for a simple command. The arrays need
+// room for tokens->count + 1 entries. Returns the number of stages, or 0
+// if the tokens are not one pipeline.
+int pipeline_stages(const char* text, const token_list_t* tokens, int* pipes, int* redirects);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Timers around the stages of the shell's own work, from reading a line
+// to the next prompt. They are always compiled in and cost one branch
+// while off; `stats on` turns them on, and $SHELL_TRACE=FILE also
+// records every stage as a Chrome trace written to FILE at exit.
+typedef enum {
+    PROBE_PROMPT,      // Render the prompt
+    PROBE_INPUT,       // Read a line, including the wait for the user
+    PROBE_PARSE,       // Check and compile a command
+    PROBE_LEX,         // Tokenize a line, through the parse cache
+    PROBE_LOG,         // Append to the command log
+    PROBE_EXECUTE,     // Run a whole command line
+    PROBE_SPAWN,       // fork, as seen by the shell
+    PROBE_WAIT,        // Wait for a foreground job
+    PROBE_REAP,        // Collect and report finished background jobs
+    PROBE_STAGES
+} probe_stage_t;
+
+// Read $SHELL_TRACE; called once at startup
+void init_probes();
+
+// Start of a stage: the monotonic time in nanoseconds, or 0 while off
+uint64_t probe_start();
+
+// End of a stage begun at start; does nothing for 0
+void probe_end(probe_stage_t stage, uint64_t start);
+
+void set_probes_enabled(bool enabled);
+bool probes_enabled();
+void reset_probes();
+
+// Print each stage's count, total, mean and histogram
+void print_probe_stats();
+
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef RCFILE_H
+#define RCFILE_H
+
+#include <stddef.h>
+
+// ~/.shellrc is compiled once and the program is saved next to it in
+// ~/.shellrc.snap. Later starts map the snapshot and rebuild the program
+// from it without lexing or parsing, as long as the rc file keeps its
+// mtime, or failing that its contents. Here-documents are not read in
+// the rc file; a here-string does the same job.
+
+typedef enum {
+    RC_NONE,           // No rc file
+    RC_SNAPSHOT,       // Loaded from a current snapshot
+    RC_COMPILED,       // Parsed, and the snapshot rewritten
+    RC_FAILED          // Unreadable or invalid; nothing ran
+} rc_source_t;
+
+typedef struct {
+    rc_source_t source;
+    size_t size;       // Bytes in the rc file
+    size_t snapshot;   // Bytes in the snapshot
+    double check;      // Stat of the rc file, and reading and hashing it if needed
+    double load;       // Mapping the snapshot, or compiling and saving it
+    double run;        // Running the program
+} rc_timing_t;
+
+// Run ~/.shellrc; timing may be NULL
+void run_rcfile(rc_timing_t* timing);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include <stdbool.h>
+
+// Session recordings: every command the shell runs, with when it started,
+// how long it took, the directory it ran in, its exit status and a hash
+// of its output, in a compact binary file. A replay feeds the commands
+// back through the REPL and compares the new timings and outputs.
+//
+// Output is hashed by pointing the shell's stdout and stderr at a memfd,
+// which is only done when they are not a terminal, or during a replay.
+
+// Append every command run from now on to path, which is created afresh
+bool start_recording(const char* path);
+
+// Queue the commands of a recording as the shell's input. A paced replay
+// waits out the recorded gaps between commands; a quiet one discards
+// the output after hashing it.
+bool start_replay(const char* path, bool paced, bool quiet);
+bool replaying();
+
+// Called by the REPL around each command it runs
+void record_begin();
+void record_end(const char* text, int status);
+
+// Print the per-command comparison once the replay input ran out;
+// returns 1 if an output, status or command differed, else 0
+int finish_replay();
+
+#endif
\ No newline at end of file
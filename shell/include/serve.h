@@ -0,0 +1,26 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+// Daemon mode: shell.out --serve PATH listens on a UNIX stream socket and
+// runs each request in a forked copy of the shell, tracked as a job, while
+// the event loop streams its output back. Every connection keeps its own
+// working directory across requests.
+//
+// Frames in both directions are a type byte, a 4-byte big-endian payload
+// length and the payload. A connection runs one request at a time; more
+// requests sent meanwhile wait their turn.
+#define SERVE_CWD 'C'      // Client: directory for the requests that follow
+#define SERVE_RUN 'R'      // Client: command text to run
+#define SERVE_STDOUT 'O'   // Server: a chunk of the request's stdout
+#define SERVE_STDERR 'E'   // Server: a chunk of its stderr
+#define SERVE_EXIT 'X'     // Server: 4-byte big-endian exit status, last frame of a request
+#define SERVE_HEADER_SIZE 5
+#define SERVE_MAX_PAYLOAD (1 << 20)
+
+// Runs the text of a request in the forked shell and returns its status
+typedef int (*serve_run_fn)(const char* text);
+
+// Serve requests on path until SIGINT or SIGTERM; returns the exit status
+int serve(const char* path, serve_run_fn run);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Output of a background job, kept in a bounded ring on a memfd. The job
+// writes into a pipe; the shell drains it into the ring as it becomes
+// readable, so the oldest bytes are dropped once the ring is full.
+typedef struct {
+    int read_fd;       // Shell's end of the pipe, -1 after EOF
+    int write_fd;      // Job's end, closed once the job was forked
+    int memfd;
+    char* ring;
+    size_t size;
+    unsigned long long total;  // Bytes read so far
+    unsigned long long shown;  // Bytes already written to the terminal
+} spool_t;
+
+// Create a spool with a ring of size bytes, or NULL on failure
+spool_t* spool_create(size_t size);
+
+// Close the job's end of the pipe in the shell
+void spool_close_writer(spool_t* spool);
+
+// Read everything the pipe holds. With passthrough the new bytes are also
+// written to stdout. Returns false once the pipe reached EOF.
+bool spool_drain(spool_t* spool, bool passthrough);
+
+// Write the bytes still in the ring that were not shown yet
+void spool_replay(spool_t* spool);
+
+// Write the last lines held in the ring
+void spool_tail(const spool_t* spool, int lines);
+
+// Bytes held in the ring, and bytes dropped because it was full
+size_t spool_buffered(const spool_t* spool);
+unsigned long long spool_dropped(const spool_t* spool);
+
+// Bytes held in the ring that were not shown yet
+size_t spool_unshown(const spool_t* spool);
+
+void spool_free(spool_t* spool);
+
+#endif
\ No newline at end of file
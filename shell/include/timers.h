@@ -0,0 +1,50 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/resource.h>
+
+typedef void (*timer_fn)(int arg);
+typedef void (*watch_fn)(int fd, int arg);
+
+// Call fn(arg) once seconds have passed. All timers share one heap and
+// one timerfd; they fire while the shell waits for input or a child, or
+// between commands.
+bool add_timer(double seconds, timer_fn fn, int arg);
+
+// Run the timers that are due
+void run_due_timers();
+
+// Whether any timer is armed
+bool timers_pending();
+
+// Call fn(fd, arg) whenever fd is readable, in the same places timers
+// fire; between commands the watches are polled every few milliseconds
+bool watch_fd(int fd, watch_fn fn, int arg);
+void unwatch_fd(int fd);
+
+// Whether any timer or watch is armed
+bool events_pending();
+
+// Run the due timers and the callbacks of ready watches without blocking
+void run_due_events();
+
+// Seconds on the monotonic clock
+double monotonic_seconds();
+
+// Parse a duration such as 10, 1.5s, 500ms, 2m or 1h into seconds
+bool parse_duration(const char* text, double* seconds);
+
+// wait4 for pid, running timers and watches while it blocks. SIGCHLD must be blocked.
+pid_t wait_with_timers(pid_t pid, int* status, int options, struct rusage* usage);
+
+// Block until fd is readable, running timers and watches meanwhile
+void wait_readable_with_timers(int fd);
+
+// Wait once for fd to become readable before the monotonic deadline (0
+// for none), running timers and watches meanwhile. Returns false when the
+// deadline passed or a timer, watch or signal woke it first.
+bool wait_readable_until(int fd, double deadline);
+
+#endif
\ No newline at end of file
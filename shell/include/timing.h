@@ -0,0 +1,41 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdbool.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+// Start of a timed command: the clock and the usage counters it began with
+typedef struct {
+    struct timespec start;
+    struct rusage self;
+    struct timeval child_user;
+    struct timeval child_sys;
+    long saved_maxrss;
+} timing_t;
+
+typedef struct {
+    double real;
+    double user;
+    double sys;
+    long maxrss_kb;
+} timing_result_t;
+
+void timing_start(timing_t* t);
+void timing_finish(timing_t* t, timing_result_t* result);
+
+// Print a result to stderr, prefixed with label when it is not NULL
+void print_timing(const timing_result_t* result, const char* label);
+
+// Add the usage of a reaped foreground child, as returned by wait4
+void note_child_usage(const struct rusage* usage);
+
+// Seconds of wall time after which a command prints its stats, taken
+// from $REPORTTIME; negative when unset
+double report_threshold();
+
+// time command [args...]
+bool time_command(int argc, char** argv);
+
+#endif
\ No newline at end of file
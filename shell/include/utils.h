@@ -2,10 +2,21 @@
 #define UTILS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 void split_command(char* input, char** argv, int* argc);
 char* get_home_directory();
 bool is_subdirectory(const char* path, const char* potential_parent);
 char* format_path(const char* current_path, const char* home_path);
+void sort_strings(char** strings, size_t count);
+
+// Parse a positive count with an optional K, M or G suffix
+bool parse_size(const char* text, long long* out);
+
+// Format a byte count with a B, K, M, G or T unit
+void format_size(double bytes, char* out, size_t size);
+
+// Format seconds with a us, ms or s unit that keeps three or four digits
+void format_duration(double seconds, char* out, size_t size);
 #define MAX_INPUT_SIZE 4096
 #ifndef HOST_NAME_MAX
 #define HOST_NAME_MAX 256
@@ -0,0 +1,45 @@
+#ifndef VARIABLES_H
+#define VARIABLES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Import the process environment as exported shell variables
+void init_variables();
+
+// Look up a variable by a (possibly unterminated) name
+const char* get_variable_n(const char* name, size_t len);
+const char* get_variable(const char* name);
+
+// Create or update a variable; exported variables are passed to commands
+bool set_variable(const char* name, const char* value, bool exported);
+
+// Remove a variable
+bool unset_variable(const char* name);
+
+// Environment for execve, rebuilt only after an exported variable changes
+char** get_envp();
+
+// execve path with the shell's environment. A file that is not in an
+// executable format is run by /bin/sh, as execvp does for scripts without
+// a #! line. Returns on failure.
+void exec_file(const char* path, char** argv);
+
+// Search PATH and exec_file argv; returns on failure
+void exec_with_env(char** argv);
+
+// Resolve a command name against PATH the way exec_with_env would, or
+// return NULL if no executable matches; the caller frees the result
+char* find_command_path(const char* name);
+
+// Changes whenever PATH is set or unset
+unsigned get_path_generation();
+
+// Check whether a word has the form NAME=value
+bool is_assignment(const char* word);
+
+// Intrinsics
+bool export_command(int argc, char** argv);
+bool unset_command(int argc, char** argv);
+
+#endif
\ No newline at end of file
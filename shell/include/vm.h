@@ -0,0 +1,115 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdbool.h>
+#include <signal.h>
+#include "lexer.h"
+#include "expand.h"
+
+typedef enum {
+    OP_RUN,            // Run command arg, setting $?
+    OP_RUN_BG,         // Start command arg as a background job
+    OP_JUMP,           // Continue at jump
+    OP_JUMP_IF_FAIL,   // Jump if $? is non-zero
+    OP_JUMP_IF_OK,     // Jump if $? is zero
+    OP_SET_STATUS,     // Set $? to arg
+    OP_FOR_INIT,       // Expand the words of command arg into loop slot aux
+    OP_FOR_NEXT,       // Assign the next word of slot aux, or jump when done
+    OP_DEFINE,         // Define function arg
+    OP_RETURN,         // Leave the program with $? or the status word arg;
+                       // aux 1 is exit, which leaves the shell too
+    OP_TIME_START,     // Start timer slot aux
+    OP_TIME_END,       // Print the stats of timer slot aux
+    OP_SAVE_STATUS,    // Keep $? in loop slot aux
+    OP_RESTORE_STATUS  // Set $? to the status kept in loop slot aux
+} opcode_t;
+
+typedef struct {
+    opcode_t op;
+    int arg;
+    int aux;
+    int jump;
+} instr_t;
+
+typedef enum {
+    CMD_UNPREPARED,
+    CMD_GENERIC,       // Pipes or redirections: handed to the executor
+    CMD_ASSIGN,        // Only NAME=value words
+    CMD_SIMPLE         // Words only: a function, intrinsic or program
+} cmd_kind_t;
+
+// A simple command or pipeline, lexed once when the script is compiled
+typedef struct {
+    char* text;
+    token_t* tokens;
+    int count;
+    char* var;                 // Loop variable of a for command
+    cmd_kind_t kind;
+    bool intrinsic;            // The first word names an intrinsic
+    word_list_t template_words;// All words, when none needs expansion
+    char** template_argv;
+    char* path;                // PATH lookup cached for the template
+    unsigned path_generation;
+    expanded_cmd_t scratch;    // Reused for every run of the command
+} vm_cmd_t;
+
+typedef struct program program_t;
+
+typedef struct {
+    char* name;
+    program_t* body;
+} func_def_t;
+
+struct program {
+    instr_t* code;
+    int code_len;
+    int code_cap;
+    vm_cmd_t* cmds;
+    int cmd_count;
+    int cmd_cap;
+    func_def_t* funcs;
+    int func_count;
+    int func_cap;
+    int loop_slots;
+    int timer_slots;
+    int refs;
+};
+
+program_t* new_program();
+void release_program(program_t* prog);
+
+// Append an instruction and return its index
+int program_emit(program_t* prog, opcode_t op, int arg, int aux);
+
+// Copy a run of tokens into a new command and return its index. Newlines
+// inside the run (after | for instance) become spaces.
+int program_add_command(program_t* prog, const char* text, const token_t* tokens, int count);
+
+// Record a function definition and return its index; takes over body
+int program_add_function(program_t* prog, const char* name, size_t len, program_t* body);
+
+// Run a compiled program and return its exit status
+int vm_run(program_t* prog);
+
+// Run the shell function argv[0] if one is defined; returns false if not
+bool vm_call_function(int argc, char** argv, int* status);
+
+// Run an expanded simple command: a function, an intrinsic or a program
+// labelled text; returns its exit status
+int vm_run_argv(const char* text, int argc, char** argv);
+
+// Positional parameters of the running function ($1, $#, $@)
+const char* vm_positional(int n);
+int vm_positional_count();
+
+// Set $0 and the positional parameters of a script run from the command
+// line; the strings must outlive the shell
+void vm_set_script_args(const char* name, int argc, char** argv);
+
+// Set from signal handlers to stop running loops at the next check
+extern volatile sig_atomic_t vm_interrupted;
+
+// Set by exit; every running program stops and the shell exits with $?
+extern volatile sig_atomic_t vm_exit_requested;
+
+#endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#ifndef WILDCARD_H
+#define WILDCARD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// One directory entry; name is an offset into the listing's name buffer
+typedef struct {
+    size_t name;
+    unsigned char type;    // d_type as reported by the filesystem
+} dir_entry_t;
+
+// All entries of one directory, read in a single pass
+typedef struct {
+    char* names;
+    size_t names_len;
+    size_t names_cap;
+    dir_entry_t* entries;
+    size_t count;
+    size_t cap;
+} dir_listing_t;
+
+// Read every entry of path except "." and ".."
+bool read_dir_listing(const char* path, dir_listing_t* listing);
+void free_dir_listing(dir_listing_t* listing);
+
+#define LISTING_NAME(listing, i) ((listing)->names + (listing)->entries[i].name)
+
+typedef struct dir_cache dir_cache_t;
+typedef struct word_list word_list_t;
+
+// Append the sorted paths matching pattern to list and return how many
+// there were. Backslash-escaped characters in the pattern match literally.
+// Directory listings are cached in *cache (created on first use) so the
+// words of one command share them.
+size_t glob_expand(const char* pattern, dir_cache_t** cache, word_list_t* list);
+void free_dir_cache(dir_cache_t* cache);
+
+#endif
\ No newline at end of file
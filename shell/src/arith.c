@@ -0,0 +1,268 @@
+#include "arith.h"
+#include "variables.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+// ############## LLM Generated Code Begins ##############
+typedef struct {
+    const char* p;
+    const char* expr;
+    int noeval;        // Inside the unevaluated side of &&, || or ?:
+    bool error;
+} arith_t;
+
+static long long parse_comma(arith_t* a);
+static long long parse_assign(arith_t* a);
+
+static void fail(arith_t* a, const char* message) {
+    if (!a->error) {
+        fprintf(stderr, "%s: %s\n", a->expr, message);
+    }
+    a->error = true;
+}
+
+static void skip_space(arith_t* a) {
+    while (isspace((unsigned char)*a->p)) a->p++;
+}
+
+// Consume op if it comes next and is not the start of a longer operator
+static bool accept(arith_t* a, const char* op) {
+    skip_space(a);
+    size_t len = strlen(op);
+    if (strncmp(a->p, op, len) != 0) {
+        return false;
+    }
+    // Keep "<" from matching "<<" or "<=", "&" from matching "&&", etc.
+    char next = a->p[len];
+    if (len == 1 && (next == '=' || next == op[0]) && strchr("<>&|", op[0]) != NULL) {
+        return false;
+    }
+    if (len == 1 && next == '=' && strchr("*/%+-^!=", op[0]) != NULL) {
+        return false;
+    }
+    if (len == 2 && op[0] == op[1] && strchr("<>", op[0]) != NULL && next == '=') {
+        return false;
+    }
+    a->p += len;
+    return true;
+}
+
+static long long variable_value(const char* name, size_t len) {
+    const char* value = get_variable_n(name, len);
+    return value ? strtoll(value, NULL, 0) : 0;
+}
+
+static void assign(arith_t* a, const char* name, size_t len, long long value) {
+    if (a->noeval) {
+        return;
+    }
+    char* var = strndup(name, len);
+    char text[32];
+    snprintf(text, sizeof(text), "%lld", value);
+    if (var != NULL) {
+        set_variable(var, text, false);
+    }
+    free(var);
+}
+
+static size_t name_length(const char* p) {
+    size_t len = 0;
+    if (isalpha((unsigned char)*p) || *p == '_') {
+        while (isalnum((unsigned char)p[len]) || p[len] == '_') len++;
+    }
+    return len;
+}
+
+static long long parse_unary(arith_t* a) {
+    skip_space(a);
+    if (accept(a, "++") || accept(a, "--")) {
+        long long delta = a->p[-1] == '+' ? 1 : -1;
+        skip_space(a);
+        size_t len = name_length(a->p);
+        if (len == 0) {
+            fail(a, "variable expected after ++ or --");
+            return 0;
+        }
+        long long value = variable_value(a->p, len) + delta;
+        assign(a, a->p, len, value);
+        a->p += len;
+        return value;
+    }
+    if (accept(a, "+")) return parse_unary(a);
+    if (accept(a, "-")) return -parse_unary(a);
+    if (accept(a, "!")) return !parse_unary(a);
+    if (accept(a, "~")) return ~parse_unary(a);
+
+    if (accept(a, "(")) {
+        long long value = parse_comma(a);
+        if (!accept(a, ")")) fail(a, "missing )");
+        return value;
+    }
+
+    if (isdigit((unsigned char)*a->p)) {
+        char* end;
+        long long value = strtoll(a->p, &end, 0);
+        if (isalnum((unsigned char)*end)) fail(a, "invalid number");
+        a->p = end;
+        return value;
+    }
+
+    size_t len = name_length(a->p);
+    if (len == 0) {
+        fail(a, *a->p ? "syntax error" : "operand expected");
+        return 0;
+    }
+    const char* name = a->p;
+    a->p += len;
+    long long value = variable_value(name, len);
+    if (accept(a, "++") || accept(a, "--")) {
+        assign(a, name, len, value + (a->p[-1] == '+' ? 1 : -1));
+    }
+    return value;
+}
+
+// Binary operators from loosest to tightest binding
+static const char* const levels[][5] = {
+    {"|", NULL},
+    {"^", NULL},
+    {"&", NULL},
+    {"==", "!=", NULL},
+    {"<=", ">=", "<", ">", NULL},
+    {"<<", ">>", NULL},
+    {"+", "-", NULL},
+    {"*", "/", "%", NULL},
+};
+#define LEVEL_COUNT ((int)(sizeof(levels) / sizeof(levels[0])))
+
+static long long apply_binary(arith_t* a, const char* op, long long l, long long r) {
+    switch (op[0]) {
+    case '|': return l | r;
+    case '^': return l ^ r;
+    case '&': return l & r;
+    case '=': return l == r;
+    case '!': return l != r;
+    case '<':
+        if (op[1] == '<') return l << (r & 63);
+        return op[1] == '=' ? l <= r : l < r;
+    case '>':
+        if (op[1] == '>') return l >> (r & 63);
+        return op[1] == '=' ? l >= r : l > r;
+    case '+': return l + r;
+    case '-': return l - r;
+    case '*': return l * r;
+    default:
+        if (r == 0) {
+            if (!a->noeval) fail(a, "division by zero");
+            return 0;
+        }
+        return op[0] == '/' ? l / r : l % r;
+    }
+}
+
+static long long parse_level(arith_t* a, int level) {
+    if (level == LEVEL_COUNT) {
+        return parse_unary(a);
+    }
+
+    long long value = parse_level(a, level + 1);
+    while (!a->error) {
+        const char* op = NULL;
+        for (int i = 0; levels[level][i] != NULL && op == NULL; i++) {
+            if (accept(a, levels[level][i])) op = levels[level][i];
+        }
+        if (op == NULL) break;
+        value = apply_binary(a, op, value, parse_level(a, level + 1));
+    }
+    return value;
+}
+
+static long long parse_and(arith_t* a) {
+    long long value = parse_level(a, 0);
+    while (!a->error && accept(a, "&&")) {
+        // The right side is parsed but not evaluated once the result is known
+        a->noeval += !value;
+        long long right = parse_level(a, 0);
+        a->noeval -= !value;
+        value = value && right;
+    }
+    return value;
+}
+
+static long long parse_or(arith_t* a) {
+    long long value = parse_and(a);
+    while (!a->error && accept(a, "||")) {
+        a->noeval += !!value;
+        long long right = parse_and(a);
+        a->noeval -= !!value;
+        value = value || right;
+    }
+    return value;
+}
+
+static long long parse_ternary(arith_t* a) {
+    long long cond = parse_or(a);
+    if (a->error || !accept(a, "?")) {
+        return cond;
+    }
+
+    a->noeval += !cond;
+    long long then_value = parse_comma(a);
+    a->noeval -= !cond;
+    if (!accept(a, ":")) {
+        fail(a, "missing : in ?:");
+        return 0;
+    }
+    a->noeval += !!cond;
+    long long else_value = parse_ternary(a);
+    a->noeval -= !!cond;
+    return cond ? then_value : else_value;
+}
+
+static long long parse_assign(arith_t* a) {
+    static const char* const ops[] = {"=", "+=", "-=", "*=", "/=", "%=", "<<=", ">>=", "&=", "^=", "|=", NULL};
+
+    skip_space(a);
+    size_t len = name_length(a->p);
+    if (len > 0) {
+        const char* name = a->p;
+        const char* after = name + len;
+        while (isspace((unsigned char)*after)) after++;
+
+        for (int i = 0; ops[i] != NULL; i++) {
+            size_t op_len = strlen(ops[i]);
+            if (strncmp(after, ops[i], op_len) != 0 || (op_len == 1 && after[1] == '=')) {
+                continue;
+            }
+            a->p = after + op_len;
+            long long value = parse_assign(a);
+            if (op_len > 1) {
+                char op[3] = {ops[i][0], op_len == 3 ? ops[i][1] : '\0', '\0'};
+                value = apply_binary(a, op, variable_value(name, len), value);
+            }
+            assign(a, name, len, value);
+            return value;
+        }
+    }
+    return parse_ternary(a);
+}
+
+static long long parse_comma(arith_t* a) {
+    long long value = parse_assign(a);
+    while (!a->error && accept(a, ",")) {
+        value = parse_assign(a);
+    }
+    return value;
+}
+
+bool eval_arith(const char* expr, long long* result) {
+    arith_t a = {expr, expr, 0, false};
+    skip_space(&a);
+    *result = *a.p ? parse_comma(&a) : 0;
+    skip_space(&a);
+    if (!a.error && *a.p != '\0') {
+        fail(&a, "syntax error");
+    }
+    return !a.error;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
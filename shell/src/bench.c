@@ -0,0 +1,349 @@
+#define _GNU_SOURCE
+#include "bench.h"
+#include "parser.h"
+#include "timing.h"
+#include "vm.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+// ############## LLM Generated Code Begins ##############
+
+// Log-linear histogram of wall times in nanoseconds: BENCH_SUB buckets
+// per power of two, so each bucket is within 1/BENCH_SUB of its value.
+// Times past the last octave land in the last bucket.
+#define BENCH_SUB_BITS 6
+#define BENCH_SUB (1 << BENCH_SUB_BITS)
+#define BENCH_OCTAVES 41
+#define BENCH_BUCKETS ((BENCH_OCTAVES - BENCH_SUB_BITS + 1) * BENCH_SUB)
+
+typedef struct {
+    const char* label;
+    uint32_t counts[BENCH_BUCKETS];
+    int runs;
+    int failures;
+    double min;
+    double max;
+    double mean;       // Running mean and sum of squared deviations of
+    double m2;         // the wall time (Welford), for the t-test
+    double user;
+    double sys;
+} bench_stats_t;
+
+typedef enum {
+    BENCH_TEXT,
+    BENCH_CSV,
+    BENCH_JSON
+} bench_format_t;
+
+static int bucket_of(uint64_t ns) {
+    if (ns < BENCH_SUB) {
+        return (int)ns;
+    }
+    int shift = 63 - __builtin_clzll(ns) - BENCH_SUB_BITS;
+    int bucket = (shift + 1) * BENCH_SUB + (int)((ns >> shift) - BENCH_SUB);
+    return bucket < BENCH_BUCKETS ? bucket : BENCH_BUCKETS - 1;
+}
+
+// Middle of a bucket, in seconds
+static double bucket_value(int bucket) {
+    if (bucket < BENCH_SUB) {
+        return bucket / 1e9;
+    }
+    int shift = bucket / BENCH_SUB - 1;
+    uint64_t low = (uint64_t)(BENCH_SUB + bucket % BENCH_SUB) << shift;
+    return (low + ((uint64_t)1 << shift) / 2.0) / 1e9;
+}
+
+static void record_run(bench_stats_t* stats, const timing_result_t* result, int status) {
+    double real = result->real;
+    stats->counts[bucket_of((uint64_t)(real * 1e9))]++;
+    stats->runs++;
+    if (status != 0) stats->failures++;
+    if (stats->runs == 1 || real < stats->min) stats->min = real;
+    if (stats->runs == 1 || real > stats->max) stats->max = real;
+    double delta = real - stats->mean;
+    stats->mean += delta / stats->runs;
+    stats->m2 += delta * (real - stats->mean);
+    stats->user += result->user;
+    stats->sys += result->sys;
+}
+
+// Wall time below which a fraction q of the runs fall
+static double percentile(const bench_stats_t* stats, double q) {
+    uint64_t rank = (uint64_t)ceil(q * stats->runs);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BENCH_BUCKETS; i++) {
+        seen += stats->counts[i];
+        if (seen >= rank) {
+            double value = bucket_value(i);
+            return value < stats->min ? stats->min : value > stats->max ? stats->max : value;
+        }
+    }
+    return stats->max;
+}
+
+static double variance(const bench_stats_t* stats) {
+    return stats->runs > 1 ? stats->m2 / (stats->runs - 1) : 0;
+}
+
+// A command to benchmark: compiled once when it is one string, so every
+// run goes through the VM like a typed line, or run as words
+typedef struct {
+    program_t* prog;
+    int argc;
+    char** argv;
+    char* text;        // The words joined by spaces
+} bench_target_t;
+
+static bool prepare_target(bench_target_t* target, int argc, char** argv) {
+    target->prog = NULL;
+    target->argc = argc;
+    target->argv = argv;
+    size_t len = 0;
+    for (int i = 0; i < argc; i++) {
+        len += strlen(argv[i]) + 1;
+    }
+    if ((target->text = malloc(len)) == NULL) {
+        perror("malloc failed");
+        return false;
+    }
+    target->text[0] = '\0';
+    for (int i = 0; i < argc; i++) {
+        if (i > 0) strcat(target->text, " ");
+        strcat(target->text, argv[i]);
+    }
+    if (argc > 1) {
+        return true;
+    }
+    if (parse_script(argv[0], &target->prog) != PARSE_OK || target->prog == NULL) {
+        fprintf(stderr, "bench: invalid command: %s\n", argv[0]);
+        return false;
+    }
+    return true;
+}
+
+static int run_target(const bench_target_t* target) {
+    return target->prog != NULL ? vm_run(target->prog)
+                                : vm_run_argv(target->text, target->argc, target->argv);
+}
+
+// Run a command once, timed unless stats is NULL; false if interrupted
+static bool bench_run(const bench_target_t* target, bench_stats_t* stats) {
+    timing_t t;
+    timing_result_t result;
+    timing_start(&t);
+    int status = run_target(target);
+    timing_finish(&t, &result);
+    if (stats != NULL) {
+        record_run(stats, &result, status);
+    }
+    return !vm_interrupted;
+}
+
+static void print_text(const bench_stats_t* stats, int warmup) {
+    char min[16], median[16], p90[16], p99[16], max[16], user[16], sys[16];
+    format_duration(stats->min, min, sizeof(min));
+    format_duration(percentile(stats, 0.5), median, sizeof(median));
+    format_duration(percentile(stats, 0.9), p90, sizeof(p90));
+    format_duration(percentile(stats, 0.99), p99, sizeof(p99));
+    format_duration(stats->max, max, sizeof(max));
+    format_duration(stats->user / stats->runs, user, sizeof(user));
+    format_duration(stats->sys / stats->runs, sys, sizeof(sys));
+    printf("%s: %d runs, %d warmup", stats->label, stats->runs, warmup);
+    if (stats->failures > 0) {
+        printf(", %d failed", stats->failures);
+    }
+    printf("\n  min %s  median %s  p90 %s  p99 %s  max %s\n  mean user %s  sys %s\n",
+           min, median, p90, p99, max, user, sys);
+}
+
+static void print_csv_header() {
+    printf("command,runs,failures,min,median,p90,p99,max,mean,stddev,user,sys\n");
+}
+
+static void print_csv(const bench_stats_t* stats) {
+    // Quotes in the command are doubled, as CSV wants
+    putchar('"');
+    for (const char* p = stats->label; *p != '\0'; p++) {
+        if (*p == '"') putchar('"');
+        putchar(*p);
+    }
+    printf("\",%d,%d,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f\n",
+           stats->runs, stats->failures, stats->min, percentile(stats, 0.5),
+           percentile(stats, 0.9), percentile(stats, 0.99), stats->max, stats->mean,
+           sqrt(variance(stats)), stats->user / stats->runs, stats->sys / stats->runs);
+}
+
+static void print_json(const bench_stats_t* stats) {
+    printf("{\"command\":\"");
+    for (const unsigned char* p = (const unsigned char*)stats->label; *p != '\0'; p++) {
+        if (*p == '"' || *p == '\\') printf("\\%c", *p);
+        else if (*p < 0x20) printf("\\u%04x", *p);
+        else putchar(*p);
+    }
+    printf("\",\"runs\":%d,\"failures\":%d,\"min\":%.9f,\"median\":%.9f,\"p90\":%.9f,"
+           "\"p99\":%.9f,\"max\":%.9f,\"mean\":%.9f,\"stddev\":%.9f,\"user\":%.9f,\"sys\":%.9f}",
+           stats->runs, stats->failures, stats->min, percentile(stats, 0.5),
+           percentile(stats, 0.9), percentile(stats, 0.99), stats->max, stats->mean,
+           sqrt(variance(stats)), stats->user / stats->runs, stats->sys / stats->runs);
+}
+
+// Two-sided 5% critical values of Student's t for 1 to 30 degrees of
+// freedom; past that the normal value is close enough
+static const double t_critical[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+// Welch's t-test on the mean wall times. Returns false when there are
+// too few runs or no spread to test.
+static bool welch_test(const bench_stats_t* a, const bench_stats_t* b,
+                       double* t, double* df, bool* significant) {
+    if (a->runs < 2 || b->runs < 2) {
+        return false;
+    }
+    double va = variance(a) / a->runs;
+    double vb = variance(b) / b->runs;
+    if (va + vb <= 0) {
+        return false;
+    }
+    *t = (a->mean - b->mean) / sqrt(va + vb);
+    *df = (va + vb) * (va + vb) /
+          (va * va / (a->runs - 1) + vb * vb / (b->runs - 1));
+    int rounded = (int)*df;
+    double critical = rounded < 1 ? t_critical[0] : rounded <= 30 ? t_critical[rounded - 1] : 1.960;
+    *significant = fabs(*t) > critical;
+    return true;
+}
+
+static void print_comparison(const bench_stats_t* a, const bench_stats_t* b, bench_format_t format) {
+    double t = 0, df = 0;
+    bool significant = false;
+    bool tested = welch_test(a, b, &t, &df, &significant);
+    if (format == BENCH_JSON) {
+        printf(",\"comparison\":{\"ratio\":%.6f", b->mean > 0 ? a->mean / b->mean : 0);
+        if (tested) {
+            printf(",\"t\":%.4f,\"df\":%.2f,\"significant\":%s", t, df, significant ? "true" : "false");
+        }
+        printf("}");
+        return;
+    }
+    if (format == BENCH_CSV) {
+        return;
+    }
+
+    const bench_stats_t* fast = a->mean <= b->mean ? a : b;
+    const bench_stats_t* slow = fast == a ? b : a;
+    printf("%s is %.2fx faster than %s", fast->label,
+           fast->mean > 0 ? slow->mean / fast->mean : 0, slow->label);
+    if (tested) {
+        printf(" (t = %.2f, df = %.1f, %s at 95%%)\n", fabs(t), df,
+               significant ? "significant" : "not significant");
+    } else {
+        printf(" (too few runs to test)\n");
+    }
+}
+
+static void print_results(const bench_stats_t* stats, int count, bool compare, int warmup,
+                          bench_format_t format) {
+    if (format == BENCH_CSV) {
+        print_csv_header();
+    } else if (format == BENCH_JSON && compare) {
+        printf("{\"results\":[");
+    }
+    for (int i = 0; i < count; i++) {
+        if (format == BENCH_TEXT) print_text(&stats[i], warmup);
+        else if (format == BENCH_CSV) print_csv(&stats[i]);
+        else {
+            if (i > 0) printf(",");
+            print_json(&stats[i]);
+        }
+    }
+    if (compare) {
+        if (format == BENCH_JSON) printf("]");
+        print_comparison(&stats[0], &stats[1], format);
+        if (format == BENCH_JSON) printf("}");
+    }
+    if (format == BENCH_JSON) {
+        printf("\n");
+    }
+}
+
+bool bench_command(int argc, char** argv) {
+    int runs = 10;
+    int warmup = 1;
+    bool compare = false;
+    bench_format_t format = BENCH_TEXT;
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "--compare") == 0) {
+            compare = true;
+            arg++;
+            continue;
+        }
+        if (arg + 1 >= argc) {
+            break;
+        }
+        char* end;
+        long value = strtol(argv[arg + 1], &end, 10);
+        if (strcmp(argv[arg], "-n") == 0 && *end == '\0' && value > 0) {
+            runs = (int)value;
+        } else if (strcmp(argv[arg], "-w") == 0 && *end == '\0' && value >= 0) {
+            warmup = (int)value;
+        } else if (strcmp(argv[arg], "-f") == 0 && strcmp(argv[arg + 1], "text") == 0) {
+            format = BENCH_TEXT;
+        } else if (strcmp(argv[arg], "-f") == 0 && strcmp(argv[arg + 1], "csv") == 0) {
+            format = BENCH_CSV;
+        } else if (strcmp(argv[arg], "-f") == 0 && strcmp(argv[arg + 1], "json") == 0) {
+            format = BENCH_JSON;
+        } else {
+            fprintf(stderr, "bench: invalid option: %s %s\n", argv[arg], argv[arg + 1]);
+            return false;
+        }
+        arg += 2;
+    }
+    int words = argc - arg;
+    if (words < 1 || (compare && words != 2)) {
+        fprintf(stderr, "Usage: bench [-n RUNS] [-w WARMUP] [-f text|csv|json] command...\n"
+                        "       bench [-n RUNS] [-w WARMUP] [-f text|csv|json] --compare COMMAND COMMAND\n");
+        return false;
+    }
+
+    // Compared commands are each one string; otherwise the words form one
+    int count = compare ? 2 : 1;
+    bench_target_t targets[2] = {{NULL, 0, NULL, NULL}, {NULL, 0, NULL, NULL}};
+    static bench_stats_t stats[2];
+    bool ok = true;
+    for (int i = 0; i < count && ok; i++) {
+        ok = prepare_target(&targets[i], compare ? 1 : words, argv + arg + i);
+        memset(&stats[i], 0, sizeof(stats[i]));
+        stats[i].label = targets[i].text;
+    }
+    for (int i = 0; i < warmup && ok; i++) {
+        for (int c = 0; c < count && ok; c++) {
+            ok = bench_run(&targets[c], NULL);
+        }
+    }
+    // Alternate the commands when comparing, so drift hits both alike
+    for (int i = 0; i < runs && ok; i++) {
+        for (int c = 0; c < count && ok; c++) {
+            ok = bench_run(&targets[c], &stats[c]);
+        }
+    }
+    if (ok) {
+        print_results(stats, count, compare, warmup, format);
+    }
+    for (int i = 0; i < count; i++) {
+        if (targets[i].prog != NULL) {
+            release_program(targets[i].prog);
+        }
+        free(targets[i].text);
+    }
+    return ok && stats[0].failures == 0 && stats[count - 1].failures == 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "condition.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+// ############## LLM Generated Code Begins ##############
+typedef struct {
+    char** argv;
+    int argc;
+    int pos;
+    bool error;
+} test_t;
+
+static bool test_or(test_t* t);
+
+static const char* next_arg(test_t* t) {
+    return t->pos < t->argc ? t->argv[t->pos] : NULL;
+}
+
+static bool parse_number(test_t* t, const char* text, long long* value) {
+    char* end;
+    errno = 0;
+    *value = strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno != 0) {
+        fprintf(stderr, "test: %s: integer expected\n", text);
+        t->error = true;
+        return false;
+    }
+    return true;
+}
+
+static bool unary_test(char op, const char* operand) {
+    struct stat st;
+    switch (op) {
+    case 'n': return operand[0] != '\0';
+    case 'z': return operand[0] == '\0';
+    case 'e': return stat(operand, &st) == 0;
+    case 'f': return stat(operand, &st) == 0 && S_ISREG(st.st_mode);
+    case 'd': return stat(operand, &st) == 0 && S_ISDIR(st.st_mode);
+    case 's': return stat(operand, &st) == 0 && st.st_size > 0;
+    case 'r': return access(operand, R_OK) == 0;
+    case 'w': return access(operand, W_OK) == 0;
+    case 'x': return access(operand, X_OK) == 0;
+    default: return false;
+    }
+}
+
+static bool is_unary_op(const char* arg) {
+    return arg != NULL && arg[0] == '-' && arg[1] != '\0' && arg[2] == '\0' &&
+           strchr("nzefdsrwx", arg[1]) != NULL;
+}
+
+static bool is_binary_op(const char* arg) {
+    static const char* const ops[] = {"=", "==", "!=", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", NULL};
+    for (int i = 0; arg != NULL && ops[i] != NULL; i++) {
+        if (strcmp(arg, ops[i]) == 0) return true;
+    }
+    return false;
+}
+
+static bool binary_test(test_t* t, const char* left, const char* op, const char* right) {
+    if (op[0] != '-') {
+        bool equal = strcmp(left, right) == 0;
+        return op[0] == '!' ? !equal : equal;
+    }
+
+    long long l, r;
+    if (!parse_number(t, left, &l) || !parse_number(t, right, &r)) {
+        return false;
+    }
+    if (strcmp(op, "-eq") == 0) return l == r;
+    if (strcmp(op, "-ne") == 0) return l != r;
+    if (strcmp(op, "-lt") == 0) return l < r;
+    if (strcmp(op, "-le") == 0) return l <= r;
+    if (strcmp(op, "-gt") == 0) return l > r;
+    return l >= r;
+}
+
+static bool test_primary(test_t* t) {
+    const char* arg = next_arg(t);
+    if (arg == NULL) {
+        fprintf(stderr, "test: argument expected\n");
+        t->error = true;
+        return false;
+    }
+
+    if (strcmp(arg, "!") == 0) {
+        t->pos++;
+        return !test_primary(t);
+    }
+
+    // A binary operator after the argument wins, so "-n = -n" compares
+    if (t->pos + 2 < t->argc && is_binary_op(t->argv[t->pos + 1])) {
+        t->pos += 3;
+        return binary_test(t, arg, t->argv[t->pos - 2], t->argv[t->pos - 1]);
+    }
+
+    if (strcmp(arg, "(") == 0) {
+        t->pos++;
+        bool value = test_or(t);
+        if (next_arg(t) == NULL || strcmp(next_arg(t), ")") != 0) {
+            fprintf(stderr, "test: missing )\n");
+            t->error = true;
+        }
+        t->pos++;
+        return value;
+    }
+
+    if (is_unary_op(arg) && t->pos + 1 < t->argc) {
+        t->pos += 2;
+        return unary_test(arg[1], t->argv[t->pos - 1]);
+    }
+
+    // A lone string is true when it is not empty
+    t->pos++;
+    return arg[0] != '\0';
+}
+
+static bool test_and(test_t* t) {
+    bool value = test_primary(t);
+    while (!t->error && next_arg(t) != NULL && strcmp(next_arg(t), "-a") == 0) {
+        t->pos++;
+        bool right = test_primary(t);
+        value = value && right;
+    }
+    return value;
+}
+
+static bool test_or(test_t* t) {
+    bool value = test_and(t);
+    while (!t->error && next_arg(t) != NULL && strcmp(next_arg(t), "-o") == 0) {
+        t->pos++;
+        bool right = test_and(t);
+        value = value || right;
+    }
+    return value;
+}
+
+bool test_command(int argc, char** argv) {
+    test_t t = {argv + 1, argc - 1, 0, false};
+
+    // [ needs its closing ]
+    if (strcmp(argv[0], "[") == 0) {
+        if (argc < 2 || strcmp(argv[argc - 1], "]") != 0) {
+            fprintf(stderr, "[: missing ]\n");
+            return false;
+        }
+        t.argc--;
+    }
+
+    // No expression is false
+    if (t.argc == 0) {
+        return false;
+    }
+
+    bool value = test_or(&t);
+    if (!t.error && t.pos < t.argc) {
+        fprintf(stderr, "test: %s: unexpected argument\n", t.argv[t.pos]);
+        t.error = true;
+    }
+    return value && !t.error;
+}
+
+bool true_command(int argc, char** argv) {
+    return true;
+}
+
+bool false_command(int argc, char** argv) {
+    return false;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
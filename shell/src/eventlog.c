@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+#include "eventlog.h"
+#include "timers.h"
+#include "utils.h"
+#include "variables.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+// ############## LLM Generated Code Begins ##############
+
+#define EVENT_BUFFER_SIZE 65536
+#define EVENT_MAX_LINE 8192
+// Room kept after the command for the fields that follow it
+#define EVENT_TAIL_ROOM 256
+// Pending events are written this long after the first of a batch
+#define EVENT_FLUSH_DELAY 0.2
+#define EVENT_DEFAULT_ROTATE (10LL << 20)
+
+static char buffer[EVENT_BUFFER_SIZE];
+static size_t buffer_len = 0;
+static bool flush_armed = false;
+static unsigned long dropped = 0;
+
+// The sink: $EVENTLOG as last opened, its fd and the bytes in the file
+static char* target = NULL;
+static int sink_fd = -1;
+static bool sink_is_socket = false;
+static long long sink_size = 0;
+static pid_t owner = 0;
+
+double event_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void close_sink() {
+    if (sink_fd != -1) {
+        close(sink_fd);
+    }
+    sink_fd = -1;
+}
+
+static void open_sink() {
+    if (strncmp(target, "unix:", 5) == 0) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (strlen(target + 5) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "eventlog: socket path too long: %s\n", target + 5);
+            return;
+        }
+        strcpy(addr.sun_path, target + 5);
+        sink_is_socket = true;
+        sink_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (sink_fd != -1 && connect(sink_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+            close_sink();
+        }
+        return;
+    }
+
+    sink_is_socket = false;
+    sink_fd = open(target, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (sink_fd == -1) {
+        perror("eventlog: open failed");
+        return;
+    }
+    struct stat st;
+    sink_size = fstat(sink_fd, &st) == 0 ? st.st_size : 0;
+}
+
+// Follow changes to $EVENTLOG; returns whether logging is on
+static bool update_target() {
+    // A forked child must not write the shell's pending events
+    pid_t self = getpid();
+    if (owner != self) {
+        owner = self;
+        buffer_len = 0;
+        flush_armed = false;
+        sink_fd = -1;
+    }
+
+    const char* value = get_variable("EVENTLOG");
+    if (value == NULL || *value == '\0') {
+        if (target != NULL) {
+            flush_event_log();
+            close_sink();
+            free(target);
+            target = NULL;
+        }
+        return false;
+    }
+    if (target == NULL || strcmp(target, value) != 0) {
+        flush_event_log();
+        close_sink();
+        free(target);
+        target = strdup(value);
+    }
+    return target != NULL;
+}
+
+static unsigned long count_lines(const char* data, size_t len) {
+    unsigned long lines = 0;
+    const char* end = data + len;
+    while ((data = memchr(data, '\n', end - data)) != NULL) {
+        lines++;
+        data++;
+    }
+    return lines;
+}
+
+// Move a full log aside before writing len more bytes
+static void rotate_if_needed(size_t len) {
+    long long limit = EVENT_DEFAULT_ROTATE;
+    const char* value = get_variable("EVENTLOG_SIZE");
+    if (value != NULL && *value != '\0' && !parse_size(value, &limit)) {
+        limit = EVENT_DEFAULT_ROTATE;
+    }
+    if (sink_size == 0 || sink_size + (long long)len <= limit) {
+        return;
+    }
+
+    size_t path_len = strlen(target) + 3;
+    char* rotated = malloc(path_len);
+    if (rotated == NULL) {
+        return;
+    }
+    snprintf(rotated, path_len, "%s.1", target);
+    if (rename(target, rotated) == -1) {
+        perror("eventlog: rename failed");
+    }
+    free(rotated);
+    close_sink();
+    open_sink();
+}
+
+void flush_event_log() {
+    flush_armed = false;
+    if (buffer_len == 0 || target == NULL || owner != getpid()) {
+        return;
+    }
+    if (sink_fd == -1) {
+        open_sink();
+    }
+    if (sink_fd == -1) {
+        // Nobody to take them; an unreachable socket is retried next time
+        dropped += count_lines(buffer, buffer_len);
+        buffer_len = 0;
+        return;
+    }
+    if (!sink_is_socket) {
+        rotate_if_needed(buffer_len);
+    }
+
+    size_t done = 0;
+    while (done < buffer_len) {
+        ssize_t n = sink_is_socket
+                    ? send(sink_fd, buffer + done, buffer_len - done, MSG_NOSIGNAL | MSG_DONTWAIT)
+                    : write(sink_fd, buffer + done, buffer_len - done);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && errno == EAGAIN) {
+            break;
+        }
+        if (n <= 0) {
+            close_sink();
+            break;
+        }
+        done += n;
+        sink_size += n;
+    }
+
+    // A busy socket keeps the rest for the next flush
+    memmove(buffer, buffer + done, buffer_len - done);
+    buffer_len -= done;
+    if (sink_fd == -1) {
+        dropped += count_lines(buffer, buffer_len);
+        buffer_len = 0;
+    }
+}
+
+static void flush_timer(int arg) {
+    flush_event_log();
+}
+
+// Append a finished line, flushing first when the batch is full
+static void append_line(const char* line, size_t len) {
+    if (buffer_len + len > sizeof(buffer)) {
+        flush_event_log();
+    }
+    if (buffer_len + len > sizeof(buffer)) {
+        dropped++;
+        return;
+    }
+    memcpy(buffer + buffer_len, line, len);
+    buffer_len += len;
+    if (!flush_armed) {
+        flush_armed = add_timer(EVENT_FLUSH_DELAY, flush_timer, 0);
+    }
+}
+
+// Append text to line as a JSON string, cut short to leave
+// EVENT_TAIL_ROOM bytes free
+static size_t put_json_string(char* line, size_t len, size_t size, const char* text) {
+    len += snprintf(line + len, size - len, "\"");
+    for (const unsigned char* p = (const unsigned char*)text;
+         *p != '\0' && len + EVENT_TAIL_ROOM < size; p++) {
+        if (*p == '"' || *p == '\\') {
+            line[len++] = '\\';
+            line[len++] = *p;
+        } else if (*p < 0x20) {
+            len += snprintf(line + len, size - len, "\\u%04x", *p);
+        } else {
+            line[len++] = *p;
+        }
+    }
+    len += snprintf(line + len, size - len, "\"");
+    return len;
+}
+
+// Start a line with the fields every event has
+static size_t start_event(char* line, size_t size, double ts, const char* event, const job_t* job) {
+    size_t len = snprintf(line, size, "{\"ts\":%.6f,\"event\":\"%s\",\"job\":%d,\"pid\":%d,\"pgid\":%d,\"command\":",
+                          ts, event, job->job_id, (int)job->pid, (int)job->pgid);
+    return put_json_string(line, len, size, job->command ? job->command : "");
+}
+
+// Note the events lost to a full buffer or a missing reader, once there
+// is room again
+static void report_dropped() {
+    if (dropped == 0) {
+        return;
+    }
+    char line[128];
+    int len = snprintf(line, sizeof(line), "{\"ts\":%.6f,\"event\":\"dropped\",\"count\":%lu}\n",
+                       event_time(), dropped);
+    dropped = 0;
+    append_line(line, len);
+}
+
+void log_job_event(const char* event, const job_t* job) {
+    if (!update_target()) {
+        return;
+    }
+    report_dropped();
+    char line[EVENT_MAX_LINE];
+    size_t len = start_event(line, sizeof(line), event_time(), event, job);
+    len += snprintf(line + len, sizeof(line) - len, "}\n");
+    append_line(line, len);
+}
+
+void log_job_exit(const job_t* job, int status, const struct rusage* usage) {
+    if (!update_target()) {
+        return;
+    }
+    report_dropped();
+    // Background jobs carry the time the SIGCHLD handler reaped them
+    double ts = job->ended_at > 0 ? job->ended_at : event_time();
+    char line[EVENT_MAX_LINE];
+    size_t len = start_event(line, sizeof(line), ts, "exit", job);
+    int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    len += snprintf(line + len, sizeof(line) - len, ",\"status\":%d", code);
+    if (WIFSIGNALED(status)) {
+        len += snprintf(line + len, sizeof(line) - len, ",\"signal\":%d", WTERMSIG(status));
+    }
+    if (job->timed_out) {
+        len += snprintf(line + len, sizeof(line) - len, ",\"timed_out\":true");
+    }
+    if (job->started_at > 0) {
+        len += snprintf(line + len, sizeof(line) - len, ",\"elapsed\":%.6f", ts - job->started_at);
+    }
+    len += snprintf(line + len, sizeof(line) - len, ",\"utime\":%.6f,\"stime\":%.6f,\"maxrss_kb\":%ld}\n",
+                    usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6,
+                    usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6,
+                    usage->ru_maxrss);
+    append_line(line, len);
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -1,6 +1,17 @@
+#define _GNU_SOURCE
 #include "executor.h"
 #include "input.h"
 #include "intrinsics.h"
+#include "expand.h"
+#include "heredoc.h"
+#include "variables.h"
+#include "parse_cache.h"
+#include "parser.h"
+#include "vm.h"
+#include "timing.h"
+#include "timers.h"
+#include "eventlog.h"
+#include "probes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,19 +23,59 @@
 #include <signal.h>
 #include <termios.h>
 // ############## LLM Generated Code Begins ##############
+// Exit status of the last foreground command, reported by $?
+static int last_status = 0;
+
+int get_last_status() {
+    return last_status;
+}
+
+void set_last_status(int status) {
+    last_status = status;
+}
+
+// Leave a forked child. _exit skips the stdio cleanup that would rewind a
+// stdin shared with the shell, so only the output streams are flushed.
+void child_exit(int status) {
+    // Only events the child logged itself; the shell's stay with the shell
+    flush_event_log();
+    fflush(stdout);
+    fflush(stderr);
+    _exit(status);
+}
+
+// Convert a wait status to a shell exit status
+static int exit_status(int status) {
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    if (WIFSTOPPED(status)) return 128 + WSTOPSIG(status);
+    return 1;
+}
+
+// fork, timed as the spawn stage on the shell's side
+static pid_t spawn_fork() {
+    uint64_t start = probe_start();
+    pid_t pid = fork();
+    if (pid > 0) {
+        probe_end(PROBE_SPAWN, start);
+    }
+    return pid;
+}
+
 // Execute a simple command without redirection/pipes
 bool execute_simple_command(char** argv) {
-    pid_t pid = fork();
+    fflush(stdout);
+    pid_t pid = spawn_fork();
     
     if (pid == -1) {
         perror("fork failed");
         return false;
     } else if (pid == 0) {
         // Child process
-        execvp(argv[0], argv);
-        // If execvp returns, there was an error
+        exec_with_env(argv);
+        // If exec returns, there was an error
         perror("command not found");
-        exit(EXIT_FAILURE);
+        child_exit(EXIT_FAILURE);
     } else {
         // Parent process
         int status;
@@ -33,27 +84,33 @@ bool execute_simple_command(char** argv) {
     }
 }
 // Handle input redirection
-bool setup_input_redirection(char** argv) {
-    // Find the < symbol
-    int i;
-    for (i = 0; argv[i] != NULL; i++) {
-        if (strcmp(argv[i], "<") == 0)
-            break;
-    }
-    
-    // No input redirection
-    if (argv[i] == NULL) return true;
-    
-    // Make sure there's a file specified
-    if (argv[i+1] == NULL) {
-        fprintf(stderr, "No input file specified\n");
-        return false;
-    }
-    
-    // Open the file
-    int fd = open(argv[i+1], O_RDONLY);
-    if (fd == -1) {
-        perror("No such file or directory");
+bool setup_input_redirection(token_type_t type, const char* target) {
+    int fd;
+    if (type == TOK_HERESTRING) {
+        // The word plus a trailing newline becomes the command's input
+        size_t len = strlen(target);
+        char* data = malloc(len + 1);
+        if (data == NULL) {
+            perror("malloc failed");
+            return false;
+        }
+        memcpy(data, target, len);
+        data[len] = '\n';
+        fd = heredoc_create(data, len + 1);
+        free(data);
+        if (fd == -1) {
+            return false;
+        }
+    } else if (type == TOK_LT) {
+        // Open the file
+        fd = open(target, O_RDONLY);
+        if (fd == -1) {
+            perror("No such file or directory");
+            return false;
+        }
+    } else {
+        // Here-documents are collected from the terminal before execution
+        fprintf(stderr, "Here-document not available here\n");
         return false;
     }
     
@@ -65,39 +122,19 @@ bool setup_input_redirection(char** argv) {
     }
     
     close(fd);
-    
-    // Remove the < and filename from argv
-    argv[i] = NULL;  // Terminate the command here
-    
     return true;
 }
 // Handle output redirection
-bool setup_output_redirection(char** argv) {
-    // Check for > and >> symbols
-    int i;
-    for (i = 0; argv[i] != NULL; i++) {
-        if (strcmp(argv[i], ">") == 0 || strcmp(argv[i], ">>") == 0)
-            break;
-    }
-    
-    // No output redirection
-    if (argv[i] == NULL) return true;
-    
-    // Make sure there's a file specified
-    if (argv[i+1] == NULL) {
-        fprintf(stderr, "No output file specified\n");
-        return false;
-    }
-    
+bool setup_output_redirection(token_type_t type, const char* target) {
     // Determine if appending
-    bool append = (strcmp(argv[i], ">>") == 0);
+    bool append = (type == TOK_DGT);
     
     // Open the file
     int flags = O_WRONLY | O_CREAT;
     if (append) flags |= O_APPEND;
     else flags |= O_TRUNC;
     
-    int fd = open(argv[i+1], flags, 0644);
+    int fd = open(target, flags, 0644);
     if (fd == -1) {
         perror("Cannot open output file");
         return false;
@@ -111,45 +148,200 @@ bool setup_output_redirection(char** argv) {
     }
     
     close(fd);
-    
-    // Remove the > and filename from argv
-    argv[i] = NULL;  // Terminate the command here
     return true;
 }
-// Execute a pipeline of commands
-bool execute_pipeline(char* command){
+// Apply every redirection of a command in the order written
+static bool apply_redirections(const expanded_cmd_t* cmd) {
+    for (int i = 0; i < cmd->redir_count; i++) {
+        const redirection_t* r = &cmd->redirs[i];
+        bool ok = (r->type == TOK_GT || r->type == TOK_DGT)
+                      ? setup_output_redirection(r->type, r->target)
+                      : setup_input_redirection(r->type, r->target);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+// Check whether a command redirects stdin (input) or stdout
+static bool has_redirection(const expanded_cmd_t* cmd, bool input) {
+    for (int i = 0; i < cmd->redir_count; i++) {
+        bool is_output = cmd->redirs[i].type == TOK_GT || cmd->redirs[i].type == TOK_DGT;
+        if (is_output != input) {
+            return true;
+        }
+    }
+    return false;
+}
+// Set the leading NAME=value words and drop them from argv
+static void apply_assignments(expanded_cmd_t* cmd, bool exported) {
+    for (int i = 0; i < cmd->assignments; i++) {
+        char* eq = strchr(cmd->argv[i], '=');
+        *eq = '\0';
+        set_variable(cmd->argv[i], eq + 1, exported);
+        *eq = '=';
+    }
 
-    int pipe_count = 0;
-    for (char* p = command; *p; p++) {
-        if (*p == '|') pipe_count++;
+    memmove(cmd->argv, cmd->argv + cmd->assignments,
+            (cmd->argc - cmd->assignments + 1) * sizeof(char*));
+    cmd->argc -= cmd->assignments;
+    cmd->assignments = 0;
+}
+// Run an intrinsic with its redirections, restoring stdin/stdout
+// afterwards; returns its exit status
+static int run_intrinsic(expanded_cmd_t* cmd) {
+    if (cmd->redir_count == 0) {
+        return run_intrinsic_status(cmd->argv[0], cmd->argc, cmd->argv);
+    }
+
+    int saved_in = dup(STDIN_FILENO);
+    int saved_out = dup(STDOUT_FILENO);
+
+    fflush(stdout);
+    int result = apply_redirections(cmd) ? run_intrinsic_status(cmd->argv[0], cmd->argc, cmd->argv)
+                                         : EXIT_FAILURE;
+    fflush(stdout);
+
+    if (saved_in != -1) {
+        dup2(saved_in, STDIN_FILENO);
+        close(saved_in);
+    }
+    if (saved_out != -1) {
+        dup2(saved_out, STDOUT_FILENO);
+        close(saved_out);
+    }
+    return result;
+}
+// Split a command in place at the pipes between its stages. The
+// redirections after a compound stage are copied to redirs[i], and the
+// stage text is cut before them; redirs[i] is NULL for other stages.
+static bool split_pipeline(char* command, const token_list_t* tokens, int stage_count,
+                           const int* pipes, const int* redirects, char** commands, char** redirs) {
+    for (int i = 0; i < stage_count; i++) {
+        commands[i] = i == 0 ? command : command + tokens->tokens[pipes[i - 1]].offset + 1;
+        redirs[i] = NULL;
+    }
+    for (int i = 0; i < stage_count - 1; i++) {
+        command[tokens->tokens[pipes[i]].offset] = '\0';
+    }
+
+    for (int i = 0; i < stage_count; i++) {
+        if (redirects[i] < 0) {
+            continue;
+        }
+        if (redirects[i] < tokens->count && (i == stage_count - 1 || redirects[i] < pipes[i])) {
+            char* at = command + tokens->tokens[redirects[i]].offset;
+            if ((redirs[i] = strdup(at)) == NULL) {
+                perror("strdup failed");
+                return false;
+            }
+            *at = '\0';
+        }
+    }
+    return true;
+}
+
+// Run a compound stage of a pipeline in this process: apply its
+// redirections, then parse and run the compound command itself
+static int run_compound_stage(const char* body, const char* redirs) {
+    // Commands of the stage take the terminal and give it back from a
+    // process group that no longer has it
+    signal(SIGTTOU, SIG_IGN);
+    if (redirs != NULL) {
+        expanded_cmd_t cmd;
+        if (!expand_simple_command(redirs, &cmd)) {
+            return EXIT_FAILURE;
+        }
+        bool ok = apply_redirections(&cmd);
+        free_expanded_cmd(&cmd);
+        if (!ok) {
+            return EXIT_FAILURE;
+        }
+    }
+    execute_command(body);
+    fflush(stdout);
+    return get_last_status();
+}
+
+// Execute a pipeline of commands and return the status of the last one
+int execute_pipeline(char* command){
+
+    token_list_t tokens = {NULL, 0, 0};
+    if (!lex_cached(command, strlen(command), &tokens)) {
+        fprintf(stderr, "Unterminated quote\n");
+        free_tokens(&tokens);
+        return EXIT_FAILURE;
+    }
+    // A pipe inside a compound stage belongs to that stage
+    int* pipe_at = malloc((tokens.count + 1) * sizeof(int));
+    int* redirects = malloc((tokens.count + 1) * sizeof(int));
+    int stage_count = pipe_at && redirects ? pipeline_stages(command, &tokens, pipe_at, redirects) : 0;
+    if (stage_count == 0) {
+        fprintf(stderr, "Invalid Syntax!\n");
+        free(pipe_at);
+        free(redirects);
+        free_tokens(&tokens);
+        return EXIT_FAILURE;
+    }
+    int pipe_count = stage_count - 1;
+
+    if (pipe_count == 0 && redirects[0] >= 0) {
+        char* body = strdup(command);
+        char** redirs = malloc(sizeof(char*));
+        int status = EXIT_FAILURE;
+        if (body != NULL && redirs != NULL &&
+            split_pipeline(body, &tokens, 1, pipe_at, redirects, &body, redirs)) {
+            status = run_compound_stage(body, redirs[0]);
+            free(redirs[0]);
+        }
+        free(body);
+        free(redirs);
+        free(pipe_at);
+        free(redirects);
+        free_tokens(&tokens);
+        return status;
     }
 
     if (pipe_count == 0) {
+        free(pipe_at);
+        free(redirects);
+        free_tokens(&tokens);
+
         // No pipes, just a simple command
-        char* argv[MAX_INPUT_SIZE / 2];
-        int argc = 0;
+        expanded_cmd_t cmd;
+        if (!expand_simple_command(command, &cmd)) {
+            return EXIT_FAILURE;
+        }
 
-        char* input_copy = strdup(command);
-        split_command(input_copy, argv, &argc);
+        // Prefix assignments are exported to the command run here
+        apply_assignments(&cmd, true);
+        if (cmd.argc == 0) {
+            bool ok = apply_redirections(&cmd);
+            free_expanded_cmd(&cmd);
+            return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
 
-        if (argc == 0) {
-            free(input_copy);
-            return true;
+        // Functions run here, in the job's process
+        int status;
+        if (vm_call_function(cmd.argc, cmd.argv, &status)) {
+            free_expanded_cmd(&cmd);
+            return status;
         }
 
         // Check for intrinsics first
-        if (is_intrinsic(argv[0])) {
-            bool result = execute_intrinsic(argv[0], argc, argv);
-            free(input_copy);
-            return result;
+        if (is_intrinsic(cmd.argv[0])) {
+            int status = run_intrinsic(&cmd);
+            free_expanded_cmd(&cmd);
+            return status;
         }
 
         // Otherwise fork and exec
-        pid_t pid = fork();
+        fflush(stdout);
+        pid_t pid = spawn_fork();
         if (pid == -1) {
             perror("fork failed");
-            free(input_copy);
-            return false;
+            free_expanded_cmd(&cmd);
+            return EXIT_FAILURE;
         } else if (pid == 0) {
             signal(SIGINT, SIG_DFL);
             signal(SIGQUIT, SIG_DFL);
@@ -158,39 +350,39 @@ bool execute_pipeline(char* command){
             signal(SIGTTOU, SIG_DFL);
             signal(SIGCHLD, SIG_DFL);
             
-            // Create a new process group if this is first command in pipeline
-            if (!setup_input_redirection(argv) || !setup_output_redirection(argv)) {
-                exit(EXIT_FAILURE);
+            if (!apply_redirections(&cmd)) {
+                child_exit(EXIT_FAILURE);
             }
 
-            execvp(argv[0], argv);
+            exec_with_env(cmd.argv);
             perror("command not found");
-            exit(EXIT_FAILURE);
+            child_exit(127);
         } else {
             // Parent process
             int status;
             waitpid(pid, &status, 0);
-            free(input_copy);
-            return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            free_expanded_cmd(&cmd);
+            return exit_status(status);
         }
     }
 
     // Multiple commands with pipes
-    char** commands = malloc((pipe_count + 1) * sizeof(char*));
-    if (!commands) {
-        perror("malloc failed");
-        return false;
-    }
-
-    // Split the command by pipes
+    int cmd_count = stage_count;
+    char** commands = malloc(cmd_count * sizeof(char*));
+    char** redirs = malloc(cmd_count * sizeof(char*));
     char* cmd_copy = strdup(command);
-    char* token = strtok(cmd_copy, "|");
-    int cmd_count = 0;
-
-    while (token != NULL && cmd_count <= pipe_count) {
-        commands[cmd_count++] = token;
-        token = strtok(NULL, "|");
+    if (!commands || !redirs || !cmd_copy ||
+        !split_pipeline(cmd_copy, &tokens, cmd_count, pipe_at, redirects, commands, redirs)) {
+        perror("malloc failed");
+        free(commands);
+        free(redirs);
+        free(cmd_copy);
+        free(pipe_at);
+        free(redirects);
+        free_tokens(&tokens);
+        return EXIT_FAILURE;
     }
+    free_tokens(&tokens);
 
     // Create pipes
     int** pipes = malloc(pipe_count * sizeof(int*));
@@ -204,8 +396,11 @@ bool execute_pipeline(char* command){
             }
             free(pipes);
             free(commands);
+            free(redirs);
             free(cmd_copy);
-            return false;
+            free(pipe_at);
+            free(redirects);
+            return EXIT_FAILURE;
         }
     }
 
@@ -213,37 +408,49 @@ bool execute_pipeline(char* command){
     pid_t* pids = malloc(cmd_count * sizeof(pid_t));
 
     for (int i = 0; i < cmd_count; i++) {
-        char* argv[MAX_INPUT_SIZE / 2];
-        int argc = 0;
-        split_command(commands[i], argv, &argc);
-
-        if (argc == 0) continue;
+        expanded_cmd_t cmd;
+        bool compound = redirects[i] >= 0;
+        if (compound) {
+            memset(&cmd, 0, sizeof(cmd));
+        } else if (!expand_simple_command(commands[i], &cmd)) {
+            pids[i] = -1;
+            continue;
+        }
 
-        pids[i] = fork();
+        fflush(stdout);
+        pids[i] = spawn_fork();
+        if (pids[i] != 0 && !compound) {
+            free_expanded_cmd(&cmd);
+        }
         if (pids[i] == -1) {
             perror("fork failed");
             continue;
-        } else if (pids[i] == 0) {
-            // First check if command has input/output redirection
-            bool has_input_redir = false, has_output_redir = false;
-            for (int k = 0; argv[k] != NULL; k++) {
-                if (strcmp(argv[k], "<") == 0) has_input_redir = true;
-                if (strcmp(argv[k], ">") == 0 || strcmp(argv[k], ">>") == 0) has_output_redir = true;
+        } else if (pids[i] == 0 && compound) {
+            // A compound stage's own redirections win over the pipes
+            if ((i > 0 && dup2(pipes[i-1][0], STDIN_FILENO) == -1) ||
+                (i < cmd_count - 1 && dup2(pipes[i][1], STDOUT_FILENO) == -1)) {
+                perror("dup2 failed");
+                child_exit(EXIT_FAILURE);
             }
-
+            for (int j = 0; j < pipe_count; j++) {
+                close(pipes[j][0]);
+                close(pipes[j][1]);
+            }
+            child_exit(run_compound_stage(commands[i], redirs[i]));
+        } else if (pids[i] == 0) {
             // If no input redirection, and not the first command, use pipe input
-            if (!has_input_redir && i > 0) {
+            if (!has_redirection(&cmd, true) && i > 0) {
                 if (dup2(pipes[i-1][0], STDIN_FILENO) == -1) {
                     perror("dup2 failed");
-                    exit(EXIT_FAILURE);
+                    child_exit(EXIT_FAILURE);
                 }
             }
 
             // If no output redirection, and not the last command, use pipe output
-            if (!has_output_redir && i < cmd_count - 1) {
+            if (!has_redirection(&cmd, false) && i < cmd_count - 1) {
                 if (dup2(pipes[i][1], STDOUT_FILENO) == -1) {
                     perror("dup2 failed");
-                    exit(EXIT_FAILURE);
+                    child_exit(EXIT_FAILURE);
                 }
             }
 
@@ -254,13 +461,30 @@ bool execute_pipeline(char* command){
             }
 
             // Now handle explicit redirections if present
-            if (!setup_input_redirection(argv) || !setup_output_redirection(argv)) {
-                exit(EXIT_FAILURE);
+            if (!apply_redirections(&cmd)) {
+                child_exit(EXIT_FAILURE);
+            }
+
+            apply_assignments(&cmd, true);
+            if (cmd.argc == 0) {
+                child_exit(EXIT_SUCCESS);
             }
 
-            execvp(argv[0], argv);
+            // Functions and intrinsics in a pipeline run inside its child
+            int status;
+            if (vm_call_function(cmd.argc, cmd.argv, &status)) {
+                fflush(stdout);
+                child_exit(status);
+            }
+            if (is_intrinsic(cmd.argv[0])) {
+                int status = run_intrinsic_status(cmd.argv[0], cmd.argc, cmd.argv);
+                fflush(stdout);
+                child_exit(status);
+            }
+
+            exec_with_env(cmd.argv);
             perror("command not found");
-            exit(EXIT_FAILURE);
+            child_exit(127);
         }
     }
 
@@ -272,234 +496,279 @@ bool execute_pipeline(char* command){
     }
     free(pipes);
 
-    // Parent waits for all children
+    // Parent waits for all children; the last one decides the status
+    int result = EXIT_FAILURE;
     for (int i = 0; i < cmd_count; i++) {
         int status;
-        waitpid(pids[i], &status, 0);
+        if (pids[i] > 0 && waitpid(pids[i], &status, 0) > 0 && i == cmd_count - 1) {
+            result = exit_status(status);
+        }
     }
 
     free(pids);
+    for (int i = 0; i < cmd_count; i++) {
+        free(redirs[i]);
+    }
+    free(redirs);
     free(commands);
     free(cmd_copy);
+    free(pipe_at);
+    free(redirects);
 
-    return true;
+    return result;
 }
 
-// Main execution function
-bool execute_command(const char* command) {
-    char* cmd_copy = strdup(command);
-    bool final_result = true;
-    
-    // Keep track of our position in the string
-    char* current_pos = cmd_copy;
-    char* cmd_start = current_pos;
-    bool in_quotes = false;
-    
-    // Process the command string character by character
-    while (*current_pos) {
-        // Handle quotes to prevent splitting inside quoted strings
-        if (*current_pos == '"' || *current_pos == '\'') {
-            in_quotes = !in_quotes;
-            current_pos++;
+// Run a command inside the shell process when it must change shell state:
+// intrinsics, and lines made only of NAME=value words. Returns false when
+// the command has to fork, and otherwise sets its exit status.
+static bool run_in_shell(const char* command, int* status) {
+    token_list_t tokens = {NULL, 0, 0};
+    if (!lex_cached(command, strlen(command), &tokens)) {
+        free_tokens(&tokens);
+        return false;
+    }
+
+    bool intrinsic = false;
+    bool assignments_only = tokens.count > 0;
+    for (int i = 0; i < tokens.count; i++) {
+        token_t* tok = &tokens.tokens[i];
+        if (tok->type != TOK_WORD) {
+            // Pipelines fork; redirections only stay in-shell for intrinsics
+            assignments_only = false;
+            if (tok->type == TOK_PIPE) {
+                intrinsic = false;
+                break;
+            }
             continue;
         }
+
+        if (i == 0) {
+            char* name = dequote_word(command + tok->offset, tok->length);
+            intrinsic = name != NULL && is_intrinsic(name);
+            free(name);
+        }
+        if (!is_assignment(command + tok->offset)) {
+            assignments_only = false;
+        }
+    }
+    free_tokens(&tokens);
+
+    if (!intrinsic && !assignments_only) {
+        return false;
+    }
+
+    // Intrinsics and assignments run in the shell itself, so expand here
+    take_substitution_status();
+    expanded_cmd_t cmd;
+    if (!expand_simple_command(command, &cmd)) {
+        *status = EXIT_FAILURE;
+        return true;
+    }
+
+    if (intrinsic) {
+        *status = cmd.argc > 0 ? run_intrinsic(&cmd) : EXIT_FAILURE;
+    } else {
+        apply_assignments(&cmd, false);
+        // Without a command the line exits as its last substitution did
+        int captured = take_substitution_status();
+        *status = captured >= 0 ? captured : EXIT_SUCCESS;
+    }
+    free_expanded_cmd(&cmd);
+    return true;
+}
+
+// Reset the signals the shell handles before running a job's code
+static void reset_child_signals() {
+    signal(SIGTSTP, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGQUIT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGTTIN, SIG_DFL);
+    signal(SIGTTOU, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+
+    // The parent blocks SIGCHLD around foreground waits
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &chld, NULL);
+}
+
+void block_sigchld(sigset_t* old_mask) {
+    sigset_t chld;
+    sigemptyset(&chld);
+    sigaddset(&chld, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &chld, old_mask);
+}
+
+pid_t spawn_job(const char* command, const job_t* job, bool foreground) {
+    fflush(stdout);
+    pid_t pid = spawn_fork();
+
+    if (pid == -1) {
+        perror("fork failed");
+        return -1;
+    } else if (pid == 0) {
+        reset_child_signals();
         
-        // Only process separators if not in quotes
-        if (!in_quotes && (*current_pos == ';' || *current_pos == '&')) {
-            // Found a separator - null terminate this command
-            char separator = *current_pos;
-            *current_pos = '\0';
-            
-            // Trim trailing whitespace
-            char* end = current_pos - 1;
-            while (end >= cmd_start && isspace(*end)) {
-                *end = '\0';
-                end--;
-            }
-            
-            // Execute the command if it's not empty
-            if (*cmd_start != '\0') {
-                bool background = (separator == '&');
-                
-                if (background) {
-                    pid_t pid = fork();
-                    
-                    if (pid == -1) {
-                        perror("fork failed");
-                        final_result = false;
-                    } else if (pid == 0) {
-                        // Child process
-                        
-                        // Reset signal handlers to default behavior 
-                        signal(SIGINT, SIG_DFL);
-                        signal(SIGQUIT, SIG_DFL);
-                        signal(SIGTSTP, SIG_DFL);
-                        signal(SIGTTIN, SIG_DFL);
-                        signal(SIGTTOU, SIG_DFL);
-                        signal(SIGCHLD, SIG_DFL);
-                        
-                        // Create a new process group
-                        setpgid(0, 0);
-                        
-                        // Redirect stdin to /dev/null for background processes
-                        int dev_null = open("/dev/null", O_RDONLY);
-                        if (dev_null != -1) {
-                            dup2(dev_null, STDIN_FILENO);
-                            close(dev_null);
-                        }
-                        
-                        // Execute the command
-                        execute_pipeline(cmd_start);
-                        exit(EXIT_SUCCESS);
-                    } else {
-                        // Parent process - register background job
-                        add_job(pid, cmd_start, true);
-                    }
-                } else {
-                    // Foreground execution
-                    pid_t pid = fork();
-    
-                    if (pid == -1) {
-                        perror("fork failed");
-                        final_result = false;
-                    } else if (pid == 0) {
-                        // Child process
-                        signal(SIGTSTP, SIG_DFL);
-                        signal(SIGINT, SIG_DFL);
-                        signal(SIGQUIT, SIG_DFL);
-                        signal(SIGTTIN, SIG_DFL);
-                        signal(SIGTTOU, SIG_DFL);
-                        // Create a new process group
-                        setpgid(0, 0);
-                        
-                        // Execute the command
-                        execute_pipeline(cmd_start);
-                        exit(EXIT_SUCCESS);
-                    } else {
-                        // Parent process
-                        setpgid(pid, pid);
-                        // Set the child as a foreground job
-                        int job_id = add_job(pid, cmd_start,false);
-                        set_foreground_job(job_id);
-                        
-                        // Give terminal control to the child process group
-                        tcsetpgrp(STDIN_FILENO, getpgid(pid));
-                        
-                        // Wait for the process to complete or stop
-                        int status;
-                        waitpid(pid, &status, WUNTRACED);
-                        
-                        // Take terminal control back
-                        tcsetpgrp(STDIN_FILENO, getpgrp());
-                        
-                        // Check if the process was stopped
-                        if (WIFSTOPPED(status)) {
-                            // Update the job state to stopped
-                            job_t* job = find_job_by_pid(pid);
-                            if (job) {
-                                job->state = JOB_STOPPED;
-                                printf("[%d] Stopped %s\n", job->job_id, job->command);
-                                // fprintf(stderr, "Process %d was stopped with status %d\n", 
-                                    // (int)pid, WSTOPSIG(status);
-                            }
-                        } else {
-                            // Process completed, clear the job
-                            job_t* job = find_job_by_pid(pid);
-                            if (job) {
-                                job->completed = true;
-                                free(job->command);
-                                job->job_id = 0;
-                                job->pid = 0;
-                                job->command = NULL;
-                            }
-                        }
-                        
-                        // Clear foreground job
-                        clear_foreground_job();
-                    }
-                    // if (!execute_pipeline(cmd_start)) {
-                    //     final_result = false;
-                    // }
-                }
+        // Create a new process group
+        setpgid(0, 0);
+        apply_job_sched(job);
+        apply_job_limits(&job->limits, job->cgroup);
+        
+        // Redirect stdin to /dev/null for background processes
+        if (!foreground) {
+            int dev_null = open("/dev/null", O_RDONLY);
+            if (dev_null != -1) {
+                dup2(dev_null, STDIN_FILENO);
+                close(dev_null);
             }
-            
-            // Move to the next command
-            current_pos++;
-            cmd_start = current_pos;
-        } else {
-            current_pos++;
         }
+        // Spooled jobs write both streams into the shell's pipe
+        if (job->spool != NULL) {
+            dup2(job->spool->write_fd, STDOUT_FILENO);
+            dup2(job->spool->write_fd, STDERR_FILENO);
+        }
+        
+        // Execute the command
+        char* copy = strdup(command);
+        child_exit(copy ? execute_pipeline(copy) : EXIT_FAILURE);
+    }
+
+    return pid;
+}
+
+// Submit a command as a background job
+int run_background(char* command) {
+    return submit_background(command) == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// Make a forked child the foreground job and wait for it to finish or
+// stop, then restore the signal mask saved by block_sigchld
+static int wait_foreground(pid_t pid, const char* command, const sigset_t* old_mask) {
+    uint64_t waited = probe_start();
+    setpgid(pid, pid);
+    // Set the child as a foreground job
+    int job_id = add_job(pid, command, false);
+    set_foreground_job(job_id);
+    job_t* job = find_job_by_id(job_id);
+    if (job != NULL) {
+        log_job_event("spawn", job);
+    }
+    
+    // Give terminal control to the child process group
+    tcsetpgrp(STDIN_FILENO, getpgid(pid));
+    
+    // Wait for the process to complete or stop
+    int status = 0;
+    struct rusage usage;
+    memset(&usage, 0, sizeof(usage));
+    if (wait_with_timers(pid, &status, WUNTRACED, &usage) == pid && !WIFSTOPPED(status)) {
+        note_child_usage(&usage);
     }
+    sigprocmask(SIG_SETMASK, old_mask, NULL);
     
-    // Handle the last command (if any)
-    if (*cmd_start != '\0') {
-        // Trim trailing whitespace
-        char* end = current_pos - 1;
-        while (end >= cmd_start && isspace(*end)) {
-            *end = '\0';
-            end--;
+    // Take terminal control back
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+    
+    job = find_job_by_pid(pid);
+    if (WIFSTOPPED(status)) {
+        // Update the job state to stopped
+        if (job) {
+            job->state = JOB_STOPPED;
+            log_job_event("stop", job);
+            printf("[%d] Stopped %s\n", job->job_id, job->command);
         }
+    } else if (job) {
+        // Process completed, clear the job
+        log_job_exit(job, status, &usage);
+        remove_job(job);
+    }
+    
+    // Clear foreground job
+    clear_foreground_job();
+
+    // A job killed by Ctrl+C also stops any loop that started it
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT) {
+        vm_interrupted = 1;
+    }
+    
+    probe_end(PROBE_WAIT, waited);
+
+    // A stopped job counts as success so the command line carries on
+    return WIFSTOPPED(status) ? EXIT_SUCCESS : exit_status(status);
+}
+
+// Run a command in the foreground and wait for it to finish or stop
+int run_foreground(char* command) {
+    int in_shell_status;
+    if (run_in_shell(command, &in_shell_status)) {
+        return in_shell_status;
+    }
+    
+    fflush(stdout);
+    sigset_t old_mask;
+    block_sigchld(&old_mask);
+    pid_t pid = spawn_fork();
+
+    if (pid == -1) {
+        perror("fork failed");
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        return EXIT_FAILURE;
+    } else if (pid == 0) {
+        // Child process
+        reset_child_signals();
+        // Create a new process group
+        setpgid(0, 0);
         
-        // Execute in foreground (no separator at the end)
-        pid_t pid = fork();
+        // Execute the command
+        child_exit(execute_pipeline(command));
+    }
+    
+    return wait_foreground(pid, command, &old_mask);
+}
 
-        if (pid == -1) {
-            perror("fork failed");
-            final_result = false;
-        } else if (pid == 0) {
-            // Child process
-            signal(SIGTSTP, SIG_DFL);
-            signal(SIGINT, SIG_DFL);
-            signal(SIGQUIT, SIG_DFL);
-            signal(SIGTTIN, SIG_DFL);
-            signal(SIGTTOU, SIG_DFL);
-            // Create a new process group
-            setpgid(0, 0);
-            
-            // Execute the command
-            execute_pipeline(cmd_start);
-            exit(EXIT_SUCCESS);
+int run_argv_foreground(const char* command, char** argv, const char* path) {
+    fflush(stdout);
+    sigset_t old_mask;
+    block_sigchld(&old_mask);
+    pid_t pid = spawn_fork();
+
+    if (pid == -1) {
+        perror("fork failed");
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        return EXIT_FAILURE;
+    } else if (pid == 0) {
+        reset_child_signals();
+        setpgid(0, 0);
+
+        // The program is exec'd straight from this child, with no
+        // intermediate shell process to expand the line again
+        if (path != NULL) {
+            exec_file(path, argv);
         } else {
-            // Parent process
-            setpgid(pid, pid);
-            // Set the child as a foreground job
-            int job_id = add_job(pid, cmd_start,false);
-            set_foreground_job(job_id);
-            
-            // Give terminal control to the child process group
-            tcsetpgrp(STDIN_FILENO, getpgid(pid));
-            
-            // Wait for the process to complete or stop
-            int status;
-            waitpid(pid, &status, WUNTRACED);
-            
-            tcsetpgrp(STDIN_FILENO, getpgrp());
-            
-            if (WIFSTOPPED(status)) {
-                // Update the job state to stopped
-                job_t* job = find_job_by_pid(pid);
-                if (job) {
-                    job->state = JOB_STOPPED;
-                    printf("[%d] Stopped %s\n", job->job_id, job->command);
-                }
-            } else {
-                // Process completed, clear the job
-                job_t* job = find_job_by_pid(pid);
-                if (job) {
-                    job->completed = true;
-                    free(job->command);
-                    job->job_id = 0;
-                    job->pid = 0;
-                    job->command = NULL;
-                }
-            }
-            
-            // Clear foreground job
-            clear_foreground_job();
+            exec_with_env(argv);
         }
+        perror("command not found");
+        child_exit(127);
     }
-    
-    free(cmd_copy);
-    return final_result;
+
+    return wait_foreground(pid, command, &old_mask);
+}
+
+// Main execution function
+bool execute_command(const char* command) {
+    program_t* prog = NULL;
+    parse_status_t parsed = parse_script(command, &prog);
+    if (parsed != PARSE_OK) {
+        fprintf(stderr, parsed == PARSE_INCOMPLETE ? "Unexpected end of command\n"
+                                                   : "Invalid Syntax!\n");
+        set_last_status(2);
+        return false;
+    }
+
+    int status = vm_run(prog);
+    release_program(prog);
+    return status == 0;
 }
 // ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,639 @@
+#include "expand.h"
+#include "parse_cache.h"
+#include "executor.h"
+#include "variables.h"
+#include "wildcard.h"
+#include "arith.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+// ############## LLM Generated Code Begins ##############
+// Minimum free space kept at the tail of a capture buffer so every read()
+// can pull a large chunk straight from the pipe
+#define CAPTURE_CHUNK 65536
+
+// Exit status of the last command substitution, -1 once taken
+static int substitution_status = -1;
+
+bool capture_reserve(capture_buf_t* buf, size_t extra) {
+    if (buf->cap - buf->len >= extra) {
+        return true;
+    }
+
+    // Word buffers start small; captures ask for a whole chunk anyway
+    size_t cap = buf->cap ? buf->cap : 64;
+    while (cap - buf->len < extra) {
+        cap *= 2;
+    }
+
+    char* data = realloc(buf->data, cap);
+    if (data == NULL) {
+        perror("realloc failed");
+        return false;
+    }
+
+    buf->data = data;
+    buf->cap = cap;
+    return true;
+}
+
+bool capture_append(capture_buf_t* buf, const char* src, size_t n) {
+    if (!capture_reserve(buf, n + 1)) {
+        return false;
+    }
+    memcpy(buf->data + buf->len, src, n);
+    buf->len += n;
+    return true;
+}
+
+bool capture_command(const char* command, capture_buf_t* buf) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe failed");
+        return false;
+    }
+
+    // Keep the SIGCHLD handler from reaping the child before we wait for it
+    sigset_t block, old_mask;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &old_mask);
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork failed");
+        close(fds[0]);
+        close(fds[1]);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        return false;
+    } else if (pid == 0) {
+        // Child process - run the command with stdout feeding the pipe
+        signal(SIGCHLD, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        close(fds[0]);
+        if (dup2(fds[1], STDOUT_FILENO) == -1) {
+            perror("dup2 failed");
+            child_exit(EXIT_FAILURE);
+        }
+        close(fds[1]);
+
+        execute_command(command);
+        child_exit(get_last_status());
+    }
+
+    // Parent process - read straight into the tail of the buffer
+    close(fds[1]);
+    size_t start = buf->len;
+    bool ok = true;
+
+    while (1) {
+        if (!capture_reserve(buf, CAPTURE_CHUNK)) {
+            ok = false;
+            break;
+        }
+
+        ssize_t n = read(fds[0], buf->data + buf->len, buf->cap - buf->len - 1);
+        if (n > 0) {
+            buf->len += n;
+        } else if (n == 0) {
+            break;
+        } else if (errno != EINTR) {
+            perror("read failed");
+            ok = false;
+            break;
+        }
+    }
+
+    close(fds[0]);
+
+    int status;
+    while (waitpid(pid, &status, 0) == -1) {
+        if (errno != EINTR) {
+            perror("waitpid failed");
+            status = EXIT_FAILURE << 8;
+            break;
+        }
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    substitution_status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+
+    // Trailing newlines of the output are dropped, as in other shells
+    while (buf->len > start && buf->data[buf->len - 1] == '\n') {
+        buf->len--;
+    }
+
+    return ok;
+}
+
+int take_substitution_status() {
+    int status = substitution_status;
+    substitution_status = -1;
+    return status;
+}
+
+bool word_list_add(word_list_t* list, const char* word, size_t len) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 16;
+        size_t* offsets = realloc(list->offsets, cap * sizeof(size_t));
+        if (offsets == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        list->offsets = offsets;
+        list->cap = cap;
+    }
+
+    size_t offset = list->text.len;
+    if (!capture_append(&list->text, word, len) || !capture_append(&list->text, "", 1)) {
+        return false;
+    }
+    list->offsets[list->count++] = offset;
+    return true;
+}
+
+void free_word_list(word_list_t* list) {
+    free(list->text.data);
+    free(list->offsets);
+    memset(list, 0, sizeof(*list));
+}
+
+// Builds the fields of one word. In splitting mode the field text is kept
+// in glob-pattern form: quoted or escaped *, ?, [ and \ are prefixed with a
+// backslash so only unquoted wildcards take effect.
+typedef struct {
+    word_list_t* out;
+    capture_buf_t field;
+    bool active;           // A field exists, even if it is empty ("")
+    bool wild;             // Field contains an unquoted wildcard
+    bool split;            // Field splitting and globbing are enabled
+    bool at_empty;         // "$@" with no parameters: the field may vanish
+    dir_cache_t** glob_cache;
+    const char* ifs;
+    unsigned char classes[256];  // BYTE_* flags of each byte, when splitting
+} field_builder_t;
+
+#define BYTE_IFS 1   // Ends a field in an unquoted expansion
+#define BYTE_GLOB 2  // Gets an escape or marks the field as a pattern
+
+static bool put_char(field_builder_t* fb, char c, bool quoted) {
+    fb->active = true;
+    if (fb->split) {
+        if (c == '\\' || (quoted && (c == '*' || c == '?' || c == '['))) {
+            if (!capture_append(&fb->field, "\\", 1)) return false;
+        } else if (c == '*' || c == '?' || c == '[') {
+            fb->wild = true;
+        }
+    }
+    return capture_append(&fb->field, &c, 1);
+}
+
+// Length of the run at text with no byte of the stop classes
+static size_t plain_span(const field_builder_t* fb, const char* text, size_t len, unsigned char stop) {
+    size_t n = 0;
+    while (n < len && !(fb->classes[(unsigned char)text[n]] & stop)) n++;
+    return n;
+}
+
+// Append text as put_char would, copying the runs without wildcards or
+// backslashes in one go
+static bool put_text(field_builder_t* fb, const char* text, size_t len, bool quoted) {
+    fb->active = true;
+    if (!fb->split) {
+        return capture_append(&fb->field, text, len);
+    }
+    size_t i = 0;
+    while (i < len) {
+        size_t run = plain_span(fb, text + i, len - i, BYTE_GLOB);
+        if (!capture_append(&fb->field, text + i, run)) return false;
+        i += run;
+        if (i < len && !put_char(fb, text[i++], quoted)) return false;
+    }
+    return true;
+}
+
+// Drop the escapes added by put_char
+static size_t unescape_field(char* text, size_t len) {
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '\\' && i + 1 < len) i++;
+        text[out++] = text[i];
+    }
+    return out;
+}
+
+// Check an escaped field for a wildcard that can match anything: a lone
+// "[" without a closing "]", as in the test command, is plain text
+static bool has_magic(const char* text, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] == '\\') {
+            i++;
+        } else if (text[i] == '*' || text[i] == '?') {
+            return true;
+        } else if (text[i] == '[' && memchr(text + i + 1, ']', len - i - 1) != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool finish_field(field_builder_t* fb) {
+    bool vanish = fb->at_empty && fb->field.len == 0;
+    fb->at_empty = false;
+    if (!fb->active || vanish) {
+        fb->active = false;
+        return true;
+    }
+
+    bool ok = true;
+    bool globbed = false;
+    size_t len = fb->field.len;
+    if (fb->split && fb->wild && has_magic(fb->field.data, len)) {
+        ok = capture_append(&fb->field, "", 1);
+        globbed = ok && glob_expand(fb->field.data, fb->glob_cache, fb->out) > 0;
+    }
+
+    // Words without wildcards, or with no matches, are kept as written
+    if (ok && !globbed) {
+        if (fb->split) {
+            len = unescape_field(fb->field.data, len);
+        }
+        ok = word_list_add(fb->out, fb->field.data ? fb->field.data : "", len);
+    }
+
+    fb->field.len = 0;
+    fb->active = false;
+    fb->wild = false;
+    return ok;
+}
+
+// Append the result of an expansion; unquoted results are split on IFS
+static bool put_expansion(field_builder_t* fb, const char* value, size_t len, bool quoted) {
+    if (quoted || !fb->split) {
+        return put_text(fb, value, len, true);
+    }
+
+    // Runs between separators and wildcards are copied whole
+    size_t i = 0;
+    while (i < len) {
+        size_t run = plain_span(fb, value + i, len - i, BYTE_IFS | BYTE_GLOB);
+        if (run > 0) {
+            fb->active = true;
+            if (!capture_append(&fb->field, value + i, run)) return false;
+            i += run;
+        }
+        if (i == len) {
+            break;
+        }
+        char c = value[i++];
+        if (fb->classes[(unsigned char)c] & BYTE_IFS) {
+            if (!finish_field(fb)) return false;
+        } else if (!put_char(fb, c, false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Expand $@ or $*. Quoted "$@" gives one field per parameter and quoted
+// "$*" joins them with the first IFS character; unquoted, both are split.
+static bool put_positional(field_builder_t* fb, bool separate, bool quoted) {
+    int count = vm_positional_count();
+    if (count == 0 && separate && quoted) {
+        fb->at_empty = true;
+    }
+
+    for (int n = 1; n <= count; n++) {
+        if (n > 1 && quoted && !separate) {
+            if (fb->ifs[0] != '\0' && !put_char(fb, fb->ifs[0], true)) return false;
+        } else if (n > 1) {
+            if (!finish_field(fb)) return false;
+            // A quoted parameter makes a field even when it is empty
+            fb->active = quoted;
+        }
+
+        const char* value = vm_positional(n);
+        if (!put_expansion(fb, value, strlen(value), quoted)) return false;
+    }
+    return true;
+}
+
+// Evaluate the $((...)) spanning word[start, end)
+static bool put_arithmetic(field_builder_t* fb, const char* start, const char* end, bool quoted) {
+    if (end - start < 5 || end[-2] != ')') {
+        fprintf(stderr, "Bad arithmetic expansion\n");
+        return false;
+    }
+
+    // Parameters inside the expression are expanded first
+    char* expr = expand_word(start + 3, (end - 2) - (start + 3));
+    long long value;
+    bool ok = expr != NULL && eval_arith(expr, &value);
+    free(expr);
+    if (!ok) {
+        return false;
+    }
+
+    char text[32];
+    int n = snprintf(text, sizeof(text), "%lld", value);
+    return put_expansion(fb, text, n, quoted);
+}
+
+// Expand the $ construct at word[i]; returns the index just past it
+static long expand_dollar(field_builder_t* fb, const char* word, size_t len, size_t i, bool quoted) {
+    const char* p = word + i + 1;
+    const char* value = NULL;
+    size_t name_len = 0;
+    char num_text[16];
+
+    if (*p == '(') {
+        const char* end = skip_substitution(word + i);
+        if (end == NULL || end > word + len) {
+            fprintf(stderr, "Unterminated command substitution\n");
+            return -1;
+        }
+
+        if (p[1] == '(') {
+            return put_arithmetic(fb, word + i, end, quoted) ? end - word : -1;
+        }
+
+        // Run the enclosed command, stripped of "$(" and ")"
+        char* inner = strndup(p + 1, (end - 1) - (p + 1));
+        capture_buf_t output = {NULL, 0, 0};
+        bool ok = inner != NULL && capture_command(inner, &output) &&
+                  put_expansion(fb, output.data, output.len, quoted);
+        free(inner);
+        free(output.data);
+        return ok ? end - word : -1;
+    }
+
+    if (*p == '{') {
+        p++;
+        while (p + name_len < word + len && p[name_len] != '}') name_len++;
+        if (p + name_len >= word + len) {
+            fprintf(stderr, "Bad substitution\n");
+            return -1;
+        }
+        if (isdigit((unsigned char)*p)) {
+            value = vm_positional(atoi(p));
+        } else {
+            value = get_variable_n(p, name_len);
+        }
+        i = (p + name_len + 1) - word;
+    } else if (*p == '$' || *p == '?' || *p == '#') {
+        int number = *p == '$' ? (int)getpid() : *p == '?' ? get_last_status() : vm_positional_count();
+        snprintf(num_text, sizeof(num_text), "%d", number);
+        value = num_text;
+        i += 2;
+    } else if (isdigit((unsigned char)*p)) {
+        value = vm_positional(*p - '0');
+        i += 2;
+    } else if (*p == '@' || *p == '*') {
+        return put_positional(fb, *p == '@', quoted) ? (long)i + 2 : -1;
+    } else if (isalpha((unsigned char)*p) || *p == '_') {
+        while (isalnum((unsigned char)p[name_len]) || p[name_len] == '_') name_len++;
+        value = get_variable_n(p, name_len);
+        i = (p + name_len) - word;
+    } else {
+        // A lone '$' is literal text
+        return put_char(fb, '$', quoted) ? (long)i + 1 : -1;
+    }
+
+    if (value != NULL && !put_expansion(fb, value, strlen(value), quoted)) {
+        return -1;
+    }
+    return (long)i;
+}
+
+static bool is_word_special(char c) {
+    return c == '\'' || c == '"' || c == '\\' || c == '$';
+}
+
+// Expand one raw word into fb, leaving the last field open
+static bool expand_into(field_builder_t* fb, const char* word, size_t len) {
+    char quote = '\0';
+    size_t i = 0;
+
+    while (i < len) {
+        char c = word[i];
+
+        if (quote == '\'') {
+            const char* close = memchr(word + i, '\'', len - i);
+            size_t run = close ? (size_t)(close - (word + i)) : len - i;
+            if (!put_text(fb, word + i, run, true)) return false;
+            i += run;
+            if (close != NULL) {
+                quote = '\0';
+                i++;
+            }
+            continue;
+        }
+
+        if ((c == '\'' && quote == '\0') || c == '"') {
+            quote = quote == c ? '\0' : c;
+            fb->active = true;
+            i++;
+            continue;
+        }
+
+        if (c == '\\' && i + 1 < len) {
+            char next = word[i + 1];
+            // Inside double quotes a backslash only escapes $ ` " and itself
+            if (quote == '"' && strchr("$`\"\\", next) == NULL) {
+                if (!put_char(fb, '\\', true)) return false;
+                i++;
+            } else {
+                if (!put_char(fb, next, true)) return false;
+                i += 2;
+            }
+            continue;
+        }
+
+        if (c == '$') {
+            long next = expand_dollar(fb, word, len, i, quote == '"');
+            if (next < 0) return false;
+            i = next;
+            continue;
+        }
+
+        // Plain text up to the next quote, escape or expansion
+        size_t run = 1;
+        while (i + run < len && !is_word_special(word[i + run])) run++;
+        if (!put_text(fb, word + i, run, quote == '"')) return false;
+        i += run;
+    }
+
+    return true;
+}
+
+static void init_builder(field_builder_t* fb, word_list_t* out, bool split, dir_cache_t** cache) {
+    memset(fb, 0, sizeof(*fb));
+    fb->out = out;
+    fb->split = split;
+    fb->glob_cache = cache;
+    fb->ifs = get_variable("IFS");
+    if (fb->ifs == NULL) {
+        fb->ifs = " \t\n";
+    }
+    if (split) {
+        fb->classes['\\'] = fb->classes['*'] = fb->classes['?'] = fb->classes['['] = BYTE_GLOB;
+        for (const char* c = fb->ifs; *c; c++) {
+            fb->classes[(unsigned char)*c] |= BYTE_IFS;
+        }
+    }
+}
+
+char* expand_word(const char* word, size_t len) {
+    word_list_t out = {{NULL, 0, 0}, NULL, 0, 0};
+    field_builder_t fb;
+    init_builder(&fb, &out, false, NULL);
+
+    char* result = NULL;
+    fb.active = true;
+    if (expand_into(&fb, word, len) && finish_field(&fb)) {
+        result = strdup(out.text.data ? out.text.data : "");
+    }
+
+    free(fb.field.data);
+    free_word_list(&out);
+    return result;
+}
+
+char* dequote_word(const char* word, size_t len) {
+    char* out = malloc(len + 1);
+    if (out == NULL) {
+        perror("malloc failed");
+        return NULL;
+    }
+    out[lex_dequote(word, len, out)] = '\0';
+    return out;
+}
+
+bool finish_expanded_cmd(expanded_cmd_t* cmd) {
+    if (cmd->words.count + 1 > cmd->argv_cap) {
+        char** argv = realloc(cmd->argv, (cmd->words.count + 1) * sizeof(char*));
+        if (argv == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        cmd->argv = argv;
+        cmd->argv_cap = cmd->words.count + 1;
+    }
+
+    // Offsets become pointers only now that the text buffer stops moving
+    for (size_t i = 0; i < cmd->words.count; i++) {
+        cmd->argv[i] = cmd->words.text.data + cmd->words.offsets[i];
+    }
+    cmd->argv[cmd->words.count] = NULL;
+    cmd->argc = (int)cmd->words.count;
+    return true;
+}
+
+// Empty a command for reuse, keeping its buffers
+static void reset_expanded_cmd(expanded_cmd_t* cmd) {
+    for (int i = 0; i < cmd->redir_count; i++) {
+        free(cmd->redirs[i].target);
+    }
+    cmd->redir_count = 0;
+    cmd->words.text.len = 0;
+    cmd->words.count = 0;
+    cmd->argc = 0;
+    cmd->assignments = 0;
+}
+
+bool expand_tokens(const char* text, const token_t* tokens, int count, bool assignments, expanded_cmd_t* cmd) {
+    reset_expanded_cmd(cmd);
+
+    dir_cache_t* cache = NULL;
+    field_builder_t fb;
+    init_builder(&fb, &cmd->words, true, &cache);
+
+    bool ok = true;
+    bool leading = assignments;
+    for (int t = 0; ok && t < count; t++) {
+        const token_t* tok = &tokens[t];
+        const char* raw = text + tok->offset;
+
+        if (is_redirection_token(tok->type)) {
+            const token_t* target = (t + 1 < count) ? &tokens[t + 1] : NULL;
+            if (target == NULL || target->type != TOK_WORD) {
+                fprintf(stderr, "Missing redirection target\n");
+                ok = false;
+                break;
+            }
+
+            redirection_t* redirs = realloc(cmd->redirs, (cmd->redir_count + 1) * sizeof(redirection_t));
+            if (redirs == NULL) {
+                ok = false;
+                break;
+            }
+            cmd->redirs = redirs;
+            redirs[cmd->redir_count].type = tok->type;
+            redirs[cmd->redir_count].target = expand_word(text + target->offset, target->length);
+            ok = redirs[cmd->redir_count++].target != NULL;
+            t++;
+            continue;
+        }
+
+        if (tok->type != TOK_WORD) {
+            fprintf(stderr, "Unexpected '%s'\n", token_text(tok->type));
+            ok = false;
+            break;
+        }
+
+        if (leading && is_assignment(raw)) {
+            // NAME=value: the value is expanded as a single field
+            size_t name_len = strchr(raw, '=') - raw + 1;
+            char* value = expand_word(raw + name_len, tok->length - name_len);
+            capture_buf_t word = {NULL, 0, 0};
+            ok = value != NULL && capture_append(&word, raw, name_len) &&
+                 capture_append(&word, value, strlen(value)) &&
+                 word_list_add(&cmd->words, word.data, word.len);
+            cmd->assignments++;
+            free(value);
+            free(word.data);
+            continue;
+        }
+
+        leading = false;
+        ok = expand_into(&fb, raw, tok->length) && finish_field(&fb);
+    }
+
+    free(fb.field.data);
+    free_dir_cache(cache);
+    return ok && finish_expanded_cmd(cmd);
+}
+
+bool expand_simple_command(const char* command, expanded_cmd_t* cmd) {
+    memset(cmd, 0, sizeof(*cmd));
+
+    token_list_t tokens = {NULL, 0, 0};
+    if (!lex_cached(command, strlen(command), &tokens)) {
+        fprintf(stderr, "Unterminated quote\n");
+        return false;
+    }
+
+    bool ok = expand_tokens(command, tokens.tokens, tokens.count, true, cmd);
+    free_tokens(&tokens);
+    if (!ok) {
+        free_expanded_cmd(cmd);
+    }
+    return ok;
+}
+
+void free_expanded_cmd(expanded_cmd_t* cmd) {
+    free(cmd->argv);
+    free_word_list(&cmd->words);
+    for (int i = 0; i < cmd->redir_count; i++) {
+        free(cmd->redirs[i].target);
+    }
+    free(cmd->redirs);
+    memset(cmd, 0, sizeof(*cmd));
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+#include "heredoc.h"
+#include "parse_cache.h"
+#include "expand.h"
+#include "input.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+// ############## LLM Generated Code Begins ##############
+
+// Write the whole payload, retrying on short writes
+static bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+// Fallback when memfd_create is unavailable: a pipe, which only works for
+// payloads that fit in the pipe buffer without blocking the shell
+static int heredoc_create_pipe(const char* data, size_t len) {
+    if (len > PIPE_BUF) {
+        fprintf(stderr, "Here-document too large\n");
+        return -1;
+    }
+
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("pipe failed");
+        return -1;
+    }
+
+    bool ok = write_all(fds[1], data, len);
+    close(fds[1]);
+    if (!ok) {
+        perror("write failed");
+        close(fds[0]);
+        return -1;
+    }
+
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    return fds[0];
+}
+
+int heredoc_create(const char* data, size_t len) {
+    int fd = memfd_create("heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        return heredoc_create_pipe(data, len);
+    }
+
+    // Writes to a memfd never block, however slowly the consumer reads
+    if (!write_all(fd, data, len)) {
+        perror("write failed");
+        close(fd);
+        return -1;
+    }
+
+    // Freeze the contents so the consumer sees exactly what was written
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+// Read body lines until one matches the delimiter
+static bool read_heredoc_body(const char* delim, bool strip_tabs, capture_buf_t* typed,
+                              capture_buf_t* body) {
+    bool interactive = !input_is_batch() && isatty(STDIN_FILENO);
+
+    while (1) {
+        if (interactive) {
+            printf("> ");
+            fflush(stdout);
+        }
+
+        char* line = get_user_input();
+        if (line == NULL) {
+            fprintf(stderr, "Here-document delimited by end-of-file (wanted '%s')\n", delim);
+            return true;
+        }
+        if (typed != NULL && capture_append(typed, "\n", 1) &&
+            capture_append(typed, line, strlen(line))) {
+            typed->data[typed->len] = '\0';
+        }
+
+        char* text = line;
+        if (strip_tabs) {
+            while (*text == '\t') text++;
+        }
+
+        if (strcmp(text, delim) == 0) {
+            free(line);
+            return true;
+        }
+
+        bool ok = capture_append(body, text, strlen(text)) && capture_append(body, "\n", 1);
+        free(line);
+        if (!ok) {
+            return false;
+        }
+    }
+}
+
+// Append text in double quotes, so $VAR and $(...) expand when the
+// command runs while quotes stay literal as in a here-document. A
+// substitution is copied as written since its quotes are its own.
+static bool put_expanded(capture_buf_t* out, const char* text, size_t len) {
+    bool ok = capture_append(out, "\"", 1);
+    for (size_t i = 0; ok && i < len; i++) {
+        const char* end = NULL;
+        if (text[i] == '$' && i + 1 < len && text[i + 1] == '(') {
+            end = skip_substitution(text + i);
+        }
+        if (end != NULL && end <= text + len) {
+            ok = capture_append(out, text + i, end - (text + i));
+            i = end - text - 1;
+        } else if (text[i] == '"') {
+            ok = capture_append(out, "\\\"", 2);
+        } else if (text[i] == '\\' && (i + 1 == len || text[i + 1] == '"')) {
+            // Otherwise it would escape the quote
+            ok = capture_append(out, "\\\\", 2);
+        } else {
+            ok = capture_append(out, text + i, 1);
+        }
+    }
+    return ok && capture_append(out, "\"", 1);
+}
+
+// Append text in single quotes, literal; a quote inside becomes '\''
+static bool put_literal(capture_buf_t* out, const char* text, size_t len) {
+    bool ok = capture_append(out, "'", 1);
+    for (size_t i = 0; ok && i < len; i++) {
+        ok = text[i] == '\''
+                 ? capture_append(out, "'\\''", 4)
+                 : capture_append(out, text + i, 1);
+    }
+    return ok && capture_append(out, "'", 1);
+}
+
+// Quoting any part of a delimiter keeps the body literal
+static bool is_quoted(const char* word, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (word[i] == '\'' || word[i] == '"' || word[i] == '\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Append the redirection that feeds body to the command. A here-string
+// adds back the final newline; an empty body reads from /dev/null.
+static bool put_body(capture_buf_t* out, const capture_buf_t* body, bool expand) {
+    if (body->len == 0) {
+        return capture_append(out, "< /dev/null", 11);
+    }
+    return capture_append(out, "<<< ", 4) &&
+           (expand ? put_expanded(out, body->data, body->len - 1)
+                   : put_literal(out, body->data, body->len - 1));
+}
+
+char* collect_heredocs(const char* line, capture_buf_t* typed) {
+    token_list_t tokens = {NULL, 0, 0};
+    size_t len = strlen(line);
+    if (!lex_cached(line, len, &tokens)) {
+        // Leave unterminated quotes for the executor to report
+        free_tokens(&tokens);
+        return strdup(line);
+    }
+
+    capture_buf_t out = {NULL, 0, 0};
+    size_t copied = 0;
+    bool ok = capture_reserve(&out, len + 1);
+    for (int t = 0; ok && t < tokens.count; t++) {
+        token_t* op = &tokens.tokens[t];
+        if (op->type != TOK_HEREDOC && op->type != TOK_HEREDOC_TAB) {
+            continue;
+        }
+
+        token_t* word = (t + 1 < tokens.count) ? &tokens.tokens[t + 1] : NULL;
+        if (word == NULL || word->type != TOK_WORD) {
+            fprintf(stderr, "Missing here-document delimiter\n");
+            ok = false;
+            break;
+        }
+
+        // The delimiter is matched after quote removal
+        char* delim = dequote_word(line + word->offset, word->length);
+        bool expand = !is_quoted(line + word->offset, word->length);
+        capture_buf_t body = {NULL, 0, 0};
+        ok = delim != NULL && read_heredoc_body(delim, op->type == TOK_HEREDOC_TAB, typed, &body) &&
+             capture_append(&out, line + copied, op->offset - copied) &&
+             put_body(&out, &body, expand);
+        free(delim);
+        free(body.data);
+        copied = word->offset + word->length;
+        t++;
+    }
+    free_tokens(&tokens);
+
+    if (!ok || !capture_append(&out, line + copied, len - copied)) {
+        free(out.data);
+        return NULL;
+    }
+    out.data[out.len] = '\0';
+    return out.data;
+}
+
+char* heredoc_summary(const char* command) {
+    token_list_t tokens = {NULL, 0, 0};
+    size_t len = strlen(command);
+    if (!lex_cached(command, len, &tokens)) {
+        free_tokens(&tokens);
+        return strdup(command);
+    }
+
+    capture_buf_t out = {NULL, 0, 0};
+    size_t copied = 0;
+    bool ok = capture_reserve(&out, len + 1);
+    for (int t = 0; ok && t + 1 < tokens.count; t++) {
+        token_t* word = &tokens.tokens[t + 1];
+        if (tokens.tokens[t].type != TOK_HERESTRING || word->type != TOK_WORD ||
+            (command[word->offset] != '\'' && command[word->offset] != '"')) {
+            continue;
+        }
+        ok = capture_append(&out, command + copied, word->offset - copied) &&
+             capture_append(&out, "'...'", 5);
+        copied = word->offset + word->length;
+    }
+    free_tokens(&tokens);
+
+    if (!ok || !capture_append(&out, command + copied, len - copied)) {
+        free(out.data);
+        return NULL;
+    }
+    out.data[out.len] = '\0';
+    return out.data;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -1,11 +1,136 @@
 #include "input.h"
+#include "timers.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <stdbool.h>
+
+// ############## LLM Generated Code Begins ##############
+// Batch input: large reads into a buffer that lines are cut from, so
+// neither the line length nor the input size is limited
+#define BATCH_CHUNK 65536
+
+static struct {
+    bool active;
+    int fd;                // -1 for a string source
+    char* buf;
+    size_t start;          // First unread byte
+    size_t len;
+    size_t cap;
+    bool eof;
+} batch = {false, -1, NULL, 0, 0, 0, false};
+
+void input_from_fd(int fd) {
+    batch.active = true;
+    batch.fd = fd;
+}
+
+bool input_from_string(const char* text) {
+    batch.active = true;
+    batch.fd = -1;
+    batch.eof = true;
+    batch.len = strlen(text);
+    batch.cap = batch.len + 1;
+    batch.buf = malloc(batch.cap);
+    if (batch.buf == NULL) {
+        perror("malloc failed");
+        return false;
+    }
+    memcpy(batch.buf, text, batch.len + 1);
+    return true;
+}
+
+bool input_is_batch() {
+    return batch.active;
+}
+
+bool input_pending() {
+    return batch.active && batch.start < batch.len;
+}
+
+// Pull the next chunk in after the unread bytes; false at end of input
+static bool fill_batch() {
+    if (batch.eof) {
+        return false;
+    }
+
+    // Slide unread bytes to the front before growing
+    if (batch.start > 0) {
+        memmove(batch.buf, batch.buf + batch.start, batch.len - batch.start);
+        batch.len -= batch.start;
+        batch.start = 0;
+    }
+    if (batch.cap - batch.len < BATCH_CHUNK) {
+        size_t cap = batch.cap ? batch.cap * 2 : BATCH_CHUNK;
+        while (cap - batch.len < BATCH_CHUNK) cap *= 2;
+        char* buf = realloc(batch.buf, cap);
+        if (buf == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        batch.buf = buf;
+        batch.cap = cap;
+    }
+
+    while (1) {
+        ssize_t n = read(batch.fd, batch.buf + batch.len, batch.cap - batch.len);
+        if (n > 0) {
+            batch.len += n;
+            return true;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1) {
+            perror("read failed");
+        }
+        batch.eof = true;
+        return false;
+    }
+}
+
+static char* next_batch_line() {
+    size_t scanned = batch.start;
+    while (1) {
+        char* nl = batch.len > scanned ? memchr(batch.buf + scanned, '\n', batch.len - scanned) : NULL;
+        if (nl != NULL) {
+            char* line = strndup(batch.buf + batch.start, nl - (batch.buf + batch.start));
+            batch.start = nl - batch.buf + 1;
+            return line;
+        }
+
+        // Only the new bytes need scanning after a refill
+        size_t unread = batch.len - batch.start;
+        if (!fill_batch()) {
+            if (batch.start == batch.len) {
+                return NULL;
+            }
+            // A last line without a newline
+            char* line = strndup(batch.buf + batch.start, batch.len - batch.start);
+            batch.start = batch.len;
+            return line;
+        }
+        scanned = batch.start + unread;
+    }
+}
+// ############## LLM Generated Code Ends ################
 
 char* get_user_input(){
+    if (batch.active) {
+        return next_batch_line();
+    }
+
+    // Unbuffered, so poll sees everything fgets has not read yet
+    static bool unbuffered = false;
+    if (!unbuffered) {
+        setvbuf(stdin, NULL, _IONBF, 0);
+        unbuffered = true;
+    }
+    // Job deadlines still fire while the prompt waits
+    wait_readable_with_timers(STDIN_FILENO);
+
     char* input = (char*)malloc(MAX_INPUT_SIZE);
     if(input == NULL){
         perror("malloc failed");
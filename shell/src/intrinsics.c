@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <sys/ioctl.h> 
 #include "executor.h"
+#include "wildcard.h"
 #define LOG_FILE ".shell_log"
 #define MAX_LOG_ENTRIES 15
 #define MAX_CMD_LEN 4096
@@ -18,10 +19,6 @@
 static char prev_dir[PATH_MAX] = "";
 static char* home_dir = NULL;
 
-static int compare_strings(const void* a, const void* b) {
-    return strcmp(*(const char**)a, *(const char**)b);
-}
-
 void set_shell_home(char* dir){
     home_dir = dir;
 }
@@ -33,7 +30,40 @@ bool is_intrinsic(const char* cmd) {
             strcmp(cmd, "activities") == 0 ||
             strcmp(cmd, "ping") == 0 ||
             strcmp(cmd, "fg") == 0 ||
-            strcmp(cmd, "bg") == 0);
+            strcmp(cmd, "bg") == 0 ||
+            strcmp(cmd, "export") == 0 ||
+            strcmp(cmd, "unset") == 0 ||
+            strcmp(cmd, "read") == 0 ||
+            strcmp(cmd, "stats") == 0 ||
+            strcmp(cmd, "test") == 0 ||
+            strcmp(cmd, "[") == 0 ||
+            strcmp(cmd, "true") == 0 ||
+            strcmp(cmd, ":") == 0 ||
+            strcmp(cmd, "false") == 0 ||
+            strcmp(cmd, "parallel") == 0 ||
+            strcmp(cmd, "submit") == 0 ||
+            strcmp(cmd, "sched") == 0 ||
+            strcmp(cmd, "time") == 0 ||
+            strcmp(cmd, "limit") == 0 ||
+            strcmp(cmd, "timeout") == 0 ||
+            strcmp(cmd, "peek") == 0 ||
+            strcmp(cmd, "wait") == 0 ||
+            strcmp(cmd, "bench") == 0);
+}
+
+// Exit status reported by the running intrinsic, or -1
+static int intrinsic_status = -1;
+
+void set_intrinsic_status(int status) {
+    intrinsic_status = status;
+}
+
+int run_intrinsic_status(const char* cmd, int argc, char** argv) {
+    intrinsic_status = -1;
+    bool ok = execute_intrinsic(cmd, argc, argv);
+    int status = intrinsic_status >= 0 ? intrinsic_status : ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    intrinsic_status = -1;
+    return status;
 }
 
 bool execute_intrinsic(const char* cmd, int argc, char** argv) {
@@ -44,13 +74,45 @@ bool execute_intrinsic(const char* cmd, int argc, char** argv) {
     } else if (strcmp(cmd, "log") == 0) {
         return log_command(argc, argv);
     } else if (strcmp(cmd, "activities") == 0) {
-        return activities_command();
+        return activities_command(argc, argv);
     } else if (strcmp(cmd, "ping") == 0) {
         return ping_command(argc, argv);
     } else if (strcmp(cmd, "fg") == 0) {
         return fg_command(argc, argv);
     } else if (strcmp(cmd, "bg") == 0) {
         return bg_command(argc, argv);
+    } else if (strcmp(cmd, "export") == 0) {
+        return export_command(argc, argv);
+    } else if (strcmp(cmd, "unset") == 0) {
+        return unset_command(argc, argv);
+    } else if (strcmp(cmd, "read") == 0) {
+        return read_line_command(argc, argv);
+    } else if (strcmp(cmd, "stats") == 0) {
+        return stats_command(argc, argv);
+    } else if (strcmp(cmd, "test") == 0 || strcmp(cmd, "[") == 0) {
+        return test_command(argc, argv);
+    } else if (strcmp(cmd, "true") == 0 || strcmp(cmd, ":") == 0) {
+        return true_command(argc, argv);
+    } else if (strcmp(cmd, "false") == 0) {
+        return false_command(argc, argv);
+    } else if (strcmp(cmd, "parallel") == 0) {
+        return parallel_command(argc, argv);
+    } else if (strcmp(cmd, "submit") == 0) {
+        return submit_command(argc, argv);
+    } else if (strcmp(cmd, "sched") == 0) {
+        return sched_command(argc, argv);
+    } else if (strcmp(cmd, "time") == 0) {
+        return time_command(argc, argv);
+    } else if (strcmp(cmd, "limit") == 0) {
+        return limit_command(argc, argv);
+    } else if (strcmp(cmd, "timeout") == 0) {
+        return timeout_command(argc, argv);
+    } else if (strcmp(cmd, "peek") == 0) {
+        return peek_command(argc, argv);
+    } else if (strcmp(cmd, "wait") == 0) {
+        return wait_command(argc, argv);
+    } else if (strcmp(cmd, "bench") == 0) {
+        return bench_command(argc, argv);
     }
     return false;
 }
@@ -211,52 +273,37 @@ bool reveal_command(int argc, char** argv) {
         return false;
     }
     
-    // Open directory
-    DIR* dir = opendir(dir_path);
-    if (dir == NULL) {
+    // Read directory contents in one pass
+    dir_listing_t listing;
+    if (!read_dir_listing(dir_path, &listing)) {
         printf("No such directory!\n");
         free(dir_path);
         return false;
     }
     
-    // Read directory contents into an array for sorting
-    char** filenames = NULL;
+    // Collect the names to show; they point into the listing
+    char** filenames = malloc((listing.count + 1) * sizeof(char*));
     int count = 0;
-    int capacity = 10;
-    filenames = malloc(capacity * sizeof(char*));
     
-    struct dirent* entry;
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and .. entries regardless
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
-        }
+    for (size_t k = 0; k < listing.count; k++) {
+        char* name = LISTING_NAME(&listing, k);
         
         // Skip hidden files if not showing hidden
-        if (!show_hidden && entry->d_name[0] == '.') {
+        if (!show_hidden && name[0] == '.') {
             continue;
         }
         
-        // Expand array if needed
-        if (count >= capacity) {
-            capacity *= 2;
-            filenames = realloc(filenames, capacity * sizeof(char*));
-        }
-        
-        filenames[count++] = strdup(entry->d_name);
+        filenames[count++] = name;
     }
     
-    closedir(dir);
-    
     // Sort filenames
-    qsort(filenames, count, sizeof(char*), compare_strings);
+    sort_strings(filenames, count);
     
     // Display files
     if (line_by_line) {
         // One file per line (-l option)
         for (int i = 0; i < count; i++) {
             printf("%s\n", filenames[i]);
-            free(filenames[i]);
         }
     } else {
         struct winsize w;
@@ -287,7 +334,6 @@ bool reveal_command(int argc, char** argv) {
                 int idx = col * rows + row;
                 if (idx < count) {
                     printf("%-*s", col_width, filenames[idx]);
-                    free(filenames[idx]);
                 }
             }
             printf("\n");
@@ -296,13 +342,14 @@ bool reveal_command(int argc, char** argv) {
     
     // Clean up
     free(filenames);
+    free_dir_listing(&listing);
     free(dir_path);
     
     return true;
 }
 
 // Helper functions for log command
-static char** read_log_entries(int* count) {
+char** read_log_entries(int* count) {
     char** entries = malloc(MAX_LOG_ENTRIES * sizeof(char*));
     *count = 0;
     
@@ -455,22 +502,8 @@ bool log_command(int argc, char** argv) {
         free(entries);
         
         // Parse and execute the command
-        char* cmd_argv[MAX_INPUT_SIZE / 2];
-        int cmd_argc = 0;
-        
-        char* cmd_copy = strdup(cmd_to_execute);
-        split_command(cmd_copy, cmd_argv, &cmd_argc);
-        
-        bool result = false;
-        if (cmd_argc > 0) {
-            if (is_intrinsic(cmd_argv[0])) {
-                result = execute_intrinsic(cmd_argv[0], cmd_argc, cmd_argv);
-            } else {
-                result = execute_command(cmd_to_execute);
-            }
-        }
+        bool result = execute_command(cmd_to_execute);
         
-        free(cmd_copy);
         free(cmd_to_execute);
         return result;
     }
@@ -0,0 +1,252 @@
+#define _GNU_SOURCE
+#include "job_limits.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <mntent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+// ############## LLM Generated Code Begins ##############
+#define CPU_MAX_PERIOD 100000
+
+void init_job_limits(job_limits_t* limits) {
+    limits->address_space = RLIM_INFINITY;
+    limits->cpu_seconds = RLIM_INFINITY;
+    limits->open_files = RLIM_INFINITY;
+    limits->memory_max = 0;
+    limits->cpu_percent = 0;
+}
+
+bool has_cgroup_limits(const job_limits_t* limits) {
+    return limits->memory_max > 0 || limits->cpu_percent > 0;
+}
+
+
+int parse_limit_option(const char* opt, const char* value, job_limits_t* limits) {
+    if (strlen(opt) != 2 || opt[0] != '-' || strchr("vtnmq", opt[1]) == NULL) {
+        return 0;
+    }
+    long long number;
+    if (!parse_size(value, &number)) {
+        fprintf(stderr, "limit: invalid value for %s: %s\n", opt, value);
+        return -1;
+    }
+    switch (opt[1]) {
+    case 'v': limits->address_space = (rlim_t)number; break;
+    case 't': limits->cpu_seconds = (rlim_t)number; break;
+    case 'n': limits->open_files = (rlim_t)number; break;
+    case 'm': limits->memory_max = number; break;
+    default:
+        if (number > 100 * sysconf(_SC_NPROCESSORS_ONLN)) {
+            fprintf(stderr, "limit: CPU quota above the CPUs available: %s%%\n", value);
+            return -1;
+        }
+        limits->cpu_percent = (int)number;
+    }
+    return 1;
+}
+
+static bool write_file(const char* dir, const char* name, const char* text) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    bool ok = write(fd, text, strlen(text)) == (ssize_t)strlen(text);
+    close(fd);
+    return ok;
+}
+
+static bool read_file(const char* dir, const char* name, char* buf, size_t size) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    ssize_t n = read(fd, buf, size - 1);
+    close(fd);
+    buf[n > 0 ? n : 0] = '\0';
+    return n > 0;
+}
+
+// Whether a space-separated controller list names controller
+static bool has_controller(const char* list, const char* controller) {
+    size_t len = strlen(controller);
+    for (const char* p = strstr(list, controller); p != NULL; p = strstr(p + 1, controller)) {
+        if ((p == list || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\n' || p[len] == '\0')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The shell's own cgroup v2 directory, found once; NULL without cgroup v2
+static const char* shell_cgroup() {
+    static bool probed = false;
+    static char dir[PATH_MAX];
+    if (probed) {
+        return dir[0] ? dir : NULL;
+    }
+    probed = true;
+    dir[0] = '\0';
+
+    char mount[PATH_MAX] = "";
+    FILE* mounts = setmntent("/proc/self/mounts", "r");
+    struct mntent* entry;
+    while (mounts != NULL && (entry = getmntent(mounts)) != NULL) {
+        if (strcmp(entry->mnt_type, "cgroup2") == 0) {
+            snprintf(mount, sizeof(mount), "%s", entry->mnt_dir);
+            break;
+        }
+    }
+    if (mounts != NULL) endmntent(mounts);
+
+    // The unified hierarchy is the "0::" line
+    char own[PATH_MAX] = "";
+    bool found = false;
+    FILE* cgroups = fopen("/proc/self/cgroup", "r");
+    char line[PATH_MAX];
+    while (cgroups != NULL && fgets(line, sizeof(line), cgroups) != NULL) {
+        if (strncmp(line, "0::", 3) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(own, sizeof(own), "%s", strcmp(line + 3, "/") == 0 ? "" : line + 3);
+            found = true;
+            break;
+        }
+    }
+    if (cgroups != NULL) fclose(cgroups);
+
+    if (mount[0] != '\0' && found) {
+        snprintf(dir, sizeof(dir), "%.2047s%.2047s", mount, own);
+    }
+    return dir[0] ? dir : NULL;
+}
+
+// Make sure the children of the shell's cgroup can use a controller.
+// This fails when the controller is not delegated to the shell, or when
+// the shell's own cgroup holds processes and is not the root.
+static bool enable_controller(const char* base, const char* controller) {
+    char list[256];
+    if (!read_file(base, "cgroup.controllers", list, sizeof(list)) ||
+        !has_controller(list, controller)) {
+        return false;
+    }
+    if (read_file(base, "cgroup.subtree_control", list, sizeof(list)) &&
+        has_controller(list, controller)) {
+        return true;
+    }
+    char request[32];
+    snprintf(request, sizeof(request), "+%s", controller);
+    return write_file(base, "cgroup.subtree_control", request);
+}
+
+char* create_job_cgroup(int job_id, const job_limits_t* limits) {
+    const char* base = shell_cgroup();
+    if (base == NULL || (limits->memory_max > 0 && !enable_controller(base, "memory")) ||
+        (limits->cpu_percent > 0 && !enable_controller(base, "cpu"))) {
+        fprintf(stderr, "limit: no writable cgroup v2 hierarchy, -m and -q not applied\n");
+        return NULL;
+    }
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%.4000s/shell-%d-job%d", base, (int)getpid(), job_id);
+    if (mkdir(dir, 0755) == -1 && errno != EEXIST) {
+        perror("limit: mkdir cgroup failed");
+        return NULL;
+    }
+
+    char value[64];
+    bool ok = true;
+    if (limits->memory_max > 0) {
+        snprintf(value, sizeof(value), "%lld", limits->memory_max);
+        ok = write_file(dir, "memory.max", value);
+    }
+    if (ok && limits->cpu_percent > 0) {
+        snprintf(value, sizeof(value), "%d %d", limits->cpu_percent * (CPU_MAX_PERIOD / 100),
+                 CPU_MAX_PERIOD);
+        ok = write_file(dir, "cpu.max", value);
+    }
+    if (!ok) {
+        perror("limit: setting cgroup limits failed");
+        rmdir(dir);
+        return NULL;
+    }
+    return strdup(dir);
+}
+
+void remove_job_cgroup(const char* cgroup) {
+    // Fails while a process of the job is still alive, which is harmless
+    if (cgroup != NULL) {
+        rmdir(cgroup);
+    }
+}
+
+void apply_job_limits(const job_limits_t* limits, const char* cgroup) {
+    // Joining first puts every later process of the job in the cgroup
+    if (cgroup != NULL) {
+        char pid[32];
+        snprintf(pid, sizeof(pid), "%d", (int)getpid());
+        if (!write_file(cgroup, "cgroup.procs", pid)) {
+            perror("limit: joining cgroup failed");
+        }
+    }
+
+    const struct {
+        int resource;
+        rlim_t value;
+        const char* name;
+    } rlimits[] = {
+        {RLIMIT_AS, limits->address_space, "address space"},
+        {RLIMIT_CPU, limits->cpu_seconds, "CPU time"},
+        {RLIMIT_NOFILE, limits->open_files, "open files"},
+    };
+    for (size_t i = 0; i < sizeof(rlimits) / sizeof(rlimits[0]); i++) {
+        if (rlimits[i].value == RLIM_INFINITY) {
+            continue;
+        }
+        struct rlimit rl = {rlimits[i].value, rlimits[i].value};
+        if (prlimit(0, rlimits[i].resource, &rl, NULL) == -1) {
+            fprintf(stderr, "limit: %s: %s\n", rlimits[i].name, strerror(errno));
+        }
+    }
+}
+
+
+void format_job_limits(const job_limits_t* limits, const char* cgroup, long vm_kb,
+                       double cpu_time, int open_files, char* out, size_t size) {
+    size_t len = 0;
+    out[0] = '\0';
+    char used[16], max[16];
+    if (limits->address_space != RLIM_INFINITY && len < size) {
+        format_size(vm_kb * 1024.0, used, sizeof(used));
+        format_size((double)limits->address_space, max, sizeof(max));
+        len += snprintf(out + len, size - len, "  vm %s/%s", used, max);
+    }
+    if (limits->cpu_seconds != RLIM_INFINITY && len < size) {
+        len += snprintf(out + len, size - len, "  cputime %.1fs/%llus", cpu_time,
+                        (unsigned long long)limits->cpu_seconds);
+    }
+    if (limits->open_files != RLIM_INFINITY && len < size) {
+        len += snprintf(out + len, size - len, "  files %d/%llu", open_files,
+                        (unsigned long long)limits->open_files);
+    }
+
+    char current[64];
+    if (limits->memory_max > 0 && len < size) {
+        bool known = cgroup != NULL && read_file(cgroup, "memory.current", current, sizeof(current));
+        format_size(known ? atof(current) : 0, used, sizeof(used));
+        format_size((double)limits->memory_max, max, sizeof(max));
+        len += snprintf(out + len, size - len, "  mem %s/%s%s", used, max, known ? "" : " (off)");
+    }
+    if (limits->cpu_percent > 0 && len < size) {
+        snprintf(out + len, size - len, "  cpu.max %d%%%s", limits->cpu_percent,
+                 cgroup != NULL ? "" : " (off)");
+    }
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -1,4 +1,16 @@
+#define _GNU_SOURCE
 #include "jobs.h"
+#include "executor.h"
+#include "monitor.h"
+#include "lexer.h"
+#include "expand.h"
+#include "heredoc.h"
+#include "timers.h"
+#include "utils.h"
+#include "intrinsics.h"
+#include "vm.h"
+#include "eventlog.h"
+#include "probes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -6,26 +18,47 @@
 #include <sys/wait.h>
 #include <signal.h>
 #include <ctype.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
 // ############## LLM Generated Code Begins ##############
 job_t jobs[MAX_JOBS];
 static int next_job_id = 1;
 static int foreground_job = -1;
 
-// Comparison function for sorting jobs by command name
+// Seconds between SIGTERM and SIGKILL for a job past its deadline
+#define DEFAULT_GRACE 5.0
+
+// Most background jobs allowed to run at once; 0 means no limit
+static int job_limit = 0;
+volatile sig_atomic_t jobs_reaped = 0;
+
+// Nice increment for background jobs while a foreground job runs; 0 is
+// off. From INTERACTIVE_IDLE_IO up their IO also drops to the idle class.
+static int interactive_level = 0;
+#define INTERACTIVE_IDLE_IO 10
+
+// Ring size for the output of new background jobs; 0 leaves their output
+// on the terminal
+static long long spool_size = 0;
+
+// ioprio_set(2) encoding, which libc does not expose
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_WHO_PGRP 2
+
+// Order jobs by command name, then by job ID
 static int compare_jobs_by_command(const void* a, const void* b) {
-    job_t* job_a = (job_t*)a;
-    job_t* job_b = (job_t*)b;
-    
-    // Skip empty job slots
-    if (job_a->job_id == 0) return 1;
-    if (job_b->job_id == 0) return -1;
-    
-    // Get command names (first word of command)
-    char cmd_a[256], cmd_b[256];
-    sscanf(job_a->command, "%255s", cmd_a);
-    sscanf(job_b->command, "%255s", cmd_b);
-    
-    return strcmp(cmd_a, cmd_b);
+    const job_t* job_a = *(job_t* const*)a;
+    const job_t* job_b = *(job_t* const*)b;
+    int order = strcmp(job_a->name, job_b->name);
+    return order != 0 ? order : job_a->job_id - job_b->job_id;
 }
 
 void init_jobs() {
@@ -33,14 +66,45 @@ void init_jobs() {
         jobs[i].job_id = 0;
         jobs[i].pid = 0;
         jobs[i].command = NULL;
+        jobs[i].script = NULL;
+        jobs[i].name = NULL;
         jobs[i].completed = false;
         jobs[i].status = 0;
         jobs[i].state = JOB_RUNNING;
         jobs[i].pgid = 0;
+        jobs[i].priority = 0;
+        jobs[i].idle = false;
+        jobs[i].cpus = NULL;
+        jobs[i].demoted = false;
+        memset(&jobs[i].usage, 0, sizeof(jobs[i].usage));
+        jobs[i].cpu_time = 0;
+        jobs[i].rss_kb = 0;
+        jobs[i].vm_kb = 0;
+        jobs[i].open_files = 0;
+        init_job_limits(&jobs[i].limits);
+        jobs[i].cgroup = NULL;
+        jobs[i].deadline = 0;
+        jobs[i].grace = 0;
+        jobs[i].expires_at = 0;
+        jobs[i].timed_out = false;
+        jobs[i].spool = NULL;
+        jobs[i].pidfd = -1;
+        jobs[i].started_at = 0;
+        jobs[i].ended_at = 0;
     }
     foreground_job = -1;
 }
 
+// Open a pidfd for a child that was not reaped yet, so the handle names
+// that very process even if its PID is reused later
+static int open_pidfd(pid_t pid) {
+    int fd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (fd == -1) {
+        perror("pidfd_open failed");
+    }
+    return fd;
+}
+
 int add_job(pid_t pid, const char* command, bool print_info) {
     // Find an empty slot
     int index = -1;
@@ -59,11 +123,40 @@ int add_job(pid_t pid, const char* command, bool print_info) {
     // Add the job
     jobs[index].job_id = next_job_id++;
     jobs[index].pid = pid;
-    jobs[index].command = strdup(command);
+    // Here-document bodies are kept out of what is shown
+    jobs[index].command = heredoc_summary(command);
+    if (jobs[index].command == NULL) {
+        jobs[index].command = strdup(command);
+    }
+    jobs[index].script = strcmp(jobs[index].command, command) != 0 ? strdup(command) : NULL;
+    // The first word, kept for sorting and listing
+    size_t skip = strspn(command, " \t\n");
+    jobs[index].name = strndup(command + skip, strcspn(command + skip, " \t\n"));
     jobs[index].completed = false;
     jobs[index].status = 0;
     jobs[index].state = JOB_RUNNING;
     jobs[index].pgid = getpgid(pid);
+    jobs[index].priority = 0;
+    jobs[index].idle = false;
+    jobs[index].cpus = NULL;
+    jobs[index].demoted = false;
+    memset(&jobs[index].usage, 0, sizeof(jobs[index].usage));
+    jobs[index].cpu_time = 0;
+    jobs[index].rss_kb = 0;
+    jobs[index].vm_kb = 0;
+    jobs[index].open_files = 0;
+    init_job_limits(&jobs[index].limits);
+    jobs[index].cgroup = NULL;
+    jobs[index].deadline = 0;
+    jobs[index].grace = 0;
+    jobs[index].expires_at = 0;
+    jobs[index].timed_out = false;
+    jobs[index].spool = NULL;
+    // SIGCHLD is blocked while a foreground child is added, so it is
+    // still there to open
+    jobs[index].pidfd = pid > 0 ? open_pidfd(pid) : -1;
+    jobs[index].started_at = pid > 0 ? event_time() : 0;
+    jobs[index].ended_at = 0;
     
     // Print job info
     if(print_info) printf("[%d] %d\n", jobs[index].job_id, (int)pid);
@@ -72,53 +165,66 @@ int add_job(pid_t pid, const char* command, bool print_info) {
 }
 
 void check_jobs() {
+    uint64_t start = probe_start();
     for (int i = 0; i < MAX_JOBS; i++) {
-        if (jobs[i].job_id > 0 && !jobs[i].completed) {
+        job_t* job = &jobs[i];
+        if (job->job_id == 0 || job->state == JOB_QUEUED) {
+            continue;
+        }
+        // Most jobs were reaped by the SIGCHLD handler already
+        if (!job->completed) {
             int status;
-            pid_t result = waitpid(jobs[i].pid, &status, WNOHANG);
-            
-            if (result == jobs[i].pid) {
-                // Job completed
-                jobs[i].completed = true;
-                jobs[i].status = status;
-                
-                // Extract command name (first word)
-                char* cmd_copy = strdup(jobs[i].command);
-                char* cmd_name = strtok(cmd_copy, " \t\n");
-                
-                if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
-                    printf("%s with pid %d exited normally\n", 
-                           cmd_name ? cmd_name : jobs[i].command, 
-                           (int)jobs[i].pid);
-                } else {
-                    printf("%s with pid %d exited abnormally\n", 
-                           cmd_name ? cmd_name : jobs[i].command, 
-                           (int)jobs[i].pid);
-                }
-                
-                free(cmd_copy);
-                
-                // Clean up the job
-                free(jobs[i].command);
-                jobs[i].job_id = 0;
-                jobs[i].pid = 0;
-                jobs[i].command = NULL;
-                
-                // If this was the foreground job, clear it
-                if (foreground_job == i) {
-                    foreground_job = -1;
-                }
+            if (wait4(job->pid, &status, WNOHANG, &job->usage) != job->pid) {
+                continue;
+            }
+            job->completed = true;
+            job->status = status;
+        }
+
+        // Output still spooled goes away with the job
+        char unseen[64] = "";
+        if (job->spool != NULL) {
+            spool_drain(job->spool, false);
+            size_t left = spool_unshown(job->spool);
+            if (left > 0) {
+                char size[16];
+                format_size(left, size, sizeof(size));
+                snprintf(unseen, sizeof(unseen), " (%s of output not shown)", size);
             }
         }
+
+        log_job_exit(job, job->status, &job->usage);
+        if (job->timed_out) {
+            printf("%s with pid %d exited abnormally (timed out)%s\n", job->name, (int)job->pid, unseen);
+        } else if (WIFEXITED(job->status) && WEXITSTATUS(job->status) == 0) {
+            printf("%s with pid %d exited normally%s\n", job->name, (int)job->pid, unseen);
+        } else {
+            printf("%s with pid %d exited abnormally%s\n", job->name, (int)job->pid, unseen);
+        }
+
+        // If this was the foreground job, clear it
+        if (foreground_job == i) {
+            clear_foreground_job();
+        }
+        remove_job(job);
     }
+
+    // Finished jobs may have freed slots for queued ones
+    dispatch_jobs();
+    probe_end(PROBE_REAP, start);
 }
 
 void cleanup_jobs() {
+    flush_event_log();
     for (int i = 0; i < MAX_JOBS; i++) {
         if (jobs[i].command) {
             free(jobs[i].command);
             jobs[i].command = NULL;
         }
+        free(jobs[i].script);
+        jobs[i].script = NULL;
+        free(jobs[i].cpus);
+        jobs[i].cpus = NULL;
     }
 }
 
@@ -154,10 +260,18 @@ job_t* get_foreground_job() {
     return NULL;
 }
 
+static void demote_background_jobs();
+static void restore_job(job_t* job);
+
 void set_foreground_job(int job_id) {
     for (int i = 0; i < MAX_JOBS; i++) {
         if (jobs[i].job_id == job_id) {
             foreground_job = i;
+            // A job brought back with fg gets its own priority again
+            if (jobs[i].demoted) {
+                restore_job(&jobs[i]);
+            }
+            demote_background_jobs();
             return;
         }
     }
@@ -165,6 +279,11 @@ void set_foreground_job(int job_id) {
 
 void clear_foreground_job() {
     foreground_job = -1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].job_id > 0 && jobs[i].demoted) {
+            restore_job(&jobs[i]);
+        }
+    }
 }
 
 int get_most_recent_job() {
@@ -185,45 +304,58 @@ int get_most_recent_job() {
     return -1;
 }
 
-// Activities command - list all running or stopped jobs
-bool activities_command() {
-    // Create a copy of the jobs array for sorting
-    job_t sorted_jobs[MAX_JOBS];
-    int job_count = 0;
-    
+int list_jobs(job_t** out) {
+    int count = 0;
     for (int i = 0; i < MAX_JOBS; i++) {
         if (jobs[i].job_id > 0 && !jobs[i].completed) {
-            // Update job state by checking if process is still alive
-            int status;
-            pid_t result = waitpid(jobs[i].pid, &status, WNOHANG);
-            
-            if (result == 0) {
-                // Process still exists - copy to sorted array
-                sorted_jobs[job_count++] = jobs[i];
-            } else {
-                // Process has terminated - mark as completed
-                jobs[i].completed = true;
-                free(jobs[i].command);
-                jobs[i].job_id = 0;
-                jobs[i].pid = 0;
-                jobs[i].command = NULL;
-            }
+            out[count++] = &jobs[i];
         }
     }
-    
-    // Sort jobs by command name
-    qsort(sorted_jobs, job_count, sizeof(job_t), compare_jobs_by_command);
-    
-    // Print sorted jobs
+    qsort(out, count, sizeof(job_t*), compare_jobs_by_command);
+    return count;
+}
+
+// Activities command - list all running or stopped jobs
+bool activities_command(int argc, char** argv) {
+    if (argc > 1) {
+        return watch_command(argc, argv);
+    }
+
+    job_t* sorted[MAX_JOBS];
+    int job_count = list_jobs(sorted);
+    sample_jobs_usage();
+
     for (int i = 0; i < job_count; i++) {
-        // Get first word of command as command name
-        char cmd_name[256];
-        sscanf(sorted_jobs[i].command, "%255s", cmd_name);
-        
-        printf("[%d] : %s - %s\n", 
-               (int)sorted_jobs[i].pid, 
-               cmd_name, 
-               sorted_jobs[i].state == JOB_RUNNING ? "Running" : "Stopped");
+        const job_t* job = sorted[i];
+        if (job->state == JOB_QUEUED) {
+            // Queued jobs have no pid yet, so show the job ID to promote
+            printf("[job %d] : %s - Queued\n", job->job_id, job->name);
+            continue;
+        }
+        char limits[256];
+        format_job_limits(&job->limits, job->cgroup, job->vm_kb, job->cpu_time,
+                          job->open_files, limits, sizeof(limits));
+        if (job->expires_at > 0) {
+            size_t len = strlen(limits);
+            double left = job->expires_at - monotonic_seconds();
+            snprintf(limits + len, sizeof(limits) - len, job->timed_out ? "  timed out" : "  deadline %.1fs",
+                     left > 0 ? left : 0);
+        }
+        if (job->spool != NULL) {
+            char size[16];
+            size_t len = strlen(limits);
+            format_size(spool_buffered(job->spool), size, sizeof(size));
+            len += snprintf(limits + len, sizeof(limits) - len, "  spooled %s", size);
+            if (spool_dropped(job->spool) > 0) {
+                format_size(spool_dropped(job->spool), size, sizeof(size));
+                snprintf(limits + len, sizeof(limits) - len, " (dropped %s)", size);
+            }
+        }
+        printf("[%d] : %s - %s  cpu %.2fs  rss %.1fM%s\n",
+               (int)job->pid,
+               job->name,
+               job->state == JOB_RUNNING ? "Running" : "Stopped",
+               job->cpu_time, job->rss_kb / 1024.0, limits);
     }
     
     return true;
@@ -266,6 +398,61 @@ bool ping_command(int argc, char** argv) {
     }
 }
 
+// Give a started job the terminal and wait until it finishes or stops;
+// returns its exit status
+static int foreground_wait(job_t* job) {
+    uint64_t start = probe_start();
+    // Set as foreground job
+    set_foreground_job(job->job_id);
+    
+    // CRITICAL FIX: Give terminal control to the process group FIRST
+    tcsetpgrp(STDIN_FILENO, job->pgid);
+    
+    // If job was stopped, continue it
+    if (job->state == JOB_STOPPED) {
+        kill(-job->pgid, SIGCONT);
+        job->state = JOB_RUNNING;
+        log_job_event("continue", job);
+    }
+    
+    // Wait for job to complete or stop again
+    int status;
+    sigset_t old_mask;
+    block_sigchld(&old_mask);
+    if (wait_with_timers(job->pid, &status, WUNTRACED, &job->usage) == -1) {
+        // The handler reaped it before the signal was blocked
+        status = job->status;
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    
+    // Take terminal control back
+    tcsetpgrp(STDIN_FILENO, getpgrp());
+    
+    // If process was stopped by SIGTSTP
+    if (WIFSTOPPED(status)) {
+        job->state = JOB_STOPPED;
+        log_job_event("stop", job);
+        printf("[%d] Stopped %s\n", job->job_id, job->command);
+    } else {
+        // Process completed
+        log_job_exit(job, status, &job->usage);
+        if (job->timed_out) {
+            printf("%s with pid %d exited abnormally (timed out)\n", job->name, (int)job->pid);
+        }
+        remove_job(job);
+    }
+    
+    // Clear foreground job
+    clear_foreground_job();
+    probe_end(PROBE_WAIT, start);
+
+    if (WIFSTOPPED(status)) {
+        return EXIT_SUCCESS;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    
+}
+
 // Foreground command - bring job to foreground
 bool fg_command(int argc, char** argv) {
     int job_id;
@@ -295,42 +482,22 @@ bool fg_command(int argc, char** argv) {
     
     // Print command
     printf("%s\n", job->command);
-    
-    // Set as foreground job
-    set_foreground_job(job_id);
-    
-    // CRITICAL FIX: Give terminal control to the process group FIRST
-    tcsetpgrp(STDIN_FILENO, job->pgid);
-    
-    // If job was stopped, continue it
-    if (job->state == JOB_STOPPED) {
-        kill(-job->pgid, SIGCONT);
-        job->state = JOB_RUNNING;
+
+    // A queued job is started straight in the foreground
+    if (job->state == JOB_QUEUED && !start_queued_job(job, true)) {
+        return false;
     }
-    
-    // Wait for job to complete or stop again
-    int status;
-    waitpid(job->pid, &status, WUNTRACED);
-    
-    // Take terminal control back
-    tcsetpgrp(STDIN_FILENO, getpgrp());
-    
-    // If process was stopped by SIGTSTP
-    if (WIFSTOPPED(status)) {
-        job->state = JOB_STOPPED;
-        printf("[%d] Stopped %s\n", job->job_id, job->command);
-    } else {
-        // Process completed
-        job->completed = true;
-        free(job->command);
-        job->job_id = 0;
-        job->pid = 0;
-        job->command = NULL;
+
+    log_job_event("fg", job);
+
+    // Catch up on what the job wrote meanwhile; while it has the
+    // foreground, new output is passed through as it arrives
+    if (job->spool != NULL) {
+        spool_drain(job->spool, false);
+        spool_replay(job->spool);
     }
     
-    // Clear foreground job
-    clear_foreground_job();
-    
+    foreground_wait(job);
     return true;
 }
 // Background command - resume stopped job in background
@@ -360,6 +527,12 @@ bool bg_command(int argc, char** argv) {
         return false;
     }
     
+    // A queued job is promoted past the running limit
+    if (job->state == JOB_QUEUED) {
+        return start_queued_job(job, false);
+    }
+    log_job_event("bg", job);
+
     // Check if job is already running
     if (job->state == JOB_RUNNING) {
         fprintf(stderr, "Job already running\n");
@@ -371,10 +544,814 @@ bool bg_command(int argc, char** argv) {
     
     // Update job state
     job->state = JOB_RUNNING;
+    log_job_event("continue", job);
     
     // Print job info
     printf("[%d] %s &\n", job->job_id, job->command);
     
     return true;
 }
+
+void remove_job(job_t* job) {
+    job->completed = true;
+    free(job->command);
+    free(job->script);
+    free(job->name);
+    free(job->cpus);
+    remove_job_cgroup(job->cgroup);
+    free(job->cgroup);
+    if (job->spool != NULL) {
+        unwatch_fd(job->spool->read_fd);
+        spool_free(job->spool);
+        job->spool = NULL;
+    }
+    if (job->pidfd != -1) {
+        close(job->pidfd);
+        job->pidfd = -1;
+    }
+    job->job_id = 0;
+    job->pid = 0;
+    job->command = NULL;
+    job->script = NULL;
+    job->name = NULL;
+    job->cpus = NULL;
+    job->cgroup = NULL;
+    job->demoted = false;
+}
+
+// Parse a CPU list such as "0-3,6" into set
+static bool parse_cpus(const char* list, cpu_set_t* set) {
+    CPU_ZERO(set);
+    const char* p = list;
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0) return false;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first) return false;
+        }
+        if (last >= CPU_SETSIZE) return false;
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, set);
+        }
+        if (*end != ',' && *end != '\0') return false;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+// The IO priority follows the nice value the way the kernel derives it
+// by default: best-effort level (nice + 20) / 5
+static int ioprio_for(int nice_value, bool idle) {
+    if (idle) {
+        return IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    }
+    return (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | ((nice_value + 20) / 5);
+}
+
+static int job_nice(const job_t* job) {
+    return job->idle ? 19 : job->priority;
+}
+
+void apply_job_sched(const job_t* job) {
+    if (job->idle || job->priority != 0) {
+        if (setpriority(PRIO_PROCESS, 0, job_nice(job)) == -1) {
+            perror("setpriority failed");
+        }
+        if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio_for(job_nice(job), job->idle)) == -1) {
+            perror("ioprio_set failed");
+        }
+    }
+
+    cpu_set_t set;
+    if (job->cpus != NULL && parse_cpus(job->cpus, &set) &&
+        sched_setaffinity(0, sizeof(set), &set) == -1) {
+        perror("sched_setaffinity failed");
+    }
+}
+
+// Set the CPU and IO priority of a whole process group with one call
+// each, which also covers every process of a pipeline
+static bool set_group_priority(pid_t pgid, int nice_value, int ioprio) {
+    if (setpriority(PRIO_PGRP, pgid, nice_value) == -1) {
+        if (errno != ESRCH) {
+            perror("setpriority failed");
+        }
+        return false;
+    }
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PGRP, pgid, ioprio) == -1 && errno != ESRCH) {
+        perror("ioprio_set failed");
+    }
+    return true;
+}
+
+// Lower every started background job while a foreground job runs
+static void demote_background_jobs() {
+    if (interactive_level == 0) {
+        return;
+    }
+    for (int i = 0; i < MAX_JOBS; i++) {
+        job_t* job = &jobs[i];
+        if (job->job_id == 0 || job->completed || job->demoted || job->state == JOB_QUEUED ||
+            job->pgid <= 0 || i == foreground_job) {
+            continue;
+        }
+        int nice_value = job_nice(job) + interactive_level;
+        if (nice_value > 19) nice_value = 19;
+        bool idle_io = job->idle || interactive_level >= INTERACTIVE_IDLE_IO;
+        job->demoted = set_group_priority(job->pgid, nice_value, ioprio_for(nice_value, idle_io));
+    }
+}
+
+// Put a demoted job back at the priority it was started with. Raising the
+// nice value again needs CAP_SYS_NICE or a matching RLIMIT_NICE.
+static void restore_job(job_t* job) {
+    job->demoted = false;
+    // Jobs started without options had no IO priority set (class none)
+    int ioprio = job->idle || job->priority != 0 ? ioprio_for(job_nice(job), job->idle) : 0;
+    set_group_priority(job->pgid, job_nice(job), ioprio);
+}
+
+// Count background jobs holding a slot: started, not stopped, not in
+// the foreground
+static int running_jobs() {
+    int count = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].job_id > 0 && !jobs[i].completed && jobs[i].state == JOB_RUNNING &&
+            i != foreground_job) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// A job's deadline passed: ask it to stop, then kill it after the grace
+// period. The timer only holds the job ID, since the job may be gone.
+static void job_deadline_expired(int job_id) {
+    job_t* job = find_job_by_id(job_id);
+    if (job == NULL || job->completed || job->state == JOB_QUEUED) {
+        return;
+    }
+    if (!job->timed_out) {
+        job->timed_out = true;
+        kill(-job->pgid, SIGTERM);
+        // A stopped job has to run to see SIGTERM
+        kill(-job->pgid, SIGCONT);
+        add_timer(job->grace, job_deadline_expired, job_id);
+    } else {
+        kill(-job->pgid, SIGKILL);
+    }
+}
+
+// Spooled output is ready: keep it, or show it if the job has the
+// foreground. The watch ends when the job closes its output.
+static void spool_ready(int fd, int job_id) {
+    job_t* job = find_job_by_id(job_id);
+    if (job == NULL || job->spool == NULL) {
+        unwatch_fd(fd);
+        return;
+    }
+    if (!spool_drain(job->spool, job == get_foreground_job())) {
+        unwatch_fd(fd);
+    }
+}
+
+bool start_queued_job(job_t* job, bool foreground) {
+    // The cgroup has to exist before the child can join it
+    if (has_cgroup_limits(&job->limits) && job->cgroup == NULL) {
+        job->cgroup = create_job_cgroup(job->job_id, &job->limits);
+    }
+    // Without a spool the job just writes to the terminal
+    if (!foreground && spool_size > 0 && job->spool == NULL) {
+        job->spool = spool_create(spool_size);
+    }
+
+    // Keep the handler from reaping the child before it has a pidfd
+    sigset_t old_mask;
+    block_sigchld(&old_mask);
+    pid_t pid = spawn_job(job->script ? job->script : job->command, job, foreground);
+    if (pid != -1) {
+        job->pidfd = open_pidfd(pid);
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    if (job->spool != NULL) {
+        spool_close_writer(job->spool);
+        if (pid != -1) {
+            watch_fd(job->spool->read_fd, spool_ready, job->job_id);
+        }
+    }
+    if (pid == -1) {
+        return false;
+    }
+
+    // Set the group here too so it exists before anything signals it
+    setpgid(pid, pid);
+    job->pid = pid;
+    job->pgid = pid;
+    job->state = JOB_RUNNING;
+    job->started_at = event_time();
+    log_job_event("spawn", job);
+    // The deadline counts from the start, not from the time in the queue
+    if (job->deadline > 0) {
+        job->expires_at = monotonic_seconds() + job->deadline;
+        add_timer(job->deadline, job_deadline_expired, job->job_id);
+    }
+    if (!foreground) {
+        printf("[%d] %d\n", job->job_id, (int)pid);
+    }
+    return true;
+}
+
+void dispatch_jobs() {
+    jobs_reaped = 0;
+    int running = running_jobs();
+    while (job_limit == 0 || running < job_limit) {
+        // Lowest nice value first, then submission order
+        job_t* best = NULL;
+        for (int i = 0; i < MAX_JOBS; i++) {
+            job_t* job = &jobs[i];
+            if (job->job_id == 0 || job->state != JOB_QUEUED) continue;
+            int rank = job->idle ? 20 : job->priority;
+            int best_rank = best == NULL ? 0 : best->idle ? 20 : best->priority;
+            if (best == NULL || rank < best_rank || (rank == best_rank && job->job_id < best->job_id)) {
+                best = job;
+            }
+        }
+        if (best == NULL) {
+            return;
+        }
+        if (!start_queued_job(best, false)) {
+            remove_job(best);
+            continue;
+        }
+        running++;
+    }
+}
+
+// Add a queued job with the given options
+static job_t* new_job(const char* command, const job_opts_t* opts) {
+    job_t* job = find_job_by_id(add_job(0, command, false));
+    if (job == NULL) {
+        return NULL;
+    }
+
+    job->state = JOB_QUEUED;
+    job->pgid = 0;
+    job->priority = opts->priority;
+    job->idle = opts->idle;
+    job->cpus = opts->cpus ? strdup(opts->cpus) : NULL;
+    job->limits = opts->limits;
+    job->deadline = opts->deadline;
+    job->grace = opts->grace;
+    return job;
+}
+
+int submit_job(const char* command, const job_opts_t* opts) {
+    job_t* job = new_job(command, opts);
+    if (job == NULL) {
+        return -1;
+    }
+
+    if (job_limit > 0 && running_jobs() >= job_limit) {
+        printf("[%d] queued\n", job->job_id);
+        return job->job_id;
+    }
+    if (!start_queued_job(job, false)) {
+        remove_job(job);
+        return -1;
+    }
+    return job->job_id;
+}
+
+// Quote a word for the command text of a job unless it is plain
+static bool append_quoted(char** text, size_t* len, const char* word) {
+    bool plain = word[0] != '\0' && strpbrk(word, " \t\n|&;<>()$`\\\"'*?[#~") == NULL;
+    size_t need = *len + strlen(word) * 4 + 4;
+    char* grown = realloc(*text, need);
+    if (grown == NULL) {
+        perror("realloc failed");
+        return false;
+    }
+    *text = grown;
+
+    char* o = *text + *len;
+    if (*len > 0) *o++ = ' ';
+    if (plain) {
+        o += sprintf(o, "%s", word);
+    } else {
+        // 'it'\''s' style: close the quote, escape ', reopen
+        *o++ = '\'';
+        for (const char* c = word; *c; c++) {
+            if (*c == '\'') {
+                memcpy(o, "'\\''", 4);
+                o += 4;
+            } else {
+                *o++ = *c;
+            }
+        }
+        *o++ = '\'';
+        *o = '\0';
+    }
+    *len = o - *text;
+    return true;
+}
+
+static void init_job_opts(job_opts_t* opts) {
+    opts->priority = 0;
+    opts->idle = false;
+    opts->cpus = NULL;
+    init_job_limits(&opts->limits);
+    opts->deadline = 0;
+    opts->grace = DEFAULT_GRACE;
+}
+
+// Parse one option of submit or limit and its value; returns false after
+// reporting a bad value, and sets *known to whether opt is an option
+static bool parse_job_option(const char* name, const char* opt, const char* value,
+                             job_opts_t* opts, bool* known) {
+    *known = true;
+    if (strcmp(opt, "-p") == 0) {
+        char* end;
+        if (strcmp(value, "idle") == 0) {
+            opts->idle = true;
+            return true;
+        }
+        long nice_value = strtol(value, &end, 10);
+        if (*end != '\0' || nice_value < -20 || nice_value > 19) {
+            fprintf(stderr, "%s: priority must be a nice value from -20 to 19 or idle\n", name);
+            return false;
+        }
+        opts->priority = (int)nice_value;
+        return true;
+    }
+    if (strcmp(opt, "-c") == 0) {
+        cpu_set_t set;
+        if (!parse_cpus(value, &set)) {
+            fprintf(stderr, "%s: invalid CPU list: %s\n", name, value);
+            return false;
+        }
+        opts->cpus = value;
+        return true;
+    }
+    if (strcmp(opt, "-T") == 0 || strcmp(opt, "-g") == 0) {
+        if (!parse_duration(value, opt[1] == 'T' ? &opts->deadline : &opts->grace)) {
+            fprintf(stderr, "%s: invalid duration: %s\n", name, value);
+            return false;
+        }
+        return true;
+    }
+    int parsed = parse_limit_option(opt, value, &opts->limits);
+    *known = parsed != 0;
+    return parsed >= 0;
+}
+
+// Parse the options in front of a command; returns the index of its first
+// word, or -1 after an error
+static int parse_job_options(const char* name, int argc, char** argv, job_opts_t* opts) {
+    init_job_opts(opts);
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        bool known;
+        if (!parse_job_option(name, argv[i], argv[i + 1], opts, &known)) {
+            return -1;
+        }
+        if (!known) {
+            break;
+        }
+    }
+    if (i >= argc) {
+        fprintf(stderr, "Usage: %s [-p NICE|idle] [-c CPUS] [-v SIZE] [-t SECS] [-n FILES] "
+                "[-m SIZE] [-q PERCENT] [-T DURATION] [-g GRACE] command...\n", name);
+        return -1;
+    }
+    return i;
+}
+
+// Join expanded words into the text of a job. The child parses it again,
+// so every word is quoted back.
+static char* quote_words(int argc, char** argv) {
+    char* command = NULL;
+    size_t len = 0;
+    for (int i = 0; i < argc; i++) {
+        if (!append_quoted(&command, &len, argv[i])) {
+            free(command);
+            return NULL;
+        }
+    }
+    return command;
+}
+
+bool submit_command(int argc, char** argv) {
+    job_opts_t opts;
+    int i = parse_job_options("submit", argc, argv, &opts);
+    if (i < 0) {
+        return false;
+    }
+    char* command = quote_words(argc - i, argv + i);
+    bool ok = command != NULL && submit_job(command, &opts) != -1;
+    free(command);
+    return ok;
+}
+
+// Run words as a foreground job with options
+static bool run_job_foreground(const job_opts_t* opts, int argc, char** argv) {
+    char* command = quote_words(argc, argv);
+    job_t* job = command ? new_job(command, opts) : NULL;
+    free(command);
+    if (job == NULL) {
+        return false;
+    }
+
+    // Started straight away in the foreground, past the running limit
+    if (!start_queued_job(job, true)) {
+        remove_job(job);
+        return false;
+    }
+    int status = foreground_wait(job);
+    set_intrinsic_status(status);
+    return status == 0;
+}
+
+bool limit_command(int argc, char** argv) {
+    job_opts_t opts;
+    int i = parse_job_options("limit", argc, argv, &opts);
+    return i >= 0 && run_job_foreground(&opts, argc - i, argv + i);
+}
+
+bool timeout_command(int argc, char** argv) {
+    job_opts_t opts;
+    init_job_opts(&opts);
+    int i = 1;
+    if (i + 1 < argc && strcmp(argv[i], "-g") == 0) {
+        if (!parse_duration(argv[i + 1], &opts.grace)) {
+            fprintf(stderr, "timeout: invalid duration: %s\n", argv[i + 1]);
+            return false;
+        }
+        i += 2;
+    }
+    if (i + 1 >= argc || !parse_duration(argv[i], &opts.deadline)) {
+        fprintf(stderr, "Usage: timeout [-g GRACE] DURATION command...\n");
+        return false;
+    }
+    return run_job_foreground(&opts, argc - i - 1, argv + i + 1);
+}
+
+int submit_background(const char* command) {
+    job_opts_t opts;
+    init_job_opts(&opts);
+
+    // Only the options of a limit prefix are expanded here; the rest of
+    // the line is left for the job's shell
+    token_list_t tokens = {NULL, 0, 0};
+    size_t start = 0;
+    bool ok = true;
+    char* cpus = NULL;
+    if (lex_line(command, strlen(command), &tokens) && tokens.count > 1 &&
+        tokens.tokens[0].type == TOK_WORD && tokens.tokens[0].length == 5 &&
+        strncmp(command + tokens.tokens[0].offset, "limit", 5) == 0) {
+        int i = 1;
+        for (; ok && i + 1 < tokens.count; i += 2) {
+            const token_t* opt = &tokens.tokens[i];
+            const token_t* value = &tokens.tokens[i + 1];
+            if (opt->type != TOK_WORD || value->type != TOK_WORD || command[opt->offset] != '-') {
+                break;
+            }
+            char* opt_text = expand_word(command + opt->offset, opt->length);
+            char* value_text = expand_word(command + value->offset, value->length);
+            bool known = false;
+            ok = opt_text && value_text &&
+                 parse_job_option("limit", opt_text, value_text, &opts, &known);
+            // A -c list is used until the job copies it
+            if (opts.cpus == value_text) {
+                free(cpus);
+                cpus = value_text;
+                value_text = NULL;
+            }
+            free(opt_text);
+            free(value_text);
+            if (ok && !known) {
+                break;
+            }
+        }
+        if (ok && (i >= tokens.count || tokens.tokens[i].type != TOK_WORD)) {
+            fprintf(stderr, "limit: missing command\n");
+            ok = false;
+        }
+        if (ok) {
+            start = tokens.tokens[i].offset;
+        }
+    }
+    free_tokens(&tokens);
+
+    int job_id = ok ? submit_job(command + start, &opts) : -1;
+    free(cpus);
+    return job_id;
+}
+
+bool sched_command(int argc, char** argv) {
+    if (argc > 1) {
+        if (argc % 2 == 0) {
+            fprintf(stderr, "Usage: sched [-j LIMIT] [-i LEVEL] [-o SIZE]\n");
+            return false;
+        }
+        for (int i = 1; i < argc; i += 2) {
+            char* end;
+            long value = strtol(argv[i + 1], &end, 10);
+            long long size;
+            if (strcmp(argv[i], "-j") == 0 && *end == '\0' && value >= 0) {
+                job_limit = (int)value;
+            } else if (strcmp(argv[i], "-i") == 0 && *end == '\0' && value >= 0 && value <= 19) {
+                interactive_level = (int)value;
+            } else if (strcmp(argv[i], "-o") == 0 && strcmp(argv[i + 1], "0") == 0) {
+                spool_size = 0;
+            } else if (strcmp(argv[i], "-o") == 0 && parse_size(argv[i + 1], &size)) {
+                spool_size = size;
+            } else {
+                fprintf(stderr, "sched: invalid option: %s %s\n", argv[i], argv[i + 1]);
+                return false;
+            }
+        }
+        dispatch_jobs();
+        return true;
+    }
+
+    int queued = 0;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].job_id > 0 && jobs[i].state == JOB_QUEUED) queued++;
+    }
+    if (job_limit > 0) {
+        printf("limit: %d\n", job_limit);
+    } else {
+        printf("limit: none\n");
+    }
+    if (interactive_level > 0) {
+        printf("interactive: %d%s\n", interactive_level,
+               interactive_level >= INTERACTIVE_IDLE_IO ? " (idle IO)" : "");
+    } else {
+        printf("interactive: off\n");
+    }
+    if (spool_size > 0) {
+        char size[16];
+        format_size(spool_size, size, sizeof(size));
+        printf("spool: %s\n", size);
+    } else {
+        printf("spool: off\n");
+    }
+    printf("running: %d\nqueued: %d\n", running_jobs(), queued);
+    return true;
+}
+
+bool peek_command(int argc, char** argv) {
+    int lines = 10;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "-n") == 0) {
+        char* end;
+        lines = (int)strtol(argv[arg + 1], &end, 10);
+        if (*end != '\0' || lines <= 0) {
+            fprintf(stderr, "peek: invalid line count: %s\n", argv[arg + 1]);
+            return false;
+        }
+        arg += 2;
+    }
+    if (argc > arg + 1) {
+        fprintf(stderr, "Usage: peek [-n LINES] [JOB]\n");
+        return false;
+    }
+
+    int job_id = get_most_recent_job();
+    if (arg < argc && sscanf(argv[arg], "%d", &job_id) != 1) {
+        fprintf(stderr, "Invalid job ID\n");
+        return false;
+    }
+    job_t* job = find_job_by_id(job_id);
+    if (job == NULL) {
+        fprintf(stderr, "No such job\n");
+        return false;
+    }
+    if (job->spool == NULL) {
+        fprintf(stderr, "peek: job %d has no spooled output\n", job_id);
+        return false;
+    }
+    spool_drain(job->spool, false);
+    spool_tail(job->spool, lines);
+    return true;
+}
+
+// Reap a job whose pidfd reported that it exited, as the SIGCHLD handler
+// would if it were not blocked
+static void reap_job(job_t* job) {
+    int status;
+    if (!job->completed && wait4(job->pid, &status, WNOHANG, &job->usage) == job->pid) {
+        job->completed = true;
+        job->status = status;
+        job->ended_at = event_time();
+        jobs_reaped = 1;
+    }
+}
+
+// Collect a job whose pidfd reported that it exited and free its entry;
+// returns its exit status. SIGCHLD is blocked, so the zombie is still
+// there unless the handler reaped it before.
+static int collect_job(job_t* job) {
+    if (job == NULL) {
+        // A queued job that failed to start is gone already
+        return EXIT_FAILURE;
+    }
+    reap_job(job);
+    int status = job->status;
+    log_job_exit(job, status, &job->usage);
+    remove_job(job);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+// Watch the pidfd of every started job not watched yet, with its slot as
+// the event data. Any exit frees a slot for queued jobs, so jobs that are
+// not waited for are watched too.
+static void watch_started_jobs(int epfd, bool* watched) {
+    for (int i = 0; i < MAX_JOBS; i++) {
+        job_t* job = &jobs[i];
+        if (watched[i] || job->job_id == 0 || job->completed || job->state == JOB_QUEUED ||
+            job->pidfd == -1) {
+            continue;
+        }
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.u32 = (uint32_t)i;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, job->pidfd, &event) == -1) {
+            perror("epoll_ctl failed");
+            continue;
+        }
+        watched[i] = true;
+    }
+}
+
+// Collect the waited jobs that can no longer report an exit: finished
+// ones, started ones without a watched pidfd, and queued ones that failed
+// to start. Returns the status of the last one collected, or -1.
+static int collect_unwatched(const int* waited_ids, bool* waited, const bool* watched,
+                             int* remaining) {
+    int status = -1;
+    for (int i = 0; i < MAX_JOBS; i++) {
+        if (!waited[i]) continue;
+        job_t* job = &jobs[i];
+        if (job->job_id != waited_ids[i]) {
+            status = collect_job(NULL);
+        } else if (job->completed || (job->state != JOB_QUEUED && !watched[i])) {
+            status = collect_job(job);
+        } else {
+            continue;
+        }
+        waited[i] = false;
+        (*remaining)--;
+    }
+    return status;
+}
+
+bool wait_command(int argc, char** argv) {
+    bool any = false;
+    double timeout = 0;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (strcmp(argv[arg], "-n") == 0) {
+            any = true;
+        } else if (strcmp(argv[arg], "--timeout") == 0 && arg + 1 < argc &&
+                   parse_duration(argv[arg + 1], &timeout)) {
+            arg++;
+        } else {
+            fprintf(stderr, "Usage: wait [-n] [--timeout DURATION] [JOB...]\n");
+            return false;
+        }
+    }
+
+    // The jobs named, or every running and queued one, by slot; the ids
+    // tell a queued job that failed to start from one reusing its slot
+    int* waited_ids = calloc(MAX_JOBS, sizeof(int));
+    bool* waited = calloc(MAX_JOBS, sizeof(bool));
+    bool* watched = calloc(MAX_JOBS, sizeof(bool));
+    if (waited_ids == NULL || waited == NULL || watched == NULL) {
+        perror("calloc failed");
+        free(waited_ids);
+        free(waited);
+        free(watched);
+        return false;
+    }
+    bool named = arg < argc;
+    int count = 0;
+    for (; arg < argc; arg++) {
+        job_t* job = NULL;
+        int job_id;
+        if (sscanf(argv[arg], "%d", &job_id) == 1) {
+            job = find_job_by_id(job_id);
+        }
+        if (job == NULL) {
+            fprintf(stderr, "wait: no such job: %s\n", argv[arg]);
+            free(waited_ids);
+            free(waited);
+            free(watched);
+            set_intrinsic_status(127);
+            return false;
+        }
+        if (!waited[job - jobs]) {
+            waited[job - jobs] = true;
+            waited_ids[job - jobs] = job_id;
+            count++;
+        }
+    }
+    if (!named) {
+        for (int i = 0; i < MAX_JOBS; i++) {
+            if (jobs[i].job_id > 0 && jobs[i].state != JOB_STOPPED) {
+                waited[i] = true;
+                waited_ids[i] = jobs[i].job_id;
+                count++;
+            }
+        }
+    }
+    if (count == 0) {
+        free(waited_ids);
+        free(waited);
+        free(watched);
+        if (any) {
+            set_intrinsic_status(127);
+        }
+        return !any;
+    }
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1) {
+        perror("epoll_create1 failed");
+        free(waited_ids);
+        free(waited);
+        free(watched);
+        return false;
+    }
+
+    // The handler stays out of the way so each job is collected here;
+    // slots it freed before that go to queued jobs first
+    sigset_t old_mask;
+    block_sigchld(&old_mask);
+    if (jobs_reaped) {
+        dispatch_jobs();
+    }
+
+    // Jobs that already finished are collected at once
+    int status = EXIT_SUCCESS;
+    int remaining = count;
+    watch_started_jobs(epfd, watched);
+    int collected = collect_unwatched(waited_ids, waited, watched, &remaining);
+    if (collected >= 0) {
+        status = collected;
+    }
+
+    double deadline = timeout > 0 ? monotonic_seconds() + timeout : 0;
+    struct epoll_event events[64];
+    while (remaining > 0 && !(any && remaining < count)) {
+        if (vm_interrupted) {
+            status = 130;
+            break;
+        }
+        if (deadline > 0 && monotonic_seconds() >= deadline) {
+            status = 124;
+            break;
+        }
+        if (!wait_readable_until(epfd, deadline)) {
+            continue;
+        }
+
+        // Only the jobs that finished are looked at
+        int ready = epoll_wait(epfd, events, 64, 0);
+        for (int e = 0; e < ready; e++) {
+            int i = (int)events[e].data.u32;
+            epoll_ctl(epfd, EPOLL_CTL_DEL, jobs[i].pidfd, NULL);
+            watched[i] = false;
+            if (waited[i]) {
+                status = collect_job(&jobs[i]);
+                waited[i] = false;
+                remaining--;
+            } else {
+                reap_job(&jobs[i]);
+            }
+        }
+
+        // Freed slots start queued jobs, which may be waited for
+        if (ready > 0) {
+            dispatch_jobs();
+            watch_started_jobs(epfd, watched);
+            collected = collect_unwatched(waited_ids, waited, watched, &remaining);
+            if (collected >= 0) {
+                status = collected;
+            }
+        }
+    }
+
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    close(epfd);
+    free(waited_ids);
+    free(waited);
+    free(watched);
+    set_intrinsic_status(status);
+    return status == 0;
+}
 // ############## LLM Generated Code Ends ################
\ No newline at end of file
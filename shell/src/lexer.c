@@ -0,0 +1,385 @@
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define LEXER_X86 1
+#endif
+// ############## LLM Generated Code Begins ##############
+
+// Bytes that end a run of ordinary word characters:
+// whitespace, operators, quotes, backslash and '$'
+static const char special_chars[] = " \t\n|&;<>\"'\\$";
+
+static bool special_table[256];
+static bool table_ready = false;
+
+static void init_special_table() {
+    for (const char* c = special_chars; *c; c++) {
+        special_table[(unsigned char)*c] = true;
+    }
+    table_ready = true;
+}
+
+static size_t scan_special_scalar(const char* s, size_t len) {
+    size_t i = 0;
+    while (i < len && !special_table[(unsigned char)s[i]]) {
+        i++;
+    }
+    return i;
+}
+
+#ifdef LEXER_X86
+// 16 bytes at a time: compare against every special byte and OR the masks
+__attribute__((target("sse2")))
+static size_t scan_special_sse2(const char* s, size_t len) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i pipe_ = _mm_set1_epi8('|');
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i semi = _mm_set1_epi8(';');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i dquote = _mm_set1_epi8('"');
+    const __m128i squote = _mm_set1_epi8('\'');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i dollar = _mm_set1_epi8('$');
+
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, newline));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, pipe_));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, amp));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, semi));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, lt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, gt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, dquote));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, squote));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, backslash));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, dollar));
+
+        int mask = _mm_movemask_epi8(m);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scan_special_scalar(s + i, len - i);
+}
+
+// 32 bytes at a time with a nibble lookup: a byte is special when the bit
+// sets selected by its low and high nibbles intersect.
+//   bit 0: high nibble 0 -> \t \n
+//   bit 1: high nibble 2 -> space " $ & '
+//   bit 2: high nibble 3 -> ; < >
+//   bit 3: high nibble 5 or 7 -> \ |
+__attribute__((target("avx2")))
+static size_t scan_special_avx2(const char* s, size_t len) {
+    const __m256i lo_table = _mm256_setr_epi8(
+        2, 0, 2, 0, 2, 0, 2, 2, 0, 1, 1, 4, 12, 0, 4, 0,
+        2, 0, 2, 0, 2, 0, 2, 2, 0, 1, 1, 4, 12, 0, 4, 0);
+    const __m256i hi_table = _mm256_setr_epi8(
+        1, 0, 2, 4, 0, 8, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 0, 2, 4, 0, 8, 0, 8, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(v, nibble));
+        __m256i hi = _mm256_shuffle_epi8(hi_table,
+                                         _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        __m256i hit = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero);
+
+        unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(hit);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scan_special_sse2(s + i, len - i);
+}
+#endif
+
+typedef size_t (*scan_fn_t)(const char*, size_t);
+static scan_fn_t scan_special = NULL;
+static lexer_impl_t current_impl = LEXER_SCALAR;
+
+bool lexer_set_impl(lexer_impl_t impl) {
+    if (!table_ready) {
+        init_special_table();
+    }
+
+    switch (impl) {
+    case LEXER_SCALAR:
+        scan_special = scan_special_scalar;
+        break;
+#ifdef LEXER_X86
+    case LEXER_SSE2:
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("sse2")) return false;
+        scan_special = scan_special_sse2;
+        break;
+    case LEXER_AVX2:
+        __builtin_cpu_init();
+        if (!__builtin_cpu_supports("avx2")) return false;
+        scan_special = scan_special_avx2;
+        break;
+#endif
+    default:
+        return false;
+    }
+
+    current_impl = impl;
+    return true;
+}
+
+lexer_impl_t lexer_get_impl() {
+    return current_impl;
+}
+
+// Pick the widest scanner the CPU supports
+static void init_scanner() {
+    if (!lexer_set_impl(LEXER_AVX2) && !lexer_set_impl(LEXER_SSE2)) {
+        lexer_set_impl(LEXER_SCALAR);
+    }
+}
+
+const char* skip_substitution(const char* p) {
+    int depth = 0;
+    char quote = '\0';
+
+    // p[0] is '$', p[1] is the opening parenthesis
+    for (p++; *p; p++) {
+        if (*p == '\\' && quote != '\'' && p[1] != '\0') {
+            p++;
+            continue;
+        }
+
+        if (quote) {
+            if (*p == quote) quote = '\0';
+            continue;
+        }
+
+        if (*p == '\'' || *p == '"') {
+            quote = *p;
+        } else if (*p == '(') {
+            depth++;
+        } else if (*p == ')' && --depth == 0) {
+            return p + 1;
+        }
+    }
+
+    return NULL;
+}
+
+const char* token_text(token_type_t type) {
+    switch (type) {
+    case TOK_PIPE: return "|";
+    case TOK_AMP: return "&";
+    case TOK_SEMI: return ";";
+    case TOK_NEWLINE: return "\n";
+    case TOK_AND_IF: return "&&";
+    case TOK_OR_IF: return "||";
+    case TOK_LT: return "<";
+    case TOK_GT: return ">";
+    case TOK_DGT: return ">>";
+    case TOK_HEREDOC: return "<<";
+    case TOK_HEREDOC_TAB: return "<<-";
+    case TOK_HERESTRING: return "<<<";
+    default: return "";
+    }
+}
+
+bool is_redirection_token(token_type_t type) {
+    return type == TOK_LT || type == TOK_GT || type == TOK_DGT ||
+           type == TOK_HEREDOC || type == TOK_HEREDOC_TAB || type == TOK_HERESTRING;
+}
+
+static bool push_token(token_list_t* list, token_type_t type, size_t offset, size_t length) {
+    if (list->count == list->cap) {
+        int cap = list->cap ? list->cap * 2 : 32;
+        token_t* tokens = realloc(list->tokens, cap * sizeof(token_t));
+        if (tokens == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        list->tokens = tokens;
+        list->cap = cap;
+    }
+
+    list->tokens[list->count].type = type;
+    list->tokens[list->count].offset = (uint32_t)offset;
+    list->tokens[list->count].length = (uint32_t)length;
+    list->count++;
+    return true;
+}
+
+// Scan the rest of a word starting at i; returns its end or -1 on error
+static long scan_word(const char* s, size_t len, size_t i) {
+    while (i < len) {
+        i += scan_special(s + i, len - i);
+        if (i >= len) break;
+
+        char c = s[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '|' || c == '&' ||
+            c == ';' || c == '<' || c == '>') {
+            break;
+        }
+
+        if (c == '\\') {
+            i += (i + 1 < len) ? 2 : 1;
+        } else if (c == '\'') {
+            const char* close = memchr(s + i + 1, '\'', len - i - 1);
+            if (close == NULL) return -1;
+            i = close - s + 1;
+        } else if (c == '"') {
+            // Inside double quotes only '"', '\' and "$(" matter
+            i++;
+            while (1) {
+                if (i >= len) return -1;
+                i += scan_special(s + i, len - i);
+                if (i >= len) return -1;
+                if (s[i] == '"') {
+                    i++;
+                    break;
+                }
+                if (s[i] == '\\') {
+                    i += 2;
+                } else if (s[i] == '$' && s[i + 1] == '(') {
+                    const char* end = skip_substitution(s + i);
+                    if (end == NULL) return -1;
+                    i = end - s;
+                } else {
+                    i++;
+                }
+            }
+        } else if (c == '$' && i + 1 < len && s[i + 1] == '(') {
+            const char* end = skip_substitution(s + i);
+            if (end == NULL) return -1;
+            i = end - s;
+        } else {
+            i++;
+        }
+    }
+    return (long)(i > len ? len : i);
+}
+
+bool lex_line(const char* input, size_t len, token_list_t* out) {
+    if (scan_special == NULL) {
+        init_scanner();
+    }
+
+    out->count = 0;
+    size_t i = 0;
+
+    while (i < len) {
+        char c = input[i];
+        if (c == ' ' || c == '\t') {
+            i++;
+            continue;
+        }
+
+        // A # starting a word comments out the rest of the line
+        if (c == '#') {
+            const char* nl = memchr(input + i, '\n', len - i);
+            i = nl ? (size_t)(nl - input) : len;
+            continue;
+        }
+
+        token_type_t type;
+        size_t length = 1;
+        switch (c) {
+        case '\n':
+            type = TOK_NEWLINE;
+            break;
+        case '|':
+            type = TOK_PIPE;
+            if (input[i + 1] == '|') {
+                type = TOK_OR_IF;
+                length = 2;
+            }
+            break;
+        case '&':
+            type = TOK_AMP;
+            if (input[i + 1] == '&') {
+                type = TOK_AND_IF;
+                length = 2;
+            }
+            break;
+        case ';':
+            type = TOK_SEMI;
+            break;
+        case '>':
+            type = TOK_GT;
+            if (input[i + 1] == '>') {
+                type = TOK_DGT;
+                length = 2;
+            }
+            break;
+        case '<':
+            type = TOK_LT;
+            if (input[i + 1] == '<') {
+                type = TOK_HEREDOC;
+                length = 2;
+                if (input[i + 2] == '<') {
+                    type = TOK_HERESTRING;
+                    length = 3;
+                } else if (input[i + 2] == '-') {
+                    type = TOK_HEREDOC_TAB;
+                    length = 3;
+                }
+            }
+            break;
+        default: {
+            long end = scan_word(input, len, i);
+            if (end < 0) {
+                return false;
+            }
+            if (!push_token(out, TOK_WORD, i, end - i)) {
+                return false;
+            }
+            i = end;
+            continue;
+        }
+        }
+
+        if (!push_token(out, type, i, length)) {
+            return false;
+        }
+        i += length;
+    }
+
+    return true;
+}
+
+size_t lex_dequote(const char* src, size_t len, char* dst) {
+    char quote = '\0';
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = src[i];
+        if (quote == '\'') {
+            if (c == '\'') quote = '\0';
+            else dst[n++] = c;
+        } else if ((c == '\'' && quote == '\0') || c == '"') {
+            quote = quote == c ? '\0' : c;
+        } else if (c == '\\' && i + 1 < len &&
+                   (quote == '\0' || strchr("$`\"\\", src[i + 1]) != NULL)) {
+            dst[n++] = src[++i];
+        } else {
+            dst[n++] = c;
+        }
+    }
+    return n;
+}
+
+void free_tokens(token_list_t* list) {
+    free(list->tokens);
+    list->tokens = NULL;
+    list->count = 0;
+    list->cap = 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
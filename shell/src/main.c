@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #define _POSIX_C_SOURCE 200809L
 #define _XOPEN_SOURCE 700
 #include "prompt.h"
@@ -11,13 +12,25 @@
 #include <unistd.h>
 #include <limits.h>
 #include "executor.h"
+#include "variables.h"
+#include "heredoc.h"
 #include "jobs.h"
+#include "vm.h"
+#include "expand.h"
+#include "lexer.h"
+#include "eventlog.h"
+#include "probes.h"
+#include "record.h"
+#include "serve.h"
+#include "rcfile.h"
+#include "timers.h"
 #include <signal.h>
 #include <termios.h>
 #include <setjmp.h>
 #include <errno.h>
 #include <sys/wait.h>
 #include <sys/types.h>
+#include <fcntl.h>
 // ############## LLM Generated Code Begins ##############
 static pid_t shell_pgid;
 static struct termios shell_tmodes;
@@ -25,21 +38,28 @@ static int shell_terminal;
 static int shell_is_interactive;
 static sigjmp_buf env_alrm;
 static volatile sig_atomic_t jump_active = 0;
+static bool batch_mode = false;
+static const char* serve_path = NULL;
+static bool startup_time = false;
 
 void sigchld_handler(int sig) {
     // Save errno in case waitpid changes it
     int saved_errno = errno;
     int status;
     pid_t pid;
+    struct rusage usage;
     
     // Reap ALL zombie children, not just those we track
-    while((pid = waitpid(-1, &status, WNOHANG)) > 0){
+    while((pid = wait4(-1, &status, WNOHANG, &usage)) > 0){
         // Try to find and update job if it exists in our tracking
         job_t* job = find_job_by_pid(pid);
         if (job) {
             if (WIFEXITED(status) || WIFSIGNALED(status)) {
+                job->usage = usage;
+                job->ended_at = event_time();
                 job->completed = true;
                 job->status = status;
+                jobs_reaped = 1;
             } else if (WIFSTOPPED(status)) {
                 job->state = JOB_STOPPED;
             }
@@ -53,7 +73,8 @@ void sigchld_handler(int sig) {
 }
 
 void sigint_handler(int sig) {
-    // Ctrl+C handler
+    // Ctrl+C handler; also stops a running loop
+    vm_interrupted = 1;
     job_t* fg_job = get_foreground_job();
     if (fg_job) {
         // Send SIGINT to foreground process group
@@ -107,7 +128,7 @@ void init_shell() {
     sa.sa_handler = sigint_handler;
     sigaction(SIGINT, &sa, NULL);
     shell_terminal = STDIN_FILENO;
-    shell_is_interactive = isatty(shell_terminal);
+    shell_is_interactive = !batch_mode && isatty(shell_terminal);
 
     if (shell_is_interactive) {
         // Loop until we are in the foreground
@@ -143,10 +164,404 @@ void init_shell() {
         sigaction(SIGCHLD, &sa, NULL);
     }
 }
+
+// Join src onto buf after a separator, growing buf as needed
+static char* append_line(char* buf, const char* separator, const char* src) {
+    size_t len = buf ? strlen(buf) : 0;
+    char* joined = realloc(buf, len + strlen(separator) + strlen(src) + 1);
+    if (joined == NULL) {
+        perror("realloc failed");
+        free(buf);
+        return NULL;
+    }
+    if (len == 0) joined[0] = '\0';
+    strcat(joined, separator);
+    strcat(joined, src);
+    return joined;
+}
+
+// A command being read: its text with here-documents replaced, the text
+// as typed for the log, and the same with here-document bodies for
+// session recordings
+typedef struct {
+    capture_buf_t text;
+    capture_buf_t raw;
+    capture_buf_t typed;
+} pending_cmd_t;
+
+// Append a line to a NUL-terminated buffer, after a newline if needed
+static bool append_text(capture_buf_t* buf, const char* line) {
+    bool ok = (buf->len == 0 || capture_append(buf, "\n", 1)) &&
+              capture_append(buf, line, strlen(line));
+    if (ok) {
+        buf->data[buf->len] = '\0';
+    }
+    return ok;
+}
+
+// Add one physical line, reading the bodies of its here-documents
+static bool add_line(pending_cmd_t* cmd, const char* line) {
+    if (!append_text(&cmd->typed, line)) {
+        return false;
+    }
+    char* rewritten = collect_heredocs(line, &cmd->typed);
+    if (rewritten == NULL) {
+        return false;
+    }
+
+    bool ok = append_text(&cmd->text, rewritten) && append_text(&cmd->raw, line);
+    free(rewritten);
+    return ok;
+}
+
+// Compound commands left open by the lines of a command, counted from
+// the reserved words of each line between full parses
+typedef struct {
+    int depth;
+    bool trusted;      // False once the count may have lost track
+} nesting_t;
+
+static bool token_is(const char* line, const token_t* tok, const char* word) {
+    return tok->type == TOK_WORD && tok->length == strlen(word) &&
+           memcmp(line + tok->offset, word, tok->length) == 0;
+}
+
+// Count the compound commands a line opens and closes. Reserved words only
+// count where the parser takes them, in command position, and a "{" also
+// after a function name. A line that does not lex on its own, such as one
+// inside a quote spanning lines, makes the count untrusted.
+static void track_nesting(nesting_t* nest, const char* line) {
+    static const char* const openers[] = {"if", "while", "until", "for"};
+    static const char* const closers[] = {"fi", "done", "}"};
+    static const char* const leaders[] = {"then", "do", "else", "elif", "time", "!"};
+    token_list_t tokens = {NULL, 0, 0};
+    if (!lex_line(line, strlen(line), &tokens)) {
+        nest->trusted = false;
+        free_tokens(&tokens);
+        return;
+    }
+
+    bool command = true;
+    bool body_next = false;   // A "{" here starts a function body
+    bool name_next = false;   // After "function"
+    for (int i = 0; i < tokens.count; i++) {
+        const token_t* tok = &tokens.tokens[i];
+        if (tok->type != TOK_WORD) {
+            command = !is_redirection_token(tok->type);
+            body_next = name_next = false;
+            continue;
+        }
+
+        bool opener = false, closer = false, leader = false;
+        for (size_t k = 0; command && k < sizeof(openers) / sizeof(openers[0]); k++) {
+            opener |= token_is(line, tok, openers[k]);
+        }
+        for (size_t k = 0; command && k < sizeof(closers) / sizeof(closers[0]); k++) {
+            closer |= token_is(line, tok, closers[k]);
+        }
+        for (size_t k = 0; command && k < sizeof(leaders) / sizeof(leaders[0]); k++) {
+            leader |= token_is(line, tok, leaders[k]);
+        }
+
+        if (token_is(line, tok, "{") && (command || body_next)) {
+            nest->depth++;
+            command = true;
+            body_next = false;
+        } else if (opener) {
+            nest->depth++;
+            // A for is followed by its variable, the others by a command
+            command = !token_is(line, tok, "for");
+        } else if (closer) {
+            nest->depth--;
+            command = false;
+        } else if (leader) {
+            command = true;
+        } else if (command && token_is(line, tok, "function")) {
+            name_next = true;
+            command = false;
+        } else {
+            body_next = name_next || token_is(line, tok, "()") ||
+                        (tok->length > 2 && memcmp(line + tok->offset + tok->length - 2, "()", 2) == 0);
+            name_next = false;
+            command = false;
+        }
+    }
+    free_tokens(&tokens);
+}
+
+// Read the command starting with line, taking more lines while an if,
+// loop, quote or && is still open. When batch input is already buffered
+// the text is not re-parsed while the lines read leave a compound command
+// open, so a long construct is not parsed once per line, and the command
+// still ends at the line that closes it.
+static parse_status_t read_command(pending_cmd_t* cmd, const char* line, bool prompt) {
+    memset(cmd, 0, sizeof(*cmd));
+    if (!add_line(cmd, line)) {
+        return PARSE_ERROR;
+    }
+
+    nesting_t nest = {0, true};
+    track_nesting(&nest, line);
+    parse_status_t status = parse_script(cmd->text.data, NULL);
+    size_t parsed_len = cmd->text.len;
+    while (status == PARSE_INCOMPLETE) {
+        // Incomplete with nothing open: a quote or an operator the count
+        // does not follow
+        if (nest.depth <= 0) {
+            nest.trusted = false;
+        }
+        if (prompt) {
+            printf("> ");
+            fflush(stdout);
+        }
+
+        char* more = get_user_input();
+        if (more == NULL) {
+            if (parsed_len != cmd->text.len) {
+                status = parse_script(cmd->text.data, NULL);
+            }
+            break;
+        }
+
+        bool ok = add_line(cmd, more);
+        if (ok && nest.trusted) {
+            track_nesting(&nest, more);
+        }
+        free(more);
+        if (!ok) {
+            return PARSE_ERROR;
+        }
+        if (input_pending() && nest.trusted && nest.depth > 0) {
+            continue;
+        }
+        status = parse_script(cmd->text.data, NULL);
+        parsed_len = cmd->text.len;
+    }
+    return status;
+}
+
+static void free_pending(pending_cmd_t* cmd) {
+    free(cmd->text.data);
+    free(cmd->raw.data);
+    free(cmd->typed.data);
+}
+
+// Check whether text, without trailing blanks, ends with suffix
+static bool ends_with(const char* text, size_t len, const char* suffix) {
+    size_t n = strlen(suffix);
+    return len >= n && memcmp(text + len - n, suffix, n) == 0;
+}
+
+// A one-line form of a multi-line command for the log: lines ending in
+// an operator or opening word are joined with a space, others with "; "
+static char* flatten_for_log(const char* command) {
+    static const char* const openers[] = {"|", "&&", "||", ";", "then", "do", "else", "{"};
+    char* flat = NULL;
+    const char* line = command;
+    while (1) {
+        const char* nl = strchr(line, '\n');
+        char* part = strndup(line, nl ? (size_t)(nl - line) : strlen(line));
+        if (part == NULL) {
+            free(flat);
+            return NULL;
+        }
+
+        const char* separator = "";
+        const char* text = part;
+        if (flat != NULL) {
+            while (isspace((unsigned char)*text)) text++;
+            size_t len = strlen(flat);
+            while (len > 0 && isspace((unsigned char)flat[len - 1])) len--;
+            separator = "; ";
+            for (size_t i = 0; i < sizeof(openers) / sizeof(openers[0]); i++) {
+                if (ends_with(flat, len, openers[i])) separator = " ";
+            }
+        }
+        flat = append_line(flat, separator, text);
+        free(part);
+        if (flat == NULL || nl == NULL) {
+            return flat;
+        }
+        line = nl + 1;
+    }
+}
+// Run -c text, a script or piped input: no prompt and no history, and a
+// syntax error stops the script like in other shells
+static int run_batch() {
+    while (1) {
+        uint64_t start = probe_start();
+        char* line = get_user_input();
+        probe_end(PROBE_INPUT, start);
+        if (line == NULL) {
+            break;
+        }
+        if (line[0] == '\0') {
+            free(line);
+            continue;
+        }
+
+        pending_cmd_t cmd;
+        parse_status_t status = read_command(&cmd, line, false);
+        free(line);
+        if (status != PARSE_OK) {
+            fprintf(stderr, status == PARSE_INCOMPLETE ? "Unexpected end of command\n"
+                                                       : "Invalid Syntax!\n");
+            free_pending(&cmd);
+            set_last_status(2);
+            break;
+        }
+
+        start = probe_start();
+        record_begin();
+        execute_command(cmd.text.data);
+        record_end(cmd.typed.data, get_last_status());
+        probe_end(PROBE_EXECUTE, start);
+        free_pending(&cmd);
+        if (vm_exit_requested) {
+            break;
+        }
+    }
+
+    fflush(stdout);
+    cleanup_jobs();
+    return get_last_status();
+}
+
+// Run the text of a --serve request, in its forked shell, like -c text
+static int run_request(const char* text) {
+    if (!input_from_string(text)) {
+        return 1;
+    }
+    return run_batch();
+}
+
+// Pick the input source from the command line:
+//   shell.out -c CMDS [NAME [ARGS...]]
+//   shell.out SCRIPT [ARGS...]
+// and piped stdin with no arguments. Returns false on a usage error.
+static bool select_input(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+        if (argc < 3) {
+            fprintf(stderr, "%s: -c: option requires an argument\n", argv[0]);
+            return false;
+        }
+        if (argc > 3) {
+            vm_set_script_args(argv[3], argc - 4, argv + 4);
+        }
+        batch_mode = true;
+        return input_from_string(argv[2]);
+    }
+
+    if (argc > 1) {
+        int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+            return false;
+        }
+        vm_set_script_args(argv[1], argc - 2, argv + 2);
+        input_from_fd(fd);
+        batch_mode = true;
+        return true;
+    }
+
+    if (!isatty(STDIN_FILENO)) {
+        input_from_fd(STDIN_FILENO);
+        batch_mode = true;
+    }
+    return true;
+}
+
+// Take the leading session options and return the index of the first
+// other argument, or -1 on a usage error:
+//   --record FILE   record every command run to FILE
+//   --replay FILE   run the commands recorded in FILE and compare
+//   --paced         replay at the recorded pace instead of at once
+//   --quiet         hash the replayed output without showing it
+//   --serve PATH    run requests from a UNIX socket instead of any input
+//   --startup-time  report where startup went; also reads ~/.shellrc
+//                   when not interactive, so scripts can measure it
+static int session_options(int argc, char** argv) {
+    const char* record = NULL;
+    const char* replay = NULL;
+    bool paced = false;
+    bool quiet = false;
+    int i = 1;
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--paced") == 0) {
+            paced = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (strcmp(argv[i], "--startup-time") == 0) {
+            startup_time = true;
+        } else {
+            break;
+        }
+    }
+    if ((paced || quiet) && replay == NULL) {
+        fprintf(stderr, "%s: --paced and --quiet need --replay\n", argv[0]);
+        return -1;
+    }
+    if ((replay != NULL || serve_path != NULL) && i < argc) {
+        fprintf(stderr, "%s: %s runs no other input\n", argv[0], replay ? "--replay" : "--serve");
+        return -1;
+    }
+    if (replay != NULL && serve_path != NULL) {
+        fprintf(stderr, "%s: --replay and --serve do not mix\n", argv[0]);
+        return -1;
+    }
+    if (record != NULL && !start_recording(record)) {
+        return -1;
+    }
+    if (replay != NULL && !start_replay(replay, paced, quiet)) {
+        return -1;
+    }
+    return i;
+}
+
+// Print the --startup-time report to stderr
+static void report_startup(double init, const rc_timing_t* rc) {
+    static const char* const sources[] = {"no rc file", "snapshot", "compiled", "failed"};
+    char total[32], init_text[32], check[32], load[32], run[32], size[32], snapshot[32];
+    format_duration(init + rc->check + rc->load + rc->run, total, sizeof(total));
+    format_duration(init, init_text, sizeof(init_text));
+    format_duration(rc->check, check, sizeof(check));
+    format_duration(rc->load, load, sizeof(load));
+    format_duration(rc->run, run, sizeof(run));
+    format_size(rc->size, size, sizeof(size));
+    format_size(rc->snapshot, snapshot, sizeof(snapshot));
+
+    fprintf(stderr, "startup   %s\n", total);
+    fprintf(stderr, "  init    %s\n", init_text);
+    fprintf(stderr, "  check   %s  (~/.shellrc, %s)\n", check, size);
+    fprintf(stderr, "  load    %s  (%s, %s snapshot)\n", load, sources[rc->source], snapshot);
+    fprintf(stderr, "  run     %s\n", run);
+}
 // ############## LLM Generated Code Ends ################
-int main() {
+int main(int argc, char** argv) {
+    // ############## LLM Generated Code Begins ##############
+    double started = monotonic_seconds();
+    int first = session_options(argc, argv);
+    if (first == -1) {
+        return 2;
+    }
+    // The remaining arguments, as if they were the only ones
+    argv[first - 1] = argv[0];
+    if (serve_path != NULL) {
+        batch_mode = true;
+    } else if (!replaying() && !select_input(argc - first + 1, argv + first - 1)) {
+        return 2;
+    }
+    init_probes();
+    // ############## LLM Generated Code Ends ################
     init_shell();
     init_jobs();
+    init_variables();
     char* home_directory = get_home_directory();
     if (home_directory == NULL) {
         perror("Error getting home directory");
@@ -154,6 +569,28 @@ int main() {
     }
     
     set_shell_home(home_directory);
+
+    // ############## LLM Generated Code Begins ##############
+    if ((shell_is_interactive && !replaying()) || startup_time) {
+        rc_timing_t rc;
+        double init = monotonic_seconds() - started;
+        run_rcfile(&rc);
+        if (startup_time) {
+            report_startup(init, &rc);
+        }
+    }
+    if (serve_path != NULL) {
+        int status = serve(serve_path, run_request);
+        cleanup_jobs();
+        free(home_directory);
+        return status;
+    }
+    if (batch_mode) {
+        int status = run_batch();
+        free(home_directory);
+        return status;
+    }
+    // ############## LLM Generated Code Ends ################
     
     while(1){
         check_jobs();
@@ -162,18 +599,34 @@ int main() {
         }
         
         jump_active = 1;
-        display_prompt(home_directory);
+        // ############## LLM Generated Code Begins ##############
+        uint64_t start = probe_start();
+        if (!replaying()) {
+            display_prompt(home_directory);
+        }
+        probe_end(PROBE_PROMPT, start);
         
+        start = probe_start();
         char* user_input = get_user_input();
+        probe_end(PROBE_INPUT, start);
+        // ############## LLM Generated Code Ends ################
         jump_active = 0;
     
         if(user_input==NULL){
+            // ############## LLM Generated Code Begins ##############
+            if (replaying()) {
+                int status = finish_replay();
+                cleanup_jobs();
+                free(home_directory);
+                exit(status);
+            }
+            // ############## LLM Generated Code Ends ################
             if (isatty(STDIN_FILENO)) {
                 printf("logout\n");
                 
                 for (int i = 0; i < MAX_JOBS; i++) {
                     job_t* job = &jobs[i];
-                    if (job->job_id > 0 && !job->completed) {
+                    if (job->job_id > 0 && !job->completed && job->pid > 0) {
                         kill(job->pid, SIGKILL);
                     }
                 }
@@ -189,31 +642,39 @@ int main() {
             }
         }
         
+        // ############## LLM Generated Code Begins ##############
         if (strlen(user_input) > 0) {
-            bool valid = parse_input(user_input);
-            if (!valid) {
+            pending_cmd_t cmd;
+            parse_status_t status = read_command(&cmd, user_input,
+                                                 shell_is_interactive && !replaying());
+            if (status == PARSE_ERROR) {
                 printf("Invalid Syntax!\n");
             } else {
-                if (strncmp(user_input, "log", 3) != 0 || 
-                    (user_input[3] != '\0' && !isspace(user_input[3]))) {
-                    add_log_entry(user_input);
+                char* flat = flatten_for_log(cmd.raw.data);
+                if (flat != NULL && (strncmp(flat, "log", 3) != 0 ||
+                    (flat[3] != '\0' && !isspace(flat[3])))) {
+                    start = probe_start();
+                    add_log_entry(flat);
+                    probe_end(PROBE_LOG, start);
                 }
-                
-                char* input_copy = strdup(user_input);
-                char* argv[MAX_INPUT_SIZE / 2];
-                int argc = 0;
-                
-                split_command(input_copy, argv, &argc);
-                
-                if (argc > 0 && is_intrinsic(argv[0])) {
-                    execute_intrinsic(argv[0], argc, argv);
-                } else if (argc > 0) {
-                    execute_command(user_input);
-                }
-                
-                free(input_copy);
+                free(flat);
+
+                // Incomplete input at end of file is reported by the executor
+                start = probe_start();
+                record_begin();
+                execute_command(cmd.text.data);
+                record_end(cmd.typed.data, get_last_status());
+                probe_end(PROBE_EXECUTE, start);
+            }
+            free_pending(&cmd);
+            if (vm_exit_requested) {
+                free(user_input);
+                cleanup_jobs();
+                free(home_directory);
+                exit(get_last_status());
             }
         }
+        // ############## LLM Generated Code Ends ################
         
         free(user_input);
     }
@@ -0,0 +1,439 @@
+#define _GNU_SOURCE
+#include "monitor.h"
+#include "jobs.h"
+#include "input.h"
+#include "vm.h"
+#include "utils.h"
+#include "timers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <dirent.h>
+// ############## LLM Generated Code Begins ##############
+#define WATCH_LINE 256
+#define MAX_TREE_DEPTH 16
+
+// The /proc files of one process, opened when it is first seen
+typedef struct {
+    pid_t pid;
+    int stat_fd;
+    int io_fd;
+    int children_fd;   // Its main thread's children, to find pipeline stages
+    bool seen;         // Found again in the current sample
+} probe_t;
+
+// Totals of one job at the last sample and the rates derived from them
+typedef struct {
+    int job_id;        // Job the slot held at the last sample, or 0
+    unsigned long long ticks;
+    unsigned long long rchar;
+    unsigned long long wchar;
+    long rss_kb;
+    long vm_kb;        // Largest address space of one of its processes
+    int open_files;    // Most files open in one of its processes, if counted
+    double cpu_pct;
+    double read_rate;
+    double write_rate;
+} job_sample_t;
+
+static probe_t* probes = NULL;
+static int probe_count = 0;
+static int probe_cap = 0;
+
+static void close_probe(probe_t* probe) {
+    close(probe->stat_fd);
+    if (probe->io_fd != -1) close(probe->io_fd);
+    if (probe->children_fd != -1) close(probe->children_fd);
+}
+
+static probe_t* get_probe(pid_t pid) {
+    for (int i = 0; i < probe_count; i++) {
+        if (probes[i].pid == pid) {
+            return &probes[i];
+        }
+    }
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    int stat_fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (stat_fd == -1) {
+        return NULL;
+    }
+    if (probe_count == probe_cap) {
+        int cap = probe_cap ? probe_cap * 2 : 64;
+        probe_t* grown = realloc(probes, cap * sizeof(probe_t));
+        if (grown == NULL) {
+            perror("realloc failed");
+            close(stat_fd);
+            return NULL;
+        }
+        probes = grown;
+        probe_cap = cap;
+    }
+
+    probe_t* probe = &probes[probe_count++];
+    probe->pid = pid;
+    probe->stat_fd = stat_fd;
+    // io needs ptrace access and children a kernel option; both may fail
+    snprintf(path, sizeof(path), "/proc/%d/io", (int)pid);
+    probe->io_fd = open(path, O_RDONLY | O_CLOEXEC);
+    snprintf(path, sizeof(path), "/proc/%d/task/%d/children", (int)pid, (int)pid);
+    probe->children_fd = open(path, O_RDONLY | O_CLOEXEC);
+    probe->seen = false;
+    return probe;
+}
+
+// Read a whole /proc file from the start; returns false once it is gone
+static bool read_proc(int fd, char* buf, size_t size) {
+    ssize_t n = pread(fd, buf, size - 1, 0);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+    return true;
+}
+
+static unsigned long long io_field(const char* text, const char* key) {
+    const char* p = strstr(text, key);
+    return p ? strtoull(p + strlen(key), NULL, 10) : 0;
+}
+
+static int count_open_files(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return 0;
+    }
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// Add a process and its descendants to a job's totals; open files are
+// only counted when files is set, since that means listing a directory
+static void sample_process(pid_t pid, job_sample_t* total, int depth, bool files) {
+    probe_t* probe = get_probe(pid);
+    if (probe == NULL) {
+        return;
+    }
+
+    char buf[1024];
+    if (!read_proc(probe->stat_fd, buf, sizeof(buf))) {
+        return;
+    }
+    char* fields = strrchr(buf, ')');
+    unsigned long utime, stime, vsize;
+    long cutime, cstime, rss;
+    if (fields == NULL ||
+        sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %ld %ld "
+               "%*d %*d %*d %*d %*u %lu %ld", &utime, &stime, &cutime, &cstime, &vsize,
+               &rss) != 6) {
+        return;
+    }
+    probe->seen = true;
+    total->ticks += utime + stime + cutime + cstime;
+    total->rss_kb += rss * (sysconf(_SC_PAGESIZE) / 1024);
+    // Address space and open files are limited per process
+    if ((long)(vsize / 1024) > total->vm_kb) {
+        total->vm_kb = vsize / 1024;
+    }
+    if (files) {
+        int open_files = count_open_files(pid);
+        if (open_files > total->open_files) total->open_files = open_files;
+    }
+
+    if (probe->io_fd != -1 && read_proc(probe->io_fd, buf, sizeof(buf))) {
+        total->rchar += io_field(buf, "rchar: ");
+        total->wchar += io_field(buf, "wchar: ");
+    }
+
+    if (depth < MAX_TREE_DEPTH && probe->children_fd != -1 &&
+        read_proc(probe->children_fd, buf, sizeof(buf))) {
+        char* p = buf;
+        char* end;
+        for (long child = strtol(p, &end, 10); end != p; child = strtol(p, &end, 10)) {
+            p = end;
+            sample_process((pid_t)child, total, depth + 1, files);
+        }
+    }
+}
+
+// Close the probes of processes that were not found again: they exited
+static void drop_unseen_probes() {
+    int kept = 0;
+    for (int i = 0; i < probe_count; i++) {
+        if (probes[i].seen) {
+            probes[i].seen = false;
+            probes[kept++] = probes[i];
+        } else {
+            close_probe(&probes[i]);
+        }
+    }
+    probe_count = kept;
+}
+
+void sample_jobs_usage() {
+    long ticks_per_sec = sysconf(_SC_CLK_TCK);
+    for (int i = 0; i < MAX_JOBS; i++) {
+        job_t* job = &jobs[i];
+        job_sample_t total;
+        memset(&total, 0, sizeof(total));
+        if (job->job_id > 0 && !job->completed && job->state != JOB_QUEUED) {
+            sample_process(job->pid, &total, 0, job->limits.open_files != RLIM_INFINITY);
+        }
+        // Children that already exited count through cutime and cstime
+        job->cpu_time = (double)total.ticks / ticks_per_sec;
+        job->rss_kb = total.rss_kb;
+        job->vm_kb = total.vm_kb;
+        job->open_files = total.open_files;
+    }
+    drop_unseen_probes();
+}
+
+// Sample every job and turn the change since the last sample into rates
+static void sample_jobs(job_t** list, int count, job_sample_t* samples, double elapsed) {
+    long ticks_per_sec = sysconf(_SC_CLK_TCK);
+    for (int i = 0; i < count; i++) {
+        job_t* job = list[i];
+        if (job->state == JOB_QUEUED) {
+            continue;
+        }
+        job_sample_t* sample = &samples[job - jobs];
+        job_sample_t now;
+        memset(&now, 0, sizeof(now));
+        now.job_id = job->job_id;
+        sample_process(job->pid, &now, 0, false);
+
+        // Totals drop when a stage exits, so rates never go negative
+        if (sample->job_id == job->job_id && elapsed > 0) {
+            now.cpu_pct = now.ticks > sample->ticks
+                ? (now.ticks - sample->ticks) * 100.0 / ticks_per_sec / elapsed : 0;
+            now.read_rate = now.rchar > sample->rchar ? (now.rchar - sample->rchar) / elapsed : 0;
+            now.write_rate = now.wchar > sample->wchar ? (now.wchar - sample->wchar) / elapsed : 0;
+        }
+        *sample = now;
+    }
+    drop_unseen_probes();
+}
+
+
+static const char* state_name(const job_t* job) {
+    switch (job->state) {
+    case JOB_RUNNING: return "Running";
+    case JOB_STOPPED: return "Stopped";
+    default: return "Queued";
+    }
+}
+
+// Build the lines of one frame and return how many there are
+static int build_frame(char (*lines)[WATCH_LINE], int max_lines, int width, int interval_ms,
+                       job_t** list, int count, const job_sample_t* samples) {
+    if (width > WATCH_LINE) width = WATCH_LINE;
+    int n = 0;
+    snprintf(lines[n++], width, "activities: %d jobs, every %d ms (q to quit)", count, interval_ms);
+    if (n < max_lines) {
+        snprintf(lines[n++], width, "%-5s %-8s %-8s %6s %8s %8s %8s  %s",
+                 "JOB", "PID", "STATE", "CPU%", "RSS", "READ/s", "WRITE/s", "COMMAND");
+    }
+    for (int i = 0; i < count && n < max_lines; i++) {
+        const job_t* job = list[i];
+        if (job->state == JOB_QUEUED) {
+            snprintf(lines[n++], width, "%-5d %-8s %-8s %6s %8s %8s %8s  %s",
+                     job->job_id, "-", state_name(job), "-", "-", "-", "-", job->command);
+            continue;
+        }
+        const job_sample_t* sample = &samples[job - jobs];
+        char rss[16], rd[16], wr[16];
+        format_size(sample->rss_kb * 1024.0, rss, sizeof(rss));
+        format_size(sample->read_rate, rd, sizeof(rd));
+        format_size(sample->write_rate, wr, sizeof(wr));
+        snprintf(lines[n++], width, "%-5d %-8d %-8s %6.1f %8s %8s %8s  %s",
+                 job->job_id, (int)job->pid, state_name(job), sample->cpu_pct, rss, rd, wr,
+                 job->command);
+    }
+    return n;
+}
+
+static bool append(char** out, size_t* len, size_t* cap, const char* text) {
+    size_t add = strlen(text);
+    if (*len + add + 1 > *cap) {
+        size_t grown_cap = (*len + add + 1) * 2;
+        char* grown = realloc(*out, grown_cap);
+        if (grown == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        *out = grown;
+        *cap = grown_cap;
+    }
+    memcpy(*out + *len, text, add + 1);
+    *len += add;
+    return true;
+}
+
+// Write one frame. On a terminal only the rows that changed since the
+// last frame are rewritten, in a single write.
+static void draw_frame(char (*lines)[WATCH_LINE], int count, char (*shown)[WATCH_LINE],
+                       int* shown_count, bool tty) {
+    char* out = NULL;
+    size_t len = 0, cap = 0;
+    bool ok = true;
+    for (int i = 0; ok && i < count; i++) {
+        if (tty && i < *shown_count && strcmp(lines[i], shown[i]) == 0) {
+            continue;
+        }
+        char move[32];
+        snprintf(move, sizeof(move), "\033[%d;1H", i + 1);
+        ok = (!tty || append(&out, &len, &cap, move)) && append(&out, &len, &cap, lines[i]) &&
+             append(&out, &len, &cap, tty ? "\033[K" : "\n");
+        memcpy(shown[i], lines[i], WATCH_LINE);
+    }
+    if (ok && tty && count < *shown_count) {
+        char clear[32];
+        snprintf(clear, sizeof(clear), "\033[%d;1H\033[J", count + 1);
+        ok = append(&out, &len, &cap, clear);
+    }
+    if (ok && !tty) {
+        ok = append(&out, &len, &cap, "\n");
+    }
+    *shown_count = count;
+
+    fflush(stdout);
+    for (size_t done = 0; ok && done < len;) {
+        ssize_t n = write(STDOUT_FILENO, out + done, len - done);
+        if (n == -1 && errno != EINTR) break;
+        if (n > 0) done += n;
+    }
+    free(out);
+}
+
+// Wait out the interval, running due timers and spool watches meanwhile;
+// returns false when q was pressed or on Ctrl+C
+static bool wait_interval(int interval_ms, bool keys) {
+    double deadline = monotonic_seconds() + interval_ms / 1000.0;
+    while (!vm_interrupted && monotonic_seconds() < deadline) {
+        if (!wait_readable_until(keys ? STDIN_FILENO : -1, deadline)) {
+            continue;
+        }
+        char c;
+        if (read(STDIN_FILENO, &c, 1) == 1 && (c == 'q' || c == 'Q')) {
+            return false;
+        }
+    }
+    return !vm_interrupted;
+}
+
+bool watch_command(int argc, char** argv) {
+    int interval_ms = 1000;
+    long count_limit = -1;
+    bool usage = strcmp(argv[1], "-w") != 0;
+    for (int i = 2; !usage && i < argc; i++) {
+        char* end;
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count_limit = strtol(argv[++i], &end, 10);
+            usage = *end != '\0' || count_limit < 1;
+        } else {
+            long value = strtol(argv[i], &end, 10);
+            usage = *end != '\0' || value < 10;
+            interval_ms = (int)value;
+        }
+    }
+    if (usage) {
+        fprintf(stderr, "Usage: activities [-w [INTERVAL_MS] [-n COUNT]]\n");
+        return false;
+    }
+
+    bool tty = isatty(STDOUT_FILENO);
+    bool keys = isatty(STDIN_FILENO) && !input_is_batch();
+    int rows = MAX_JOBS + 2;
+    int width = WATCH_LINE;
+    struct winsize ws;
+    if (tty && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        rows = ws.ws_row;
+        width = ws.ws_col + 1;
+    }
+
+    job_sample_t* samples = calloc(MAX_JOBS, sizeof(job_sample_t));
+    char (*lines)[WATCH_LINE] = malloc((size_t)rows * WATCH_LINE);
+    char (*shown)[WATCH_LINE] = malloc((size_t)rows * WATCH_LINE);
+    job_t** list = malloc(MAX_JOBS * sizeof(job_t*));
+    if (samples == NULL || lines == NULL || shown == NULL || list == NULL) {
+        perror("malloc failed");
+        free(samples);
+        free(lines);
+        free(shown);
+        free(list);
+        return false;
+    }
+
+    // Keys are read one at a time without echo; Ctrl+C still works
+    struct termios saved;
+    if (keys) {
+        struct termios raw;
+        tcgetattr(STDIN_FILENO, &saved);
+        raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+    if (tty) {
+        // Alternate screen, cursor hidden
+        printf("\033[?1049h\033[?25l\033[H\033[2J");
+    }
+
+    vm_interrupted = 0;
+    int shown_count = 0;
+    double last = monotonic_seconds();
+    for (long frame = 0; count_limit < 0 || frame < count_limit; frame++) {
+        // Queued jobs still start while watching; their output needs a
+        // full redraw afterwards
+        if (jobs_reaped) {
+            dispatch_jobs();
+            if (tty) printf("\033[2J");
+            shown_count = 0;
+        }
+
+        int count = list_jobs(list);
+        double now = monotonic_seconds();
+        sample_jobs(list, count, samples, frame == 0 ? 0 : now - last);
+        last = now;
+        int n = build_frame(lines, rows, width, interval_ms, list, count, samples);
+        draw_frame(lines, n, shown, &shown_count, tty);
+
+        // A watch nobody can stop ends with the last job
+        if ((count == 0 && !keys && count_limit < 0) ||
+            (frame + 1 != count_limit && !wait_interval(interval_ms, keys))) {
+            break;
+        }
+    }
+
+    if (tty) {
+        printf("\033[?25h\033[?1049l");
+        fflush(stdout);
+    }
+    if (keys) {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    }
+    for (int i = 0; i < probe_count; i++) {
+        close_probe(&probes[i]);
+    }
+    probe_count = 0;
+    free(samples);
+    free(lines);
+    free(shown);
+    free(list);
+    return true;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
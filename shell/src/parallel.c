@@ -0,0 +1,450 @@
+#define _GNU_SOURCE
+#include "parallel.h"
+#include "expand.h"
+#include "executor.h"
+#include "intrinsics.h"
+#include "variables.h"
+#include "vm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+// ############## LLM Generated Code Begins ##############
+#define READ_CHUNK 65536
+
+// Space kept free of ARG_MAX for the environment's growth and the
+// kernel's own bookkeeping
+#define ARG_MAX_MARGIN 4096
+
+typedef struct {
+    char** template;          // Command words, possibly holding {}
+    int template_count;
+    bool has_placeholder;
+    char** inputs;
+    size_t input_count;
+    size_t next_input;
+    size_t batch_limit;       // Inputs per job; 1 unless -X
+    long arg_budget;          // Bytes of argv + envp a job may use
+} parallel_t;
+
+// One running job: its process and the output collected so far
+typedef struct {
+    pid_t pid;                // 0 once reaped
+    int out_fd;               // -1 once the output reached EOF
+    int status;
+    capture_buf_t output;
+    bool active;
+} slot_t;
+
+// Read from fd into the tail of buf; returns the byte count, 0 at EOF
+static ssize_t read_some(int fd, capture_buf_t* buf) {
+    if (!capture_reserve(buf, READ_CHUNK)) {
+        return -1;
+    }
+    ssize_t n;
+    do {
+        n = read(fd, buf->data + buf->len, buf->cap - buf->len - 1);
+    } while (n == -1 && errno == EINTR);
+    if (n > 0) {
+        buf->len += n;
+    }
+    return n;
+}
+
+// Read all of fd and cut it into lines in place; empty lines are skipped
+static char** read_inputs(int fd, capture_buf_t* text, size_t* count) {
+    ssize_t n;
+    while ((n = read_some(fd, text)) > 0) {
+    }
+    if (n == -1) {
+        perror("parallel: read failed");
+        return NULL;
+    }
+
+    char** lines = malloc((text->len / 2 + 2) * sizeof(char*));
+    if (lines == NULL) {
+        perror("malloc failed");
+        return NULL;
+    }
+    *count = 0;
+    size_t start = 0;
+    for (size_t i = 0; i <= text->len; i++) {
+        if (i == text->len || text->data[i] == '\n') {
+            if (i > start) {
+                text->data[i] = '\0';
+                lines[(*count)++] = text->data + start;
+            }
+            start = i + 1;
+        }
+    }
+    return lines;
+}
+
+// Size an argument takes in the new process's argument area
+static long arg_cost(const char* arg) {
+    return (long)strlen(arg) + 1 + (long)sizeof(char*);
+}
+
+// Size a template word takes once each {} in it is replaced by input
+static long word_cost(const char* word, const char* input) {
+    long cost = arg_cost(word);
+    long grow = (long)strlen(input) - 2;
+    for (const char* mark = strstr(word, "{}"); mark != NULL; mark = strstr(mark + 2, "{}")) {
+        cost += grow;
+    }
+    return cost;
+}
+
+// Append word with each {} replaced by input, as one NUL-terminated argument
+static bool append_word(capture_buf_t* storage, const char* word, const char* input) {
+    bool ok = true;
+    const char* mark;
+    while (ok && (mark = strstr(word, "{}")) != NULL) {
+        ok = capture_append(storage, word, mark - word) &&
+             capture_append(storage, input, strlen(input));
+        word = mark + 2;
+    }
+    return ok && capture_append(storage, word, strlen(word) + 1);
+}
+
+// Build the argv of the job for inputs [first, first + count)
+static char** build_argv(parallel_t* p, size_t first, size_t count, capture_buf_t* storage) {
+    // Under -X every word with {} may be repeated once per input
+    size_t cap = (p->template_count + 1) * (count + 1);
+    char** argv = malloc(cap * sizeof(char*));
+    size_t* offsets = malloc(cap * sizeof(size_t));
+    if (argv == NULL || offsets == NULL) {
+        perror("malloc failed");
+        free(argv);
+        free(offsets);
+        return NULL;
+    }
+
+    // Words are assembled in storage first and become pointers at the end,
+    // since storage may move while it grows
+    int argc = 0;
+    bool ok = true;
+    for (int w = 0; ok && w < p->template_count; w++) {
+        const char* word = p->template[w];
+        if (p->batch_limit > 1 && strstr(word, "{}") != NULL) {
+            // Under -X a word with {} is repeated for every input of the
+            // batch, so x{} becomes xa xb xc
+            for (size_t i = 0; ok && i < count; i++) {
+                offsets[argc++] = storage->len;
+                ok = append_word(storage, word, p->inputs[first + i]);
+            }
+            continue;
+        }
+
+        offsets[argc++] = storage->len;
+        ok = append_word(storage, word, count > 0 ? p->inputs[first] : "");
+    }
+
+    // Without {} the inputs go at the end
+    for (size_t i = 0; ok && !p->has_placeholder && i < count; i++) {
+        offsets[argc++] = storage->len;
+        ok = capture_append(storage, p->inputs[first + i], strlen(p->inputs[first + i]) + 1);
+    }
+
+    if (!ok) {
+        free(argv);
+        free(offsets);
+        return NULL;
+    }
+    for (int i = 0; i < argc; i++) {
+        argv[i] = storage->data + offsets[i];
+    }
+    argv[argc] = NULL;
+    free(offsets);
+    return argv;
+}
+
+// How many of the remaining inputs the next job takes
+static size_t next_batch(parallel_t* p) {
+    size_t remaining = p->input_count - p->next_input;
+    size_t count = remaining < p->batch_limit ? remaining : p->batch_limit;
+    if (count <= 1) {
+        return count;
+    }
+
+    long used = 0;
+    for (int w = 0; w < p->template_count; w++) {
+        if (strstr(p->template[w], "{}") == NULL) {
+            used += arg_cost(p->template[w]);
+        }
+    }
+    size_t n = 0;
+    while (n < count) {
+        // Each input adds itself, or a copy of every word with {}
+        const char* input = p->inputs[p->next_input + n];
+        if (!p->has_placeholder) {
+            used += arg_cost(input);
+        }
+        for (int w = 0; p->has_placeholder && w < p->template_count; w++) {
+            if (strstr(p->template[w], "{}") != NULL) {
+                used += word_cost(p->template[w], input);
+            }
+        }
+        if (used > p->arg_budget && n > 0) break;
+        n++;
+    }
+    return n;
+}
+
+// Fork one job with stdout and stderr going to a pipe
+static bool launch(parallel_t* p, slot_t* slot, sigset_t* old_mask) {
+    size_t count = next_batch(p);
+    capture_buf_t storage = {NULL, 0, 0};
+    char** argv = build_argv(p, p->next_input, count, &storage);
+    if (argv == NULL) {
+        free(storage.data);
+        return false;
+    }
+    p->next_input += count;
+
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) == -1) {
+        perror("pipe failed");
+        free(argv);
+        free(storage.data);
+        return false;
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork failed");
+        close(fds[0]);
+        close(fds[1]);
+        free(argv);
+        free(storage.data);
+        return false;
+    } else if (pid == 0) {
+        signal(SIGCHLD, SIG_DFL);
+        sigprocmask(SIG_SETMASK, old_mask, NULL);
+        dup2(fds[1], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        int dev_null = open("/dev/null", O_RDONLY);
+        if (dev_null != -1) {
+            dup2(dev_null, STDIN_FILENO);
+            close(dev_null);
+        }
+
+        int argc = 0;
+        while (argv[argc] != NULL) argc++;
+        int status;
+        if (vm_call_function(argc, argv, &status)) {
+            child_exit(status);
+        }
+        if (is_intrinsic(argv[0])) {
+            child_exit(run_intrinsic_status(argv[0], argc, argv));
+        }
+        exec_with_env(argv);
+        perror("command not found");
+        child_exit(127);
+    }
+
+    close(fds[1]);
+    free(argv);
+    free(storage.data);
+    slot->pid = pid;
+    slot->out_fd = fds[0];
+    slot->status = 0;
+    slot->output.len = 0;
+    slot->active = true;
+    return true;
+}
+
+// Print a finished job's output in one piece and free its slot
+static void finish_job(slot_t* slot) {
+    fflush(stdout);
+    size_t done = 0;
+    while (done < slot->output.len) {
+        ssize_t n = write(STDOUT_FILENO, slot->output.data + done, slot->output.len - done);
+        if (n == -1 && errno == EINTR) continue;
+        if (n == -1) break;
+        done += n;
+    }
+    slot->active = false;
+}
+
+// Run every job, keeping at most jobs of them alive; returns the number
+// of jobs that failed
+static int run_jobs(parallel_t* p, int jobs) {
+    sigset_t block, old_mask;
+    sigemptyset(&block);
+    sigaddset(&block, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &block, &old_mask);
+
+    // Child exits arrive as readable events next to the output pipes
+    int sig_fd = signalfd(-1, &block, SFD_CLOEXEC | SFD_NONBLOCK);
+    slot_t* slots = calloc(jobs, sizeof(slot_t));
+    struct pollfd* pfds = malloc((jobs + 1) * sizeof(struct pollfd));
+    if (sig_fd == -1 || slots == NULL || pfds == NULL) {
+        perror("parallel");
+        if (sig_fd != -1) close(sig_fd);
+        free(slots);
+        free(pfds);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        return 1;
+    }
+
+    int failed = 0;
+    int running = 0;
+    bool launch_failed = false;
+    while (1) {
+        for (int i = 0; i < jobs && !launch_failed && !vm_interrupted &&
+                        p->next_input < p->input_count; i++) {
+            if (!slots[i].active) {
+                if (launch(p, &slots[i], &old_mask)) {
+                    running++;
+                } else {
+                    launch_failed = true;
+                    failed++;
+                }
+            }
+        }
+        if (running == 0) {
+            break;
+        }
+
+        pfds[0].fd = sig_fd;
+        pfds[0].events = POLLIN;
+        for (int i = 0; i < jobs; i++) {
+            pfds[i + 1].fd = slots[i].active ? slots[i].out_fd : -1;
+            pfds[i + 1].events = POLLIN;
+        }
+        if (poll(pfds, jobs + 1, -1) == -1) {
+            if (errno == EINTR) continue;
+            perror("poll failed");
+            break;
+        }
+
+        for (int i = 0; i < jobs; i++) {
+            slot_t* s = &slots[i];
+            if (!s->active || s->out_fd == -1 || !(pfds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t n = read_some(s->out_fd, &s->output);
+            if (n <= 0) {
+                close(s->out_fd);
+                s->out_fd = -1;
+            }
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(sig_fd, &info, sizeof(info)) == sizeof(info)) {
+            }
+            for (int i = 0; i < jobs; i++) {
+                if (slots[i].active && slots[i].pid > 0 &&
+                    waitpid(slots[i].pid, &slots[i].status, WNOHANG) == slots[i].pid) {
+                    slots[i].pid = 0;
+                }
+            }
+        }
+
+        // A job is done once it exited and its output reached EOF
+        for (int i = 0; i < jobs; i++) {
+            slot_t* s = &slots[i];
+            if (s->active && s->pid == 0 && s->out_fd == -1) {
+                if (!WIFEXITED(s->status) || WEXITSTATUS(s->status) != 0) failed++;
+                finish_job(s);
+                running--;
+            }
+        }
+    }
+
+    for (int i = 0; i < jobs; i++) {
+        free(slots[i].output.data);
+    }
+    free(slots);
+    free(pfds);
+    close(sig_fd);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+    // The signalfd consumed SIGCHLDs meant for background jobs too; let
+    // the shell's handler reap whatever else exited meanwhile
+    raise(SIGCHLD);
+    return failed;
+}
+
+bool parallel_command(int argc, char** argv) {
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    bool batch = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strncmp(argv[i], "-j", 2) == 0 && (argv[i][2] != '\0' || i + 1 < argc)) {
+            // Both -j N and -jN
+            const char* count = argv[i][2] != '\0' ? argv[i] + 2 : argv[++i];
+            char* end;
+            jobs = strtol(count, &end, 10);
+            if (*end != '\0' || jobs <= 0) {
+                fprintf(stderr, "parallel: invalid job count: %s\n", count);
+                return false;
+            }
+        } else if (strcmp(argv[i], "-X") == 0) {
+            batch = true;
+        } else {
+            fprintf(stderr, "Usage: parallel [-j N] [-X] command [args] [::: inputs...]\n");
+            return false;
+        }
+    }
+
+    int separator = i;
+    while (separator < argc && strcmp(argv[separator], ":::") != 0) separator++;
+    if (separator == i) {
+        fprintf(stderr, "parallel: missing command\n");
+        return false;
+    }
+
+    parallel_t p;
+    memset(&p, 0, sizeof(p));
+    p.template = argv + i;
+    p.template_count = separator - i;
+    for (int w = 0; w < p.template_count; w++) {
+        p.has_placeholder = p.has_placeholder || strstr(p.template[w], "{}") != NULL;
+    }
+
+    capture_buf_t text = {NULL, 0, 0};
+    char** stdin_inputs = NULL;
+    if (separator < argc) {
+        p.inputs = argv + separator + 1;
+        p.input_count = argc - separator - 1;
+    } else {
+        stdin_inputs = read_inputs(STDIN_FILENO, &text, &p.input_count);
+        if (stdin_inputs == NULL) {
+            free(text.data);
+            return false;
+        }
+        p.inputs = stdin_inputs;
+    }
+
+    // -X packs as many inputs per job as ARG_MAX allows, but never so many
+    // that some of the N slots would sit idle
+    p.batch_limit = 1;
+    if (batch) {
+        p.batch_limit = (p.input_count + jobs - 1) / jobs;
+        long env_size = 0;
+        for (char** e = get_envp(); *e != NULL; e++) {
+            env_size += arg_cost(*e);
+        }
+        p.arg_budget = sysconf(_SC_ARG_MAX) - env_size - ARG_MAX_MARGIN;
+    }
+
+    if ((long)p.input_count < jobs) {
+        jobs = p.input_count > 0 ? (long)p.input_count : 1;
+    }
+    int failed = p.input_count > 0 ? run_jobs(&p, (int)jobs) : 0;
+
+    free(stdin_inputs);
+    free(text.data);
+    return failed == 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "parse_cache.h"
+#include "parser.h"
+#include "probes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+// ############## LLM Generated Code Begins ##############
+#define PARSE_CACHE_ENTRIES 128
+#define PARSE_CACHE_BUCKETS 256
+
+typedef struct cache_entry {
+    uint64_t hash;
+    char* line;
+    size_t len;
+    bool lexed;                  // False if the line failed to lex
+    signed char status;          // parse_status_t, -1 until known
+    token_t* tokens;
+    int count;
+    program_t* prog;             // Compiled form of a valid line
+    struct cache_entry* chain;   // Next entry in the same bucket
+    struct cache_entry* prev;    // LRU list, most recent first
+    struct cache_entry* next;
+} cache_entry_t;
+
+static cache_entry_t* buckets[PARSE_CACHE_BUCKETS];
+static cache_entry_t* lru_head = NULL;
+static cache_entry_t* lru_tail = NULL;
+static size_t entry_count = 0;
+static parse_cache_stats_t stats;
+
+// Hash eight bytes at a time; lines are mostly short, so this only needs
+// to be cheap next to lexing, not cryptographically strong
+static uint64_t hash_line(const char* line, size_t len) {
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ len;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t chunk;
+        memcpy(&chunk, line + i, 8);
+        hash = (hash ^ chunk) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 32;
+    }
+    for (; i < len; i++) {
+        hash = (hash ^ (unsigned char)line[i]) * 0x100000001B3ull;
+    }
+    return hash ^ (hash >> 29);
+}
+
+static void lru_unlink(cache_entry_t* e) {
+    if (e->prev) e->prev->next = e->next;
+    else lru_head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else lru_tail = e->prev;
+}
+
+static void lru_push_front(cache_entry_t* e) {
+    e->prev = NULL;
+    e->next = lru_head;
+    if (lru_head) lru_head->prev = e;
+    lru_head = e;
+    if (lru_tail == NULL) lru_tail = e;
+}
+
+static void evict_oldest() {
+    cache_entry_t* e = lru_tail;
+    lru_unlink(e);
+
+    cache_entry_t** link = &buckets[e->hash % PARSE_CACHE_BUCKETS];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+
+    free(e->line);
+    free(e->tokens);
+    release_program(e->prog);
+    free(e);
+    entry_count--;
+    stats.evictions++;
+}
+
+static cache_entry_t* find_entry(const char* line, size_t len, uint64_t hash) {
+    for (cache_entry_t* e = buckets[hash % PARSE_CACHE_BUCKETS]; e; e = e->chain) {
+        if (e->hash == hash && e->len == len && memcmp(e->line, line, len) == 0) {
+            if (e != lru_head) {
+                lru_unlink(e);
+                lru_push_front(e);
+            }
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Lex a line and remember its tokens; returns NULL if it cannot be cached
+static cache_entry_t* insert_entry(const char* line, size_t len, uint64_t hash) {
+    cache_entry_t* e = calloc(1, sizeof(cache_entry_t));
+    if (e == NULL) {
+        return NULL;
+    }
+
+    token_list_t tokens = {NULL, 0, 0};
+    e->lexed = lex_line(line, len, &tokens);
+    e->line = malloc(len + 1);
+    e->tokens = e->lexed ? malloc((tokens.count + 1) * sizeof(token_t)) : NULL;
+    if (e->line == NULL || (e->lexed && e->tokens == NULL)) {
+        free_tokens(&tokens);
+        free(e->line);
+        free(e->tokens);
+        free(e);
+        return NULL;
+    }
+
+    memcpy(e->line, line, len);
+    e->line[len] = '\0';
+    if (e->lexed && tokens.count > 0) {
+        memcpy(e->tokens, tokens.tokens, tokens.count * sizeof(token_t));
+        e->count = tokens.count;
+    }
+    free_tokens(&tokens);
+    e->hash = hash;
+    e->len = len;
+    e->status = -1;
+
+    if (entry_count == PARSE_CACHE_ENTRIES) {
+        evict_oldest();
+    }
+    e->chain = buckets[hash % PARSE_CACHE_BUCKETS];
+    buckets[hash % PARSE_CACHE_BUCKETS] = e;
+    lru_push_front(e);
+    entry_count++;
+    return e;
+}
+
+// Find or create the entry of a line; *found tells which happened
+static cache_entry_t* lookup(const char* line, size_t len, bool* found) {
+    *found = false;
+    if (len > PARSE_CACHE_MAX_LINE) {
+        return NULL;
+    }
+
+    uint64_t hash = hash_line(line, len);
+    cache_entry_t* e = find_entry(line, len, hash);
+    if (e != NULL) {
+        *found = true;
+        return e;
+    }
+    return insert_entry(line, len, hash);
+}
+
+static bool lex_through_cache(const char* line, size_t len, token_list_t* out) {
+    bool found;
+    cache_entry_t* e = lookup(line, len, &found);
+    if (found) stats.lex_hits++;
+    else stats.lex_misses++;
+
+    if (e == NULL) {
+        return lex_line(line, len, out);
+    }
+
+    out->count = 0;
+    if (!e->lexed) {
+        return false;
+    }
+    if (out->cap < e->count) {
+        token_t* tokens = realloc(out->tokens, e->count * sizeof(token_t));
+        if (tokens == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        out->tokens = tokens;
+        out->cap = e->count;
+    }
+    if (e->count > 0) {
+        memcpy(out->tokens, e->tokens, e->count * sizeof(token_t));
+    }
+    out->count = e->count;
+    return true;
+}
+
+int cached_parse_result(const char* line, size_t len, program_t** prog) {
+    cache_entry_t* e = NULL;
+    if (len <= PARSE_CACHE_MAX_LINE) {
+        e = find_entry(line, len, hash_line(line, len));
+    }
+
+    // An entry may exist only because the line was lexed
+    if (e != NULL && e->status >= 0 && (e->status != PARSE_OK || e->prog != NULL)) {
+        stats.parse_hits++;
+        if (e->prog != NULL) {
+            e->prog->refs++;
+        }
+        *prog = e->prog;
+        return e->status;
+    }
+    stats.parse_misses++;
+    *prog = NULL;
+    return -1;
+}
+
+bool lex_cached(const char* line, size_t len, token_list_t* out) {
+    uint64_t start = probe_start();
+    bool ok = lex_through_cache(line, len, out);
+    probe_end(PROBE_LEX, start);
+    return ok;
+}
+
+void cache_parse_result(const char* line, size_t len, int status, program_t* prog) {
+    if (len > PARSE_CACHE_MAX_LINE) {
+        return;
+    }
+    cache_entry_t* e = find_entry(line, len, hash_line(line, len));
+    if (e != NULL) {
+        e->status = (signed char)status;
+        if (prog != NULL) {
+            prog->refs++;
+        }
+        release_program(e->prog);
+        e->prog = prog;
+    }
+}
+
+void get_parse_cache_stats(parse_cache_stats_t* out) {
+    *out = stats;
+    out->entries = entry_count;
+}
+
+static double hit_rate(uint64_t hits, uint64_t misses) {
+    return hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0;
+}
+
+// stats [on|off|reset]: report how often cached parse results were
+// reused and where the shell spent its time
+bool stats_command(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "on") == 0) {
+        set_probes_enabled(true);
+        return true;
+    } else if (argc == 2 && strcmp(argv[1], "off") == 0) {
+        set_probes_enabled(false);
+        return true;
+    } else if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        reset_probes();
+        return true;
+    } else if (argc > 1) {
+        fprintf(stderr, "Usage: stats [on|off|reset]\n");
+        return false;
+    }
+
+    parse_cache_stats_t s;
+    get_parse_cache_stats(&s);
+
+    printf("parse cache: %zu/%d entries, %llu evictions\n", s.entries,
+           PARSE_CACHE_ENTRIES, (unsigned long long)s.evictions);
+    printf("  lex:   %llu hits, %llu misses, %.1f%% hit rate\n",
+           (unsigned long long)s.lex_hits, (unsigned long long)s.lex_misses,
+           hit_rate(s.lex_hits, s.lex_misses));
+    printf("  parse: %llu hits, %llu misses, %.1f%% hit rate\n",
+           (unsigned long long)s.parse_hits, (unsigned long long)s.parse_misses,
+           hit_rate(s.parse_hits, s.parse_misses));
+    print_probe_stats();
+    return true;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
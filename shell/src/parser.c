@@ -1,4 +1,6 @@
 #include "parser.h"
+#include "parse_cache.h"
+#include "probes.h"
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -7,156 +9,713 @@
 
 // ############## LLM Generated Code Begins ##############
 
-bool parse_shell_cmd(const char** input);
-bool parse_cmd_group(const char** input);
-bool parse_atomic(const char** input);
-bool parse_input_redirect(const char** input);
-bool parse_output_redirect(const char** input);
-bool parse_name(const char** input);
-void skip_whitespace(const char** input);
+// The grammar is checked over the lexer's tokens, so quoting rules live in
+// one place and a quoted "|" or "<" is just part of a word. When a program
+// is attached the parser also compiles what it accepts to bytecode:
+//
+//   script   -> list
+//   list     -> (and_or ((; | & | newline) and_or)*)?
+//   and_or   -> cmd_group ((&& | ||) cmd_group)*
+//   cmd_group-> time cmd_group | compound | stage (\| stage)*
+//   compound -> if | while | until | for | { list } | function
+//   stage    -> atomic | compound (input | output)*
+//   atomic   -> name (name | input | output)*
+//
+// A pipeline runs as one command. A compound command that is piped or
+// redirected is therefore only checked in place, and compiled again in
+// the child that runs its stage.
 
-// Main parse function
-bool parse_input(const char* input) {
-    const char* current = input;
-    skip_whitespace(&current);
-    
-    // Empty input is valid
-    if (*current == '\0') {
+#define TOK_END ((token_type_t)-1)
+
+// Jumps of one loop that are patched once its end is known
+typedef struct loop_ctx {
+    int continue_target;
+    int status_slot;      // Loop slot keeping the body's status, or -1
+    int* breaks;
+    int break_count;
+    int break_cap;
+    struct loop_ctx* outer;
+} loop_ctx_t;
+
+typedef struct {
+    const char* text;
+    token_t* tokens;
+    int count;
+    int pos;
+    program_t* prog;      // NULL when only checking the grammar
+    loop_ctx_t* loop;     // Innermost loop being compiled
+    bool incomplete;      // Ran out of tokens inside an open construct
+} parser_t;
+
+bool parse_shell_cmd(parser_t* p);
+bool parse_and_or(parser_t* p, bool* simple, int* run_at);
+bool parse_cmd_group(parser_t* p, bool* simple, int* run_at);
+bool parse_compound(parser_t* p, bool* handled);
+bool parse_atomic(parser_t* p);
+bool parse_input_redirect(parser_t* p);
+bool parse_output_redirect(parser_t* p);
+bool parse_name(parser_t* p);
+bool parse_substitution(const char* start, const char* end);
+
+static token_type_t peek(parser_t* p) {
+    return p->pos < p->count ? p->tokens[p->pos].type : TOK_END;
+}
+
+// Check for an unquoted word, such as a reserved word, at the cursor
+static bool at_word(parser_t* p, const char* word) {
+    if (peek(p) != TOK_WORD) {
+        return false;
+    }
+    token_t* tok = &p->tokens[p->pos];
+    return strlen(word) == tok->length && memcmp(p->text + tok->offset, word, tok->length) == 0;
+}
+
+// Reserved words that end a list
+static bool at_terminator(parser_t* p) {
+    static const char* words[] = {"then", "elif", "else", "fi", "do", "done", "}"};
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+        if (at_word(p, words[i])) return true;
+    }
+    return false;
+}
+
+// Consume an expected reserved word
+static bool expect_word(parser_t* p, const char* word) {
+    if (at_word(p, word)) {
+        p->pos++;
         return true;
     }
-    
-    bool result = parse_shell_cmd(&current);
-    skip_whitespace(&current);
-    
-    // Make sure we consumed all input
-    return result && *current == '\0';
+    if (p->pos == p->count) {
+        p->incomplete = true;
+    }
+    return false;
 }
 
-// Parse shell_cmd -> cmd_group ((& | ;) cmd_group)* &?
-bool parse_shell_cmd(const char** input) {
-    if (!parse_cmd_group(input)) {
-        return false;
+static void skip_newlines(parser_t* p) {
+    while (peek(p) == TOK_NEWLINE) p->pos++;
+}
+
+// Fail on a missing token, remembering that more input could fix it
+static bool need_token(parser_t* p) {
+    if (p->pos < p->count) {
+        return true;
+    }
+    p->incomplete = true;
+    return false;
+}
+
+static int emit(parser_t* p, opcode_t op, int arg, int aux) {
+    return p->prog ? program_emit(p->prog, op, arg, aux) : -1;
+}
+
+static int here(parser_t* p) {
+    return p->prog ? p->prog->code_len : 0;
+}
+
+static void patch(parser_t* p, int at, int target) {
+    if (p->prog && at >= 0) {
+        p->prog->code[at].jump = target;
+    }
+}
+
+static int add_command(parser_t* p, int start, int end) {
+    return p->prog ? program_add_command(p->prog, p->text, p->tokens + start, end - start) : -1;
+}
+
+static bool is_name(const char* s, size_t len) {
+    if (len == 0 || (!isalpha((unsigned char)s[0]) && s[0] != '_')) return false;
+    for (size_t i = 1; i < len; i++) {
+        if (!isalnum((unsigned char)s[i]) && s[i] != '_') return false;
+    }
+    return true;
+}
+
+static parse_status_t run_parser(const char* input, token_list_t* tokens, program_t* prog) {
+    parser_t p = {input, tokens->tokens, tokens->count, 0, prog, NULL, false};
+    bool ok = parse_shell_cmd(&p) && p.pos == p.count;
+    if (ok) return PARSE_OK;
+    return p.incomplete ? PARSE_INCOMPLETE : PARSE_ERROR;
+}
+
+// Parse a line, consulting the parse cache first. A valid line is compiled
+// even when only checked, so that running it afterwards is a cache hit.
+static parse_status_t compile_script(const char* input, size_t len, bool will_run, program_t** prog) {
+    program_t* compiled = NULL;
+    int cached = cached_parse_result(input, len, &compiled);
+    if (cached >= 0) {
+        *prog = compiled;
+        return (parse_status_t)cached;
+    }
+
+    // An unterminated quote may be closed on a following line
+    token_list_t tokens = {NULL, 0, 0};
+    parse_status_t status = PARSE_INCOMPLETE;
+    if (lex_cached(input, len, &tokens)) {
+        // Lines too long to cache are compiled only when they will run
+        bool keep = will_run || len <= PARSE_CACHE_MAX_LINE;
+        compiled = keep ? new_program() : NULL;
+        if (keep && compiled == NULL) {
+            status = PARSE_ERROR;
+        } else {
+            status = run_parser(input, &tokens, compiled);
+        }
+        if (status != PARSE_OK) {
+            release_program(compiled);
+            compiled = NULL;
+        }
+    }
+    free_tokens(&tokens);
+
+    cache_parse_result(input, len, status, compiled);
+    *prog = compiled;
+    return status;
+}
+
+// Main parse function
+bool parse_input(const char* input) {
+    program_t* prog = NULL;
+    parse_status_t status = compile_script(input, strlen(input), false, &prog);
+    release_program(prog);
+    return status == PARSE_OK;
+}
+
+parse_status_t parse_script(const char* input, program_t** prog) {
+    uint64_t start = probe_start();
+    program_t* compiled = NULL;
+    parse_status_t status = compile_script(input, strlen(input), prog != NULL, &compiled);
+
+    if (prog != NULL) {
+        *prog = compiled;
+    } else {
+        release_program(compiled);
     }
-    
-    skip_whitespace(input);
-    
-    while (**input == '&' || **input == ';') {
-        char separator = **input;
-        (*input)++;
-        skip_whitespace(input);
-        if(separator == '&' && **input == '\0'){
+    probe_end(PROBE_PARSE, start);
+    return status;
+}
+
+// Parse shell_cmd -> list of and_or, each ended by ; & or a newline
+bool parse_shell_cmd(parser_t* p) {
+    while (1) {
+        while (peek(p) == TOK_SEMI || peek(p) == TOK_NEWLINE) p->pos++;
+        if (p->pos == p->count || at_terminator(p)) {
             return true;
         }
-    
-        if (!parse_cmd_group(input)) {
+
+        bool simple;
+        int run_at;
+        if (!parse_and_or(p, &simple, &run_at)) {
+            return false;
+        }
+
+        token_type_t separator = peek(p);
+        if (separator == TOK_AMP) {
+            // Only a single pipeline can be sent to the background
+            if (!simple) {
+                return false;
+            }
+            if (p->prog) {
+                p->prog->code[run_at].op = OP_RUN_BG;
+            }
+            p->pos++;
+        } else if (separator != TOK_SEMI && separator != TOK_NEWLINE &&
+                   separator != TOK_END && !at_terminator(p)) {
             return false;
         }
-        
-        skip_whitespace(input);
     }
-    
-    // Optional trailing &
-    // if (**input == '&') {
-    //     (*input)++;
-    //     skip_whitespace(input);
-    // }
-    
-    return true;
 }
 
-// Parse cmd_group -> atomic (\| atomic)*
-bool parse_cmd_group(const char** input) {
-    if (!parse_atomic(input)) {
+// Parse and_or -> cmd_group ((&& | ||) cmd_group)*
+bool parse_and_or(parser_t* p, bool* simple, int* run_at) {
+    if (!parse_cmd_group(p, simple, run_at)) {
         return false;
     }
-    
-    skip_whitespace(input);
-    
-    while (**input == '|') {
-        (*input)++;  // Consume |
-        skip_whitespace(input);
-        
-        if (!parse_atomic(input)) {
+
+    while (peek(p) == TOK_AND_IF || peek(p) == TOK_OR_IF) {
+        // The right side runs only if the left side's status allows it
+        opcode_t op = peek(p) == TOK_AND_IF ? OP_JUMP_IF_FAIL : OP_JUMP_IF_OK;
+        p->pos++;
+        skip_newlines(p);
+        *simple = false;
+
+        int skip = emit(p, op, 0, 0);
+        bool inner_simple;
+        int inner_run;
+        if (!parse_cmd_group(p, &inner_simple, &inner_run)) {
             return false;
         }
-        
-        skip_whitespace(input);
+        patch(p, skip, here(p));
     }
-    
+
     return true;
 }
 
-// Parse atomic -> name (name | input | output)*
-bool parse_atomic(const char** input) {
-    if (!parse_name(input)) {
-        return false;
-    }
-    
-    skip_whitespace(input);
-    
-    while (**input != '\0' && **input != '|' && **input != '&' && **input != ';') {
-        const char* old_pos = *input;
-        
-        if (parse_name(input) || parse_input_redirect(input) || parse_output_redirect(input)) {
-            skip_whitespace(input);
-        } else {
-            *input = old_pos;
+// Compound commands that can be a pipeline stage or be redirected
+static bool at_stage_compound(parser_t* p) {
+    return at_word(p, "if") || at_word(p, "while") || at_word(p, "until") ||
+           at_word(p, "for") || at_word(p, "{");
+}
+
+// Parse stage -> atomic | compound (input | output)*, checking the grammar
+// only. redirect_at is set to the first redirection of a compound stage,
+// or -1 for an atomic one.
+static bool parse_stage(parser_t* p, int* redirect_at) {
+    *redirect_at = -1;
+    if (!at_stage_compound(p)) {
+        return parse_atomic(p);
+    }
+
+    // Its break and continue cannot leave loops outside the stage
+    program_t* prog = p->prog;
+    loop_ctx_t* loop = p->loop;
+    p->prog = NULL;
+    p->loop = NULL;
+    bool handled;
+    bool ok = parse_compound(p, &handled);
+    p->prog = prog;
+    p->loop = loop;
+
+    *redirect_at = p->pos;
+    while (ok && is_redirection_token(peek(p))) {
+        ok = parse_input_redirect(p) || parse_output_redirect(p);
+    }
+    return ok;
+}
+
+// Whether the compound command at the cursor is piped or redirected,
+// looking ahead without compiling it
+static bool compound_is_stage(parser_t* p) {
+    parser_t ahead = *p;
+    ahead.prog = NULL;
+    ahead.loop = NULL;
+    bool handled;
+    return parse_compound(&ahead, &handled) &&
+           (peek(&ahead) == TOK_PIPE || is_redirection_token(peek(&ahead)));
+}
+
+int pipeline_stages(const char* text, const token_list_t* tokens, int* pipes, int* redirects) {
+    parser_t p = {text, tokens->tokens, tokens->count, 0, NULL, NULL, false};
+    int stages = 0;
+    while (1) {
+        if (!need_token(&p) || !parse_stage(&p, &redirects[stages])) {
+            return 0;
+        }
+        stages++;
+        if (peek(&p) != TOK_PIPE) {
             break;
         }
+        pipes[stages - 1] = p.pos++;
+        skip_newlines(&p);
+    }
+    return p.pos == p.count ? stages : 0;
+}
+
+// Parse cmd_group -> time cmd_group | compound | stage (\| stage)*
+bool parse_cmd_group(parser_t* p, bool* simple, int* run_at) {
+    if (!need_token(p)) {
+        return false;
+    }
+
+    // time prefixes a whole pipeline, so it is a keyword, not a command
+    if (at_word(p, "time") && p->pos + 1 < p->count && p->tokens[p->pos + 1].type == TOK_WORD) {
+        p->pos++;
+        int slot = p->prog ? p->prog->timer_slots++ : 0;
+        emit(p, OP_TIME_START, 0, slot);
+        if (!parse_cmd_group(p, simple, run_at)) {
+            return false;
+        }
+        emit(p, OP_TIME_END, 0, slot);
+        *simple = false;
+        return true;
+    }
+
+    // A compound command on its own is compiled in place. When only
+    // checking, the compound is parsed once and the pipeline carries on
+    // from its end.
+    int start = p->pos;
+    bool staged = at_stage_compound(p) && (p->prog == NULL || compound_is_stage(p));
+    if (!staged) {
+        bool handled;
+        bool ok = parse_compound(p, &handled);
+        if (handled) {
+            *simple = false;
+            return ok;
+        }
+    }
+
+    int redirect_at;
+    if (!parse_stage(p, &redirect_at)) {
+        return false;
+    }
+    if (staged && redirect_at == p->pos && peek(p) != TOK_PIPE) {
+        // Only checking, and the compound stands on its own after all
+        *simple = false;
+        return true;
+    }
+    while (peek(p) == TOK_PIPE) {
+        p->pos++;  // Consume |
+        skip_newlines(p);
+        if (!need_token(p) || !parse_stage(p, &redirect_at)) {
+            return false;
+        }
+    }
+
+    *simple = true;
+    *run_at = emit(p, OP_RUN, add_command(p, start, p->pos), 0);
+    return true;
+}
+
+// if -> if list then list (elif list then list)* (else list)? fi
+static bool parse_if_clause(parser_t* p) {
+    if (!parse_shell_cmd(p) || !expect_word(p, "then")) {
+        return false;
     }
-    
+    int skip = emit(p, OP_JUMP_IF_FAIL, 0, 0);
+    if (!parse_shell_cmd(p)) {
+        return false;
+    }
+    int done = emit(p, OP_JUMP, 0, 0);
+    patch(p, skip, here(p));
+
+    if (at_word(p, "elif")) {
+        p->pos++;
+        if (!parse_if_clause(p)) return false;
+    } else if (at_word(p, "else")) {
+        p->pos++;
+        if (!parse_shell_cmd(p) || !expect_word(p, "fi")) return false;
+    } else {
+        if (!expect_word(p, "fi")) return false;
+        // No branch ran
+        emit(p, OP_SET_STATUS, 0, 0);
+    }
+
+    patch(p, done, here(p));
     return true;
 }
 
-// Parse input -> < name | <name
-bool parse_input_redirect(const char** input) {
-    if (**input != '<') {
+// Parse a loop body up to "done" with break and continue bound to ctx,
+// then jump back to top and patch the exits
+static bool parse_loop_body(parser_t* p, loop_ctx_t* ctx, int top, int exit_jump) {
+    ctx->outer = p->loop;
+    p->loop = ctx;
+    bool ok = parse_shell_cmd(p) && expect_word(p, "done");
+    p->loop = ctx->outer;
+
+    if (ok) {
+        // A loop has the status of the last body command it ran; a while
+        // condition would overwrite it, so it is kept aside meanwhile
+        if (ctx->status_slot >= 0) {
+            emit(p, OP_SAVE_STATUS, 0, ctx->status_slot);
+        }
+        patch(p, emit(p, OP_JUMP, 0, 0), top);
+        if (ctx->status_slot >= 0) {
+            patch(p, exit_jump, emit(p, OP_RESTORE_STATUS, 0, ctx->status_slot));
+        } else {
+            patch(p, exit_jump, here(p));
+        }
+
+        // break already set the status to 0
+        int end = here(p);
+        for (int i = 0; i < ctx->break_count; i++) {
+            patch(p, ctx->breaks[i], end);
+        }
+    }
+    free(ctx->breaks);
+    return ok;
+}
+
+// while -> (while | until) list do list done
+static bool parse_while(parser_t* p) {
+    bool until = at_word(p, "until");
+    p->pos++;
+
+    // Status 0 stands if the body never runs
+    int slot = p->prog ? p->prog->loop_slots++ : 0;
+    emit(p, OP_SET_STATUS, 0, 0);
+    emit(p, OP_SAVE_STATUS, 0, slot);
+
+    int top = here(p);
+    if (!parse_shell_cmd(p) || !expect_word(p, "do")) {
+        return false;
+    }
+    int exit_jump = emit(p, until ? OP_JUMP_IF_OK : OP_JUMP_IF_FAIL, 0, 0);
+
+    loop_ctx_t ctx = {top, slot, NULL, 0, 0, NULL};
+    return parse_loop_body(p, &ctx, top, exit_jump);
+}
+
+// for -> for NAME (in name*)? (; | newline) do list done
+static bool parse_for(parser_t* p) {
+    p->pos++;
+    if (!need_token(p)) {
+        return false;
+    }
+
+    token_t* var = &p->tokens[p->pos];
+    if (var->type != TOK_WORD || !is_name(p->text + var->offset, var->length)) {
+        return false;
+    }
+    p->pos++;
+    skip_newlines(p);
+
+    int cmd = -1;
+    if (at_word(p, "in")) {
+        p->pos++;
+        int start = p->pos;
+        while (peek(p) == TOK_WORD) p->pos++;
+        if (!need_token(p) || (peek(p) != TOK_SEMI && peek(p) != TOK_NEWLINE)) {
+            return false;
+        }
+        cmd = add_command(p, start, p->pos);
+        p->pos++;
+    } else {
+        // Without "in" the loop runs over the positional parameters
+        static const char all_args[] = "\"$@\"";
+        token_t word = {TOK_WORD, 0, sizeof(all_args) - 1};
+        if (p->prog) cmd = program_add_command(p->prog, all_args, &word, 1);
+        if (peek(p) == TOK_SEMI) p->pos++;
+    }
+    skip_newlines(p);
+    if (!expect_word(p, "do")) {
         return false;
     }
-    
-    (*input)++;  // Consume <
-    skip_whitespace(input);
-    
-    return parse_name(input);
+
+    int slot = 0;
+    if (p->prog && cmd >= 0) {
+        p->prog->cmds[cmd].var = strndup(p->text + var->offset, var->length);
+        slot = p->prog->loop_slots++;
+    }
+    emit(p, OP_FOR_INIT, cmd, slot);
+    // Status 0 stands if the body never runs; OP_FOR_NEXT leaves $? alone
+    emit(p, OP_SET_STATUS, 0, 0);
+    int top = emit(p, OP_FOR_NEXT, cmd, slot);
+
+    loop_ctx_t ctx = {top, -1, NULL, 0, 0, NULL};
+    return parse_loop_body(p, &ctx, top, top);
 }
 
-// Parse output -> > name | >name | >> name | >>name
-bool parse_output_redirect(const char** input) {
-    if (**input != '>') {
+// function -> NAME () { list } | function NAME (())? { list }
+static bool parse_function(parser_t* p) {
+    if (at_word(p, "function")) {
+        p->pos++;
+        if (!need_token(p)) return false;
+    }
+
+    token_t* tok = &p->tokens[p->pos++];
+    const char* name = p->text + tok->offset;
+    size_t name_len = tok->length;
+    if (name_len > 2 && memcmp(name + name_len - 2, "()", 2) == 0) {
+        name_len -= 2;
+    } else if (at_word(p, "()")) {
+        p->pos++;
+    }
+    if (!is_name(name, name_len)) {
+        return false;
+    }
+
+    skip_newlines(p);
+    if (!expect_word(p, "{")) {
         return false;
     }
-    
-    (*input)++;  // Consume first >
-    
-    if (**input == '>') {
-        (*input)++;  // Consume second > if present
+
+    // The body compiles to a program of its own, kept by the definition
+    parser_t body = *p;
+    body.loop = NULL;
+    body.prog = p->prog ? new_program() : NULL;
+    bool ok = parse_shell_cmd(&body) && expect_word(&body, "}");
+    p->pos = body.pos;
+    p->incomplete = body.incomplete;
+
+    if (!ok || p->prog == NULL) {
+        release_program(body.prog);
+        return ok;
     }
-    
-    skip_whitespace(input);
-    
-    return parse_name(input);
+    emit(p, OP_DEFINE, program_add_function(p->prog, name, name_len, body.prog), 0);
+    return true;
 }
 
-// Parse name -> r"[^|&><;]+"
-bool parse_name(const char** input) {
-    if (**input == '\0' || **input == '|' || **input == '&' || **input == '>' ||
-        **input == '<' || **input == ';') {
+// break/continue [n]
+static bool parse_loop_control(parser_t* p) {
+    bool is_break = at_word(p, "break");
+    p->pos++;
+
+    int levels = 1;
+    if (peek(p) == TOK_WORD) {
+        token_t* tok = &p->tokens[p->pos++];
+        char digits[16];
+        if (tok->length == 0 || tok->length >= sizeof(digits)) return false;
+        memcpy(digits, p->text + tok->offset, tok->length);
+        digits[tok->length] = '\0';
+        char* end;
+        levels = (int)strtol(digits, &end, 10);
+        if (*end != '\0' || levels < 1) return false;
+    }
+
+    // Outside a loop there is nothing to leave
+    loop_ctx_t* ctx = p->loop;
+    if (ctx == NULL) {
+        emit(p, OP_SET_STATUS, 0, 0);
+        return true;
+    }
+    while (--levels > 0 && ctx->outer != NULL) ctx = ctx->outer;
+
+    // break and continue themselves have status 0
+    emit(p, OP_SET_STATUS, 0, 0);
+    if (!is_break && ctx->status_slot >= 0) {
+        emit(p, OP_SAVE_STATUS, 0, ctx->status_slot);
+    }
+    int jump = emit(p, OP_JUMP, 0, 0);
+    if (!is_break) {
+        patch(p, jump, ctx->continue_target);
+    } else if (p->prog) {
+        if (ctx->break_count == ctx->break_cap) {
+            ctx->break_cap = ctx->break_cap ? ctx->break_cap * 2 : 4;
+            int* breaks = realloc(ctx->breaks, ctx->break_cap * sizeof(int));
+            if (breaks == NULL) return false;
+            ctx->breaks = breaks;
+        }
+        ctx->breaks[ctx->break_count++] = jump;
+    }
+    return true;
+}
+
+// Parse the compound commands and the words with a meaning of their own
+bool parse_compound(parser_t* p, bool* handled) {
+    *handled = true;
+
+    if (at_word(p, "if")) {
+        p->pos++;
+        return parse_if_clause(p);
+    }
+    if (at_word(p, "while") || at_word(p, "until")) {
+        return parse_while(p);
+    }
+    if (at_word(p, "for")) {
+        return parse_for(p);
+    }
+    if (at_word(p, "{")) {
+        p->pos++;
+        return parse_shell_cmd(p) && expect_word(p, "}");
+    }
+    if (at_word(p, "break") || at_word(p, "continue")) {
+        return parse_loop_control(p);
+    }
+    if (at_word(p, "return") || at_word(p, "exit")) {
+        bool leave_shell = at_word(p, "exit");
+        p->pos++;
+        int cmd = -1;
+        if (peek(p) == TOK_WORD) {
+            cmd = add_command(p, p->pos, p->pos + 1);
+            p->pos++;
+        }
+        emit(p, OP_RETURN, cmd, leave_shell);
+        return true;
+    }
+
+    // NAME() or NAME () or function NAME
+    token_t* tok = &p->tokens[p->pos];
+    bool paren_suffix = tok->type == TOK_WORD && tok->length > 2 &&
+                        memcmp(p->text + tok->offset + tok->length - 2, "()", 2) == 0;
+    bool paren_next = p->pos + 1 < p->count && tok->type == TOK_WORD &&
+                      p->tokens[p->pos + 1].type == TOK_WORD &&
+                      p->tokens[p->pos + 1].length == 2 &&
+                      memcmp(p->text + p->tokens[p->pos + 1].offset, "()", 2) == 0;
+    if (at_word(p, "function") || paren_suffix || paren_next) {
+        return parse_function(p);
+    }
+
+    *handled = false;
+    return false;
+}
+
+// Parse atomic -> name (name | input | output)*
+bool parse_atomic(parser_t* p) {
+    if (at_terminator(p) || !parse_name(p)) {
+        return false;
+    }
+
+    while (p->pos < p->count) {
+        token_type_t type = peek(p);
+        if (type == TOK_PIPE || type == TOK_AMP || type == TOK_SEMI || type == TOK_NEWLINE ||
+            type == TOK_AND_IF || type == TOK_OR_IF) {
+            break;
+        }
+        if (!parse_name(p) && !parse_input_redirect(p) && !parse_output_redirect(p)) {
             return false;
         }
-        
-        // Consume all characters that are not special
-        while (**input != '\0' && **input != '|' && **input != '&' && **input != '>' &&
-            **input != '<' && **input != ';' && !isspace(**input)) {
-                (*input)++;
+    }
+
+    return true;
+}
+
+// Parse input -> < name | << name | <<- name | <<< name
+bool parse_input_redirect(parser_t* p) {
+    token_type_t type = peek(p);
+    if (type != TOK_LT && type != TOK_HEREDOC && type != TOK_HEREDOC_TAB &&
+        type != TOK_HERESTRING) {
+        return false;
+    }
+
+    p->pos++;
+    return need_token(p) && parse_name(p);
+}
+
+// Parse output -> > name | >> name
+bool parse_output_redirect(parser_t* p) {
+    if (peek(p) != TOK_GT && peek(p) != TOK_DGT) {
+        return false;
+    }
+
+    p->pos++;
+    return need_token(p) && parse_name(p);
+}
+
+// Parse name -> a word token, where $(shell_cmd) may appear anywhere
+bool parse_name(parser_t* p) {
+    if (peek(p) != TOK_WORD) {
+        return false;
+    }
+
+    token_t* tok = &p->tokens[p->pos++];
+    const char* word = p->text + tok->offset;
+    const char* end = word + tok->length;
+    char quote = '\0';
+
+    // $(...) is live everywhere except inside single quotes
+    for (const char* c = word; c < end; c++) {
+        if (quote == '\'') {
+            if (*c == '\'') quote = '\0';
+        } else if (*c == '\'' && quote == '\0') {
+            quote = '\'';
+        } else if (*c == '"') {
+            quote = quote ? '\0' : '"';
+        } else if (*c == '\\') {
+            c++;
+        } else if (c[0] == '$' && c[1] == '(') {
+            const char* close = skip_substitution(c);
+            if (close == NULL) {
+                return false;
             }
-            
-            return true;
-        }
-        
-        // Helper function to skip whitespace
-        void skip_whitespace(const char** input) {
-            while (**input != '\0' && isspace(**input)) {
-                (*input)++;
+            // $((...)) is arithmetic, checked when it is evaluated
+            bool arithmetic = c[2] == '(' && close[-2] == ')';
+            if (!arithmetic && !parse_substitution(c, close)) {
+                return false;
             }
+            c = close - 1;
         }
+    }
+
+    return true;
+}
+
+// Parse substitution -> $( shell_cmd )
+bool parse_substitution(const char* start, const char* end) {
+    // The enclosed text must itself be a valid command line
+    char* inner = strndup(start + 2, (end - 1) - (start + 2));
+    if (inner == NULL) {
+        return false;
+    }
+    bool valid = parse_input(inner);
+    free(inner);
+    return valid;
+}
 // ############## LLM Generated Code Ends ################
\ No newline at end of file
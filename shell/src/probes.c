@@ -0,0 +1,156 @@
+#define _GNU_SOURCE
+#include "probes.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+// ############## LLM Generated Code Begins ##############
+
+// Power-of-two buckets of nanoseconds: bucket b holds [2^(b-1), 2^b)
+#define PROBE_BUCKETS 40
+// Most trace events kept; later ones are counted but not recorded
+#define TRACE_MAX_EVENTS (1 << 18)
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint32_t buckets[PROBE_BUCKETS];
+} probe_stats_t;
+
+typedef struct {
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    probe_stage_t stage;
+} trace_event_t;
+
+static const char* stage_names[PROBE_STAGES] = {
+    "prompt", "input", "parse", "lex", "log", "execute", "spawn", "wait", "reap"
+};
+
+static bool enabled = false;
+static probe_stats_t stage_stats[PROBE_STAGES];
+
+static char* trace_path = NULL;
+static trace_event_t* trace = NULL;
+static size_t trace_count = 0;
+static size_t trace_cap = 0;
+static uint64_t trace_dropped = 0;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void record_trace(probe_stage_t stage, uint64_t start, uint64_t duration) {
+    if (trace_count == trace_cap) {
+        size_t cap = trace_cap ? trace_cap * 2 : 4096;
+        trace_event_t* grown = cap <= TRACE_MAX_EVENTS ? realloc(trace, cap * sizeof(trace_event_t)) : NULL;
+        if (grown == NULL) {
+            trace_dropped++;
+            return;
+        }
+        trace = grown;
+        trace_cap = cap;
+    }
+    trace[trace_count].start_ns = start;
+    trace[trace_count].duration_ns = duration;
+    trace[trace_count].stage = stage;
+    trace_count++;
+}
+
+// Write the trace-event JSON that chrome://tracing and Perfetto load
+static void write_trace() {
+    FILE* out = fopen(trace_path, "w");
+    if (out == NULL) {
+        perror("shell trace: fopen failed");
+        return;
+    }
+    int pid = (int)getpid();
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"shell\"}}",
+            pid, pid);
+    for (size_t i = 0; i < trace_count; i++) {
+        fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"shell\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                stage_names[trace[i].stage], trace[i].start_ns / 1e3, trace[i].duration_ns / 1e3, pid, pid);
+    }
+    fprintf(out, "\n],\"otherData\":{\"dropped\":%llu}}\n", (unsigned long long)trace_dropped);
+    fclose(out);
+}
+
+void init_probes() {
+    const char* path = getenv("SHELL_TRACE");
+    if (path == NULL || *path == '\0') {
+        return;
+    }
+    trace_path = strdup(path);
+    if (trace_path != NULL) {
+        enabled = true;
+        // Forked children leave with _exit, so only the shell writes it
+        atexit(write_trace);
+    }
+}
+
+uint64_t probe_start() {
+    return enabled ? now_ns() : 0;
+}
+
+void probe_end(probe_stage_t stage, uint64_t start) {
+    if (start == 0 || !enabled) {
+        return;
+    }
+    uint64_t duration = now_ns() - start;
+    probe_stats_t* s = &stage_stats[stage];
+    int bucket = duration == 0 ? 0 : 64 - __builtin_clzll(duration);
+    s->buckets[bucket < PROBE_BUCKETS ? bucket : PROBE_BUCKETS - 1]++;
+    s->count++;
+    s->total_ns += duration;
+    if (duration > s->max_ns) s->max_ns = duration;
+    if (trace_path != NULL) {
+        record_trace(stage, start, duration);
+    }
+}
+
+void set_probes_enabled(bool on) {
+    enabled = on;
+}
+
+bool probes_enabled() {
+    return enabled;
+}
+
+void reset_probes() {
+    memset(stage_stats, 0, sizeof(stage_stats));
+}
+
+void print_probe_stats() {
+    printf("stages: %s\n", enabled ? "on" : "off");
+    for (int i = 0; i < PROBE_STAGES; i++) {
+        const probe_stats_t* s = &stage_stats[i];
+        if (s->count == 0) {
+            continue;
+        }
+        char total[16], mean[16], max[16];
+        format_duration(s->total_ns / 1e9, total, sizeof(total));
+        format_duration(s->total_ns / 1e9 / s->count, mean, sizeof(mean));
+        format_duration(s->max_ns / 1e9, max, sizeof(max));
+        printf("  %-8s %8llu  total %-9s mean %-9s max %s\n", stage_names[i],
+               (unsigned long long)s->count, total, mean, max);
+
+        // One entry per non-empty bucket, labelled by its upper bound
+        printf("          ");
+        for (int b = 0; b < PROBE_BUCKETS; b++) {
+            if (s->buckets[b] == 0) {
+                continue;
+            }
+            char bound[16];
+            format_duration((double)(1ull << b) / 1e9, bound, sizeof(bound));
+            printf(" <%s:%u", bound, s->buckets[b]);
+        }
+        printf("\n");
+    }
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
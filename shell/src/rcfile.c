@@ -0,0 +1,473 @@
+#define _GNU_SOURCE
+#include "rcfile.h"
+#include "parser.h"
+#include "vm.h"
+#include "expand.h"
+#include "timers.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+// ############## LLM Generated Code Begins ##############
+
+// Snapshot layout: the header, then the top-level program:
+//   u32 x5  code length, commands, functions, loop slots, timer slots
+//   the instructions, as instr_t
+//   per command: u32 text length, u32 token count, u32 loop variable
+//                length + 1 (0 for none), the text, the tokens as
+//                token_t, the variable
+//   per function: u32 name length, the name, then its body as a program
+// Everything is in host order; the layout word rejects snapshots of a
+// build whose instructions or tokens differ, and the body hash one that
+// was corrupted on disk. Snapshots are renamed into place whole, so the
+// body hash is only checked when the rc file's key no longer matches.
+#define SNAPSHOT_MAGIC "SHSNAP02"
+#define SNAPSHOT_LAYOUT ((uint32_t)(sizeof(instr_t) | sizeof(token_t) << 8 | \
+                                    OP_RESTORE_STATUS << 16 | TOK_HERESTRING << 24))
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+// Functions nest no deeper than this in a snapshot
+#define MAX_NESTING 64
+// An rc file changed this recently might change again within the same
+// mtime tick, so its mtime is not trusted until the next start
+#define RACY_SECONDS 2
+
+typedef struct {
+    char magic[8];
+    uint32_t layout;
+    uint32_t reserved;
+    uint64_t rc_mtime;   // Nanoseconds; 0 means check the hash
+    uint64_t rc_ino;
+    uint64_t rc_size;
+    uint64_t rc_hash;
+    uint64_t body_len;
+    uint64_t body_hash;  // FNV-1a of the body
+} snapshot_header_t;
+
+// Bounds-checked reader over the mapped body
+typedef struct {
+    const unsigned char* p;
+    const unsigned char* end;
+} reader_t;
+
+static uint64_t fnv1a(const char* data, size_t len) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static uint64_t mtime_ns(const struct stat* st) {
+    return (uint64_t)st->st_mtim.tv_sec * 1000000000ULL + (uint64_t)st->st_mtim.tv_nsec;
+}
+
+// The mtime to key a snapshot on, or 0 while it is too recent to trust
+static uint64_t trusted_mtime(const struct stat* st) {
+    return st->st_mtim.tv_sec + RACY_SECONDS > time(NULL) ? 0 : mtime_ns(st);
+}
+
+// ~/.shellrc and ~/.shellrc.snap
+static bool rc_paths(char* rc, char* snapshot) {
+    const char* home = getenv("HOME");
+    if (home == NULL || home[0] == '\0') {
+        struct passwd* pw = getpwuid(getuid());
+        home = pw ? pw->pw_dir : NULL;
+    }
+    if (home == NULL) {
+        return false;
+    }
+    return snprintf(rc, PATH_MAX, "%s/.shellrc", home) < PATH_MAX &&
+           snprintf(snapshot, PATH_MAX, "%s/.shellrc.snap", home) < PATH_MAX;
+}
+
+// Read the whole rc file; st is refreshed from the open file so the key
+// matches the text that was read
+static char* read_rc(const char* path, struct stat* st) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, st) == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if (fd != -1) close(fd);
+        return NULL;
+    }
+
+    char* text = malloc(st->st_size + 1);
+    if (text == NULL) {
+        perror("malloc failed");
+        close(fd);
+        return NULL;
+    }
+    size_t got = 0;
+    while (got < (size_t)st->st_size) {
+        ssize_t n = read(fd, text + got, st->st_size - got);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        got += n;
+    }
+    close(fd);
+    // A file that shrank while it was read is keyed by what was read
+    st->st_size = got;
+    text[got] = '\0';
+    return text;
+}
+
+static bool put_u32(capture_buf_t* buf, size_t value) {
+    uint32_t v = (uint32_t)value;
+    return value <= UINT32_MAX && capture_append(buf, (const char*)&v, sizeof(v));
+}
+
+static bool save_program(capture_buf_t* buf, const program_t* prog) {
+    bool ok = put_u32(buf, prog->code_len) && put_u32(buf, prog->cmd_count) &&
+              put_u32(buf, prog->func_count) && put_u32(buf, prog->loop_slots) &&
+              put_u32(buf, prog->timer_slots) &&
+              capture_append(buf, (const char*)prog->code, prog->code_len * sizeof(instr_t));
+
+    for (int i = 0; ok && i < prog->cmd_count; i++) {
+        const vm_cmd_t* cmd = &prog->cmds[i];
+        size_t text_len = strlen(cmd->text);
+        size_t var_len = cmd->var ? strlen(cmd->var) : 0;
+        ok = put_u32(buf, text_len) && put_u32(buf, cmd->count) &&
+             put_u32(buf, cmd->var ? var_len + 1 : 0) &&
+             capture_append(buf, cmd->text, text_len) &&
+             capture_append(buf, (const char*)cmd->tokens, cmd->count * sizeof(token_t)) &&
+             capture_append(buf, cmd->var ? cmd->var : "", var_len);
+    }
+    for (int i = 0; ok && i < prog->func_count; i++) {
+        size_t name_len = strlen(prog->funcs[i].name);
+        ok = put_u32(buf, name_len) && capture_append(buf, prog->funcs[i].name, name_len) &&
+             save_program(buf, prog->funcs[i].body);
+    }
+    return ok;
+}
+
+static bool get_bytes(reader_t* r, void* dst, size_t len) {
+    if ((size_t)(r->end - r->p) < len) {
+        return false;
+    }
+    memcpy(dst, r->p, len);
+    r->p += len;
+    return true;
+}
+
+static bool get_u32(reader_t* r, int* value) {
+    uint32_t v;
+    if (!get_bytes(r, &v, sizeof(v)) || v > INT32_MAX) {
+        return false;
+    }
+    *value = (int)v;
+    return true;
+}
+
+// A copy of the next len bytes as a string
+static char* get_string(reader_t* r, int len) {
+    if (r->end - r->p < len) {
+        return NULL;
+    }
+    char* str = strndup((const char*)r->p, len);
+    r->p += len;
+    return str;
+}
+
+static bool load_command(reader_t* r, vm_cmd_t* cmd) {
+    int text_len, var_len;
+    if (!get_u32(r, &text_len) || !get_u32(r, &cmd->count) || !get_u32(r, &var_len) ||
+        (size_t)cmd->count > (size_t)(r->end - r->p) / sizeof(token_t)) {
+        return false;
+    }
+    cmd->text = get_string(r, text_len);
+    cmd->tokens = malloc((cmd->count + 1) * sizeof(token_t));
+    if (cmd->text == NULL || cmd->tokens == NULL ||
+        !get_bytes(r, cmd->tokens, cmd->count * sizeof(token_t))) {
+        return false;
+    }
+    for (int i = 0; i < cmd->count; i++) {
+        if ((uint64_t)cmd->tokens[i].offset + cmd->tokens[i].length > (uint64_t)text_len) {
+            return false;
+        }
+    }
+    return var_len == 0 || (cmd->var = get_string(r, var_len - 1)) != NULL;
+}
+
+// Check that every operand the VM indexes with is in range
+static bool check_program(const program_t* prog) {
+    for (int i = 0; i < prog->code_len; i++) {
+        const instr_t* in = &prog->code[i];
+        bool cmd_arg = in->arg >= 0 && in->arg < prog->cmd_count;
+        bool ok = in->jump >= 0 && in->jump <= prog->code_len;
+        switch (in->op) {
+        case OP_RUN:
+        case OP_RUN_BG:
+            ok = ok && cmd_arg;
+            break;
+        case OP_FOR_INIT:
+        case OP_FOR_NEXT:
+            ok = ok && cmd_arg && prog->cmds[in->arg].var != NULL &&
+                 in->aux >= 0 && in->aux < prog->loop_slots;
+            break;
+        case OP_DEFINE:
+            ok = ok && in->arg >= 0 && in->arg < prog->func_count;
+            break;
+        case OP_RETURN:
+            ok = ok && (in->arg == -1 || cmd_arg);
+            break;
+        case OP_TIME_START:
+        case OP_TIME_END:
+            ok = ok && in->aux >= 0 && in->aux < prog->timer_slots;
+            break;
+        case OP_SAVE_STATUS:
+        case OP_RESTORE_STATUS:
+            ok = ok && in->aux >= 0 && in->aux < prog->loop_slots;
+            break;
+        case OP_JUMP:
+        case OP_JUMP_IF_FAIL:
+        case OP_JUMP_IF_OK:
+        case OP_SET_STATUS:
+            break;
+        default:
+            ok = false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rebuild a program from the snapshot; NULL if it is malformed
+static program_t* load_program(reader_t* r, int depth) {
+    program_t* prog = depth < MAX_NESTING ? new_program() : NULL;
+    if (prog == NULL) {
+        return NULL;
+    }
+
+    int func_count = 0;
+    bool ok = get_u32(r, &prog->code_len) && get_u32(r, &prog->cmd_count) &&
+              get_u32(r, &func_count) && get_u32(r, &prog->loop_slots) &&
+              get_u32(r, &prog->timer_slots) &&
+              (size_t)prog->code_len <= (size_t)(r->end - r->p) / sizeof(instr_t) &&
+              (size_t)prog->cmd_count <= (size_t)(r->end - r->p) / (3 * sizeof(uint32_t));
+    if (ok) {
+        // Empty arrays are still allocated so a failure below frees cleanly
+        prog->code = malloc(prog->code_len * sizeof(instr_t) + 1);
+        prog->cmds = calloc(prog->cmd_count + 1, sizeof(vm_cmd_t));
+        prog->code_cap = prog->code_len;
+        prog->cmd_cap = prog->cmd_count;
+        ok = prog->code != NULL && prog->cmds != NULL &&
+             get_bytes(r, prog->code, prog->code_len * sizeof(instr_t));
+    }
+    if (prog->cmds == NULL) {
+        prog->cmd_count = 0;
+    }
+
+    for (int i = 0; ok && i < prog->cmd_count; i++) {
+        ok = load_command(r, &prog->cmds[i]);
+    }
+    for (int i = 0; ok && i < func_count; i++) {
+        int name_len;
+        ok = get_u32(r, &name_len) && (size_t)name_len <= (size_t)(r->end - r->p);
+        if (ok) {
+            const char* name = (const char*)r->p;
+            r->p += name_len;
+            program_t* body = load_program(r, depth + 1);
+            ok = body != NULL && program_add_function(prog, name, name_len, body) == i;
+        }
+    }
+
+    if (!ok || !check_program(prog)) {
+        release_program(prog);
+        return NULL;
+    }
+    return prog;
+}
+
+// Map the snapshot and check its header; returns the mapping or NULL
+static void* map_snapshot(const char* path, size_t* len, snapshot_header_t* header) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return NULL;
+    }
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(*header)) {
+        map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    *len = st.st_size;
+    memcpy(header, map, sizeof(*header));
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+        header->layout != SNAPSHOT_LAYOUT ||
+        header->body_len != *len - sizeof(*header)) {
+        munmap(map, *len);
+        return NULL;
+    }
+    madvise(map, *len, MADV_SEQUENTIAL);
+    return map;
+}
+
+static bool body_intact(const void* map, const snapshot_header_t* header) {
+    return header->body_hash == fnv1a((const char*)map + sizeof(*header), header->body_len);
+}
+
+// Write the snapshot under a temporary name and move it into place, so
+// a shell starting meanwhile sees the old one or the new one. A home
+// that cannot be written to just means compiling on every start.
+static size_t save_snapshot(const char* path, const program_t* prog, const struct stat* st,
+                            uint64_t hash) {
+    capture_buf_t body = {NULL, 0, 0};
+    if (!save_program(&body, prog)) {
+        free(body.data);
+        return 0;
+    }
+
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.layout = SNAPSHOT_LAYOUT;
+    header.rc_mtime = trusted_mtime(st);
+    header.rc_ino = st->st_ino;
+    header.rc_size = st->st_size;
+    header.rc_hash = hash;
+    header.body_len = body.len;
+    header.body_hash = fnv1a(body.data, body.len);
+
+    char tmp[PATH_MAX + 8];
+    snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+    int fd = mkstemp(tmp);
+    if (fd == -1) {
+        free(body.data);
+        return 0;
+    }
+    bool ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+              write(fd, body.data, body.len) == (ssize_t)body.len;
+    ok = close(fd) == 0 && ok && rename(tmp, path) == 0;
+    if (!ok) {
+        unlink(tmp);
+    }
+    free(body.data);
+    return ok ? sizeof(header) + header.body_len : 0;
+}
+
+// Key a snapshot on the rc file's current mtime once its text was found
+// unchanged, so the next start needs only the stat
+static void refresh_key(const char* path, snapshot_header_t* header, const struct stat* st) {
+    header->rc_mtime = trusted_mtime(st);
+    header->rc_ino = st->st_ino;
+    if (header->rc_mtime == 0) {
+        return;
+    }
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd != -1) {
+        // If this fails the hash is simply checked again next time
+        ssize_t written = pwrite(fd, header, sizeof(*header), 0);
+        (void)written;
+        close(fd);
+    }
+}
+
+void run_rcfile(rc_timing_t* timing) {
+    rc_timing_t unused;
+    if (timing == NULL) {
+        timing = &unused;
+    }
+    memset(timing, 0, sizeof(*timing));
+
+    char rc_path[PATH_MAX];
+    char snapshot_path[PATH_MAX];
+    double started = monotonic_seconds();
+    struct stat st;
+    if (!rc_paths(rc_path, snapshot_path) || stat(rc_path, &st) == -1) {
+        timing->check = monotonic_seconds() - started;
+        return;
+    }
+
+    // The snapshot is current if the rc file kept its mtime, inode and
+    // size; otherwise its text is hashed and compared, and the body is
+    // checked before the key is refreshed
+    snapshot_header_t header;
+    size_t map_len = 0;
+    void* map = map_snapshot(snapshot_path, &map_len, &header);
+    bool current = map != NULL && header.rc_mtime != 0 && header.rc_mtime == mtime_ns(&st) &&
+                   header.rc_ino == (uint64_t)st.st_ino && header.rc_size == (uint64_t)st.st_size;
+    char* text = NULL;
+    uint64_t hash = 0;
+    if (!current) {
+        text = read_rc(rc_path, &st);
+        if (text == NULL) {
+            if (map != NULL) munmap(map, map_len);
+            timing->source = RC_FAILED;
+            timing->check = monotonic_seconds() - started;
+            return;
+        }
+        hash = fnv1a(text, st.st_size);
+        current = map != NULL && header.rc_hash == hash && header.rc_size == (uint64_t)st.st_size &&
+                  body_intact(map, &header);
+        if (current && (header.rc_mtime != mtime_ns(&st) || header.rc_ino != (uint64_t)st.st_ino)) {
+            refresh_key(snapshot_path, &header, &st);
+        }
+    }
+    timing->size = st.st_size;
+    double checked = monotonic_seconds();
+    timing->check = checked - started;
+
+    program_t* prog = NULL;
+    if (current) {
+        reader_t r = {(const unsigned char*)map + sizeof(header),
+                      (const unsigned char*)map + map_len};
+        prog = load_program(&r, 0);
+        if (prog != NULL && r.p == r.end) {
+            timing->source = RC_SNAPSHOT;
+            timing->snapshot = map_len;
+        } else {
+            release_program(prog);
+            prog = NULL;
+        }
+    }
+    if (map != NULL) {
+        munmap(map, map_len);
+    }
+
+    // No usable snapshot: compile the text and save the result
+    if (prog == NULL) {
+        if (text == NULL && (text = read_rc(rc_path, &st)) != NULL) {
+            hash = fnv1a(text, st.st_size);
+            timing->size = st.st_size;
+        }
+        parse_status_t parsed = text ? parse_script(text, &prog) : PARSE_ERROR;
+        if (parsed != PARSE_OK) {
+            if (text != NULL) {
+                fprintf(stderr, "%s: %s\n", rc_path, parsed == PARSE_INCOMPLETE ?
+                        "Unexpected end of command" : "Invalid Syntax!");
+            }
+            free(text);
+            timing->source = RC_FAILED;
+            timing->load = monotonic_seconds() - checked;
+            return;
+        }
+        timing->source = RC_COMPILED;
+        timing->snapshot = save_snapshot(snapshot_path, prog, &st, hash);
+    }
+    free(text);
+    double loaded = monotonic_seconds();
+    timing->load = loaded - checked;
+
+    vm_run(prog);
+    release_program(prog);
+    timing->run = monotonic_seconds() - loaded;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,443 @@
+#define _GNU_SOURCE
+#include "record.h"
+#include "expand.h"
+#include "input.h"
+#include "timers.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+// ############## LLM Generated Code Begins ##############
+
+// File layout: the magic, then one entry per command:
+//   varint  start, microseconds since the session began
+//   varint  duration in microseconds
+//   varint  exit status
+//   8 bytes FNV-1a hash of stdout and stderr, 0 when not captured
+//   varint  cwd length, then cwd; length 0 repeats the previous cwd
+//   varint  command length, then the command as typed
+#define RECORD_MAGIC "SHREC01\n"
+#define RECORD_MAGIC_LEN 8
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+// Width of the command column in the replay report
+#define REPORT_TEXT_WIDTH 40
+
+typedef struct {
+    double start;
+    double duration;
+    int status;
+    uint64_t hash;
+    char* cwd;
+    char* text;
+    // Filled in by the replay
+    double replay_duration;
+    int replay_status;
+    uint64_t replay_hash;
+    bool replay_text_differs;
+    bool replayed;
+} record_entry_t;
+
+// Recording
+static int record_fd = -1;
+static double record_started = 0;
+static char* last_cwd = NULL;
+
+// Replay
+static record_entry_t* entries = NULL;
+static int entry_count = 0;
+static int next_entry = 0;
+static bool replay_active = false;
+static bool replay_paced = false;
+static bool replay_quiet = false;
+static double replay_started = 0;
+
+// Output capture: the memfd standing in for stdout and stderr, the real
+// ones, and how much of the memfd was consumed
+static int capture_fd = -1;
+static int saved_stdout = -1;
+static int saved_stderr = -1;
+static off_t captured = 0;
+static uint64_t output_hash = 0;
+
+// The command being timed
+static double command_started = 0;
+static char command_cwd[PATH_MAX];
+
+static void put_varint(capture_buf_t* buf, uint64_t value) {
+    char bytes[10];
+    size_t n = 0;
+    while (value >= 0x80) {
+        bytes[n++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+    bytes[n++] = (char)value;
+    capture_append(buf, bytes, n);
+}
+
+static bool get_varint(const unsigned char** p, const unsigned char* end, uint64_t* value) {
+    *value = 0;
+    for (int shift = 0; *p < end && shift < 64; shift += 7) {
+        unsigned char byte = *(*p)++;
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint64_t fnv1a(uint64_t hash, const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Point stdout and stderr at a memfd; children inherit it
+static bool start_capture() {
+    if (capture_fd != -1) {
+        return true;
+    }
+    capture_fd = memfd_create("session-output", MFD_CLOEXEC);
+    if (capture_fd == -1) {
+        perror("memfd_create failed");
+        return false;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    saved_stdout = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    saved_stderr = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+    // Appending keeps the shell's and its children's writes apart
+    int flags = fcntl(capture_fd, F_GETFL);
+    fcntl(capture_fd, F_SETFL, flags | O_APPEND);
+    dup2(capture_fd, STDOUT_FILENO);
+    dup2(capture_fd, STDERR_FILENO);
+    return true;
+}
+
+// Hash what was written since the last call, if hash is not NULL, and
+// pass it on to the real stdout unless the replay is quiet. A background
+// job's late output lands in whichever command runs next.
+static void drain_capture(uint64_t* hash) {
+    if (capture_fd == -1) {
+        return;
+    }
+    fflush(stdout);
+    fflush(stderr);
+    struct stat st;
+    if (fstat(capture_fd, &st) == -1) {
+        return;
+    }
+    char buf[65536];
+    while (captured < st.st_size) {
+        size_t want = st.st_size - captured < (off_t)sizeof(buf) ? (size_t)(st.st_size - captured) : sizeof(buf);
+        ssize_t n = pread(capture_fd, buf, want, captured);
+        if (n <= 0) {
+            break;
+        }
+        if (hash != NULL) {
+            *hash = fnv1a(*hash, buf, n);
+        }
+        // If the real stdout is gone the output is still hashed
+        for (ssize_t done = 0, w; !(replay_active && replay_quiet) && done < n; done += w) {
+            if ((w = write(saved_stdout, buf + done, n - done)) <= 0) {
+                break;
+            }
+        }
+        captured += n;
+    }
+    // Start over rather than let the memfd grow with the session, unless
+    // a background job wrote more meanwhile
+    if (fstat(capture_fd, &st) == 0 && st.st_size == captured && ftruncate(capture_fd, 0) == 0) {
+        captured = 0;
+    }
+}
+
+static void stop_capture() {
+    if (capture_fd == -1) {
+        return;
+    }
+    drain_capture(NULL);
+    dup2(saved_stdout, STDOUT_FILENO);
+    dup2(saved_stderr, STDERR_FILENO);
+    close(saved_stdout);
+    close(saved_stderr);
+    close(capture_fd);
+    capture_fd = saved_stdout = saved_stderr = -1;
+}
+
+bool start_recording(const char* path) {
+    record_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (record_fd == -1) {
+        fprintf(stderr, "record: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    if (write(record_fd, RECORD_MAGIC, RECORD_MAGIC_LEN) != RECORD_MAGIC_LEN) {
+        fprintf(stderr, "record: %s: %s\n", path, strerror(errno));
+        close(record_fd);
+        record_fd = -1;
+        return false;
+    }
+    record_started = monotonic_seconds();
+    // A terminal keeps the output: programs behave differently without one
+    if (!isatty(STDOUT_FILENO)) {
+        start_capture();
+    }
+    return true;
+}
+
+static void write_entry(const char* text, double start, double duration, int status, uint64_t hash) {
+    capture_buf_t buf = {NULL, 0, 0};
+    put_varint(&buf, (uint64_t)(start * 1e6));
+    put_varint(&buf, (uint64_t)(duration * 1e6));
+    put_varint(&buf, (uint64_t)(unsigned)status);
+    capture_append(&buf, (const char*)&hash, sizeof(hash));
+    if (last_cwd != NULL && strcmp(last_cwd, command_cwd) == 0) {
+        put_varint(&buf, 0);
+    } else {
+        free(last_cwd);
+        last_cwd = strdup(command_cwd);
+        put_varint(&buf, strlen(command_cwd));
+        capture_append(&buf, command_cwd, strlen(command_cwd));
+    }
+    put_varint(&buf, strlen(text));
+    capture_append(&buf, text, strlen(text));
+
+    // One write per entry, so a crash loses at most the command running
+    if (buf.data == NULL || write(record_fd, buf.data, buf.len) != (ssize_t)buf.len) {
+        perror("record: write failed");
+        close(record_fd);
+        record_fd = -1;
+    }
+    free(buf.data);
+}
+
+static bool parse_recording(const unsigned char* p, const unsigned char* end) {
+    const char* cwd = "";
+    size_t cwd_len = 0;
+    int cap = 0;
+    while (p < end) {
+        uint64_t start, duration, status, len;
+        uint64_t hash;
+        if (!get_varint(&p, end, &start) || !get_varint(&p, end, &duration) ||
+            !get_varint(&p, end, &status) || end - p < (ptrdiff_t)sizeof(hash)) {
+            return false;
+        }
+        memcpy(&hash, p, sizeof(hash));
+        p += sizeof(hash);
+        if (!get_varint(&p, end, &len) || (uint64_t)(end - p) < len) {
+            return false;
+        }
+        if (len > 0) {
+            cwd = (const char*)p;
+            cwd_len = len;
+            p += len;
+        }
+        if (!get_varint(&p, end, &len) || (uint64_t)(end - p) < len) {
+            return false;
+        }
+
+        if (entry_count == cap) {
+            cap = cap ? cap * 2 : 64;
+            record_entry_t* grown = realloc(entries, cap * sizeof(record_entry_t));
+            if (grown == NULL) {
+                return false;
+            }
+            entries = grown;
+        }
+        record_entry_t* entry = &entries[entry_count++];
+        memset(entry, 0, sizeof(*entry));
+        entry->start = start / 1e6;
+        entry->duration = duration / 1e6;
+        entry->status = (int)status;
+        entry->hash = hash;
+        entry->cwd = strndup(cwd, cwd_len);
+        entry->text = strndup((const char*)p, len);
+        p += len;
+    }
+    return true;
+}
+
+bool start_replay(const char* path, bool paced, bool quiet) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        fprintf(stderr, "replay: %s: %s\n", path, strerror(errno));
+        if (fd != -1) close(fd);
+        return false;
+    }
+    void* map = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED || st.st_size < RECORD_MAGIC_LEN ||
+        memcmp(map, RECORD_MAGIC, RECORD_MAGIC_LEN) != 0) {
+        fprintf(stderr, "replay: %s: not a session recording\n", path);
+        if (map != MAP_FAILED) munmap(map, st.st_size);
+        return false;
+    }
+    const unsigned char* data = map;
+    bool ok = parse_recording(data + RECORD_MAGIC_LEN, data + st.st_size);
+    munmap(map, st.st_size);
+    if (!ok) {
+        fprintf(stderr, "replay: %s: truncated after %d commands\n", path, entry_count);
+    }
+
+    // Every command becomes input, exactly as it was typed
+    capture_buf_t input = {NULL, 0, 0};
+    for (int i = 0; i < entry_count; i++) {
+        capture_append(&input, entries[i].text, strlen(entries[i].text));
+        capture_append(&input, "\n", 1);
+    }
+    if (input.data != NULL) {
+        input.data[input.len] = '\0';
+    }
+    ok = input_from_string(input.data != NULL ? input.data : "");
+    free(input.data);
+    if (!ok) {
+        return false;
+    }
+
+    replay_active = true;
+    replay_paced = paced;
+    replay_quiet = quiet;
+    return start_capture();
+}
+
+bool replaying() {
+    return replay_active;
+}
+
+// Sleep until the recorded gap before entry has passed
+static void pace(const record_entry_t* entry) {
+    double target = replay_started + entry->start - entries[0].start;
+    double left;
+    while ((left = target - monotonic_seconds()) > 0) {
+        struct timespec ts = {(time_t)left, (long)((left - (time_t)left) * 1e9)};
+        nanosleep(&ts, NULL);
+    }
+}
+
+void record_begin() {
+    if (record_fd == -1 && !replay_active) {
+        return;
+    }
+    // Output since the last command, the prompt say, is not the next one's
+    drain_capture(NULL);
+    if (replay_active && next_entry < entry_count) {
+        if (replay_started == 0) {
+            replay_started = monotonic_seconds();
+        }
+        if (replay_paced) {
+            pace(&entries[next_entry]);
+        }
+        // Run where it ran before, so relative paths mean the same thing
+        const char* cwd = entries[next_entry].cwd;
+        if (cwd[0] != '\0' && chdir(cwd) == -1) {
+            fprintf(stderr, "replay: %s: %s\n", cwd, strerror(errno));
+        }
+    }
+    if (getcwd(command_cwd, sizeof(command_cwd)) == NULL) {
+        command_cwd[0] = '\0';
+    }
+    output_hash = FNV_OFFSET;
+    command_started = monotonic_seconds();
+}
+
+void record_end(const char* text, int status) {
+    if (record_fd == -1 && !replay_active) {
+        return;
+    }
+    double duration = monotonic_seconds() - command_started;
+    drain_capture(&output_hash);
+    uint64_t hash = capture_fd != -1 ? output_hash : 0;
+
+    if (record_fd != -1) {
+        write_entry(text, command_started - record_started, duration, status, hash);
+    }
+    if (replay_active && next_entry < entry_count) {
+        record_entry_t* entry = &entries[next_entry++];
+        entry->replayed = true;
+        entry->replay_duration = duration;
+        entry->replay_status = status;
+        entry->replay_hash = hash;
+        entry->replay_text_differs = strcmp(entry->text, text) != 0;
+    }
+}
+
+int finish_replay() {
+    stop_capture();
+    replay_active = false;
+
+    double recorded = 0, replayed = 0;
+    int outputs = 0, statuses = 0, texts = 0, missing = 0;
+    printf("%4s %10s %10s %8s %-6s %-7s %s\n", "#", "recorded", "replayed", "diff",
+           "status", "output", "command");
+    for (int i = 0; i < entry_count; i++) {
+        record_entry_t* entry = &entries[i];
+        // Only the first line of a multi-line command fits the table
+        int width = (int)strcspn(entry->text, "\n");
+        if (width > REPORT_TEXT_WIDTH) width = REPORT_TEXT_WIDTH;
+        if (!entry->replayed) {
+            missing++;
+            printf("%4d %10s %10s %8s %-6s %-7s %.*s\n", i + 1, "", "", "", "",
+                   "skipped", width, entry->text);
+            continue;
+        }
+
+        char before[32], after[32], status[16];
+        format_duration(entry->duration, before, sizeof(before));
+        format_duration(entry->replay_duration, after, sizeof(after));
+        recorded += entry->duration;
+        replayed += entry->replay_duration;
+        double diff = entry->duration > 0 ? (entry->replay_duration / entry->duration - 1) * 100 : 0;
+
+        bool status_differs = entry->status != entry->replay_status;
+        statuses += status_differs;
+        if (status_differs) {
+            snprintf(status, sizeof(status), "%d>%d", entry->status, entry->replay_status);
+        } else {
+            snprintf(status, sizeof(status), "%d", entry->status);
+        }
+        // A recording made on a terminal has no hashes to compare with
+        const char* output = "-";
+        if (entry->replay_text_differs) {
+            output = "command";
+            texts++;
+        } else if (entry->hash != 0) {
+            output = entry->hash == entry->replay_hash ? "same" : "differs";
+            outputs += entry->hash != entry->replay_hash;
+        }
+        printf("%4d %10s %10s %+7.1f%% %-6s %-7s %.*s\n", i + 1, before, after, diff,
+               status, output, width, entry->text);
+    }
+
+    char before[32], after[32];
+    format_duration(recorded, before, sizeof(before));
+    format_duration(replayed, after, sizeof(after));
+    printf("%d commands: recorded %s, replayed %s (%+.1f%%)", entry_count - missing,
+           before, after, recorded > 0 ? (replayed / recorded - 1) * 100 : 0);
+    printf("; %d outputs, %d statuses and %d commands differ", outputs, statuses, texts);
+    if (missing > 0) {
+        printf("; %d not replayed", missing);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    for (int i = 0; i < entry_count; i++) {
+        free(entries[i].cwd);
+        free(entries[i].text);
+    }
+    free(entries);
+    entries = NULL;
+    entry_count = 0;
+    return outputs + statuses + texts + missing > 0 ? 1 : 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
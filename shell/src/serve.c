@@ -0,0 +1,529 @@
+#define _GNU_SOURCE
+#include "serve.h"
+#include "eventlog.h"
+#include "executor.h"
+#include "expand.h"
+#include "jobs.h"
+#include "timers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+// ############## LLM Generated Code Begins ##############
+
+#define SERVE_MAX_CLIENTS 128
+// A request's output is no longer read while this much waits for a client
+#define SERVE_OUTPUT_LIMIT (1 << 20)
+// How often output held back by a slow client is sent again, in seconds
+#define SERVE_RETRY_INTERVAL 0.01
+
+typedef struct {
+    int fd;               // Connection, or -1 for a free slot
+    capture_buf_t in;     // Received bytes not yet taken as frames
+    capture_buf_t out;    // Frames not yet sent
+    size_t sent;          // Bytes of out already sent
+    char* cwd;
+    bool hung_up;         // The peer closed; drop it once its request ends
+    // The running request, if pid is not 0
+    pid_t pid;
+    int out_fd;
+    int err_fd;
+    int ctl_fd;           // Carries the request's final directory
+    bool paused;          // Output pipes unwatched while out is full
+} client_t;
+
+static client_t clients[SERVE_MAX_CLIENTS];
+static int listen_fd = -1;
+static int signal_fd = -1;
+static serve_run_fn run_request;
+static sigset_t saved_mask;
+
+static void process_frames(client_t* c);
+
+static void put_frame(client_t* c, char type, const char* data, size_t len) {
+    unsigned char header[SERVE_HEADER_SIZE] = {(unsigned char)type, (unsigned char)(len >> 24),
+                                               (unsigned char)(len >> 16), (unsigned char)(len >> 8),
+                                               (unsigned char)len};
+    if (!capture_append(&c->out, (const char*)header, sizeof(header)) ||
+        !capture_append(&c->out, data, len)) {
+        c->hung_up = true;
+    }
+}
+
+static size_t pending_output(const client_t* c) {
+    return c->out.len - c->sent;
+}
+
+static void output_ready(int fd, int index);
+
+// Stop reading a request's output while its client lags, and go on once
+// it caught up
+static void pace_output(client_t* c) {
+    bool full = pending_output(c) > SERVE_OUTPUT_LIMIT;
+    if (full == c->paused) {
+        return;
+    }
+    c->paused = full;
+    int fds[2] = {c->out_fd, c->err_fd};
+    for (int i = 0; i < 2; i++) {
+        if (fds[i] == -1) {
+            continue;
+        }
+        if (full) {
+            unwatch_fd(fds[i]);
+        } else {
+            watch_fd(fds[i], output_ready, (int)(c - clients));
+        }
+    }
+}
+
+static void flush_client(client_t* c) {
+    while (pending_output(c) > 0 && !c->hung_up) {
+        ssize_t n = send(c->fd, c->out.data + c->sent, pending_output(c), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            c->sent += n;
+        } else if (n == -1 && errno == EINTR) {
+            continue;
+        } else {
+            // A full socket is retried later; anything else means it is gone
+            if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                c->hung_up = true;
+            }
+            break;
+        }
+    }
+    if (c->hung_up || pending_output(c) == 0) {
+        c->out.len = 0;
+        c->sent = 0;
+    }
+    pace_output(c);
+}
+
+static void close_pipe(int* fd) {
+    if (*fd != -1) {
+        unwatch_fd(*fd);
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static void drop_client(client_t* c) {
+    unwatch_fd(c->fd);
+    close(c->fd);
+    c->fd = -1;
+    free(c->in.data);
+    free(c->out.data);
+    free(c->cwd);
+    memset(&c->in, 0, sizeof(c->in));
+    memset(&c->out, 0, sizeof(c->out));
+    c->cwd = NULL;
+}
+
+// Forward what a request wrote; EOF closes that pipe. Returns whether
+// there may be more to read right away.
+static bool forward_output(client_t* c, int* fd) {
+    char buf[65536];
+    ssize_t n = read(*fd, buf, sizeof(buf));
+    if (n > 0) {
+        put_frame(c, *fd == c->out_fd ? SERVE_STDOUT : SERVE_STDERR, buf, n);
+        return true;
+    }
+    if (n == -1 && errno == EINTR) {
+        return true;
+    }
+    if (n == 0 || errno != EAGAIN) {
+        close_pipe(fd);
+    }
+    return false;
+}
+
+// Send sig to every process of a request. The request shell leads its
+// own session and puts its jobs in groups of their own, so each group
+// found in the session is signalled, not just the shell's.
+static void signal_request(pid_t sid, int sig) {
+    kill(sid, sig);
+    DIR* proc = opendir("/proc");
+    if (proc == NULL) {
+        kill(-sid, sig);
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(proc)) != NULL) {
+        pid_t pid = (pid_t)atoi(entry->d_name);
+        pid_t pgid;
+        if (pid > 0 && getsid(pid) == sid && (pgid = getpgid(pid)) > 0) {
+            kill(-pgid, sig);
+        }
+    }
+    closedir(proc);
+}
+
+static void output_ready(int fd, int index) {
+    client_t* c = &clients[index];
+    forward_output(c, fd == c->out_fd ? &c->out_fd : &c->err_fd);
+    flush_client(c);
+}
+
+// The request exited: send the rest of its output and its status, then
+// start the next request the client queued
+static void finish_request(client_t* c, int status) {
+    // Everything it wrote before exiting is in the pipes; output of jobs
+    // it left running in the background is cut off here
+    while (c->out_fd != -1 && forward_output(c, &c->out_fd)) {}
+    while (c->err_fd != -1 && forward_output(c, &c->err_fd)) {}
+    close_pipe(&c->out_fd);
+    close_pipe(&c->err_fd);
+
+    char cwd[PATH_MAX];
+    ssize_t n = read(c->ctl_fd, cwd, sizeof(cwd) - 1);
+    if (n > 0) {
+        cwd[n] = '\0';
+        free(c->cwd);
+        c->cwd = strdup(cwd);
+    }
+    close_pipe(&c->ctl_fd);
+    c->pid = 0;
+    c->paused = false;
+
+    unsigned char code[4] = {(unsigned char)(status >> 24), (unsigned char)(status >> 16),
+                             (unsigned char)(status >> 8), (unsigned char)status};
+    put_frame(c, SERVE_EXIT, (const char*)code, sizeof(code));
+    flush_client(c);
+    if (c->hung_up) {
+        drop_client(c);
+        return;
+    }
+    process_frames(c);
+}
+
+// Reap finished requests; the SIGCHLD handler is blocked while serving
+static void reap_requests() {
+    int status;
+    struct rusage usage;
+    pid_t pid;
+    while ((pid = wait4(-1, &status, WNOHANG, &usage)) > 0) {
+        job_t* job = find_job_by_pid(pid);
+        if (job != NULL) {
+            log_job_exit(job, status, &usage);
+            remove_job(job);
+        }
+        for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+            if (clients[i].fd != -1 && clients[i].pid == pid) {
+                int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                finish_request(&clients[i], code);
+                break;
+            }
+        }
+    }
+}
+
+// In the forked shell: run the request with the pipes as stdout and stderr
+__attribute__((noreturn))
+static void run_child(client_t* c, const char* text, int out_w, int err_w, int ctl_w) {
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+    // A session of its own lets the server find every job it starts
+    setsid();
+
+    // Nothing of the server stays open in the request
+    close(listen_fd);
+    close(signal_fd);
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+        if (clients[i].fd == -1) {
+            continue;
+        }
+        close(clients[i].fd);
+        if (clients[i].pid != 0) {
+            close(clients[i].out_fd);
+            close(clients[i].err_fd);
+            close(clients[i].ctl_fd);
+        }
+    }
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd != -1) {
+        dup2(null_fd, STDIN_FILENO);
+        close(null_fd);
+    }
+    dup2(out_w, STDOUT_FILENO);
+    dup2(err_w, STDERR_FILENO);
+
+    if (chdir(c->cwd) == -1) {
+        fprintf(stderr, "%s: %s\n", c->cwd, strerror(errno));
+        child_exit(1);
+    }
+    int status = run_request(text);
+
+    // Tell the server where the request left off
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) != NULL && write(ctl_w, cwd, strlen(cwd)) < 0) {
+        perror("write failed");
+    }
+    child_exit(status);
+}
+
+static void start_request(client_t* c, const char* text) {
+    int out_pipe[2], err_pipe[2], ctl_pipe[2];
+    if (pipe2(out_pipe, O_CLOEXEC) == -1) {
+        perror("pipe failed");
+        return;
+    }
+    if (pipe2(err_pipe, O_CLOEXEC) == -1) {
+        perror("pipe failed");
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return;
+    }
+    if (pipe2(ctl_pipe, O_CLOEXEC) == -1) {
+        perror("pipe failed");
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        close(err_pipe[0]);
+        close(err_pipe[1]);
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        close(ctl_pipe[0]);
+        run_child(c, text, out_pipe[1], err_pipe[1], ctl_pipe[1]);
+    }
+    close(out_pipe[1]);
+    close(err_pipe[1]);
+    close(ctl_pipe[1]);
+    if (pid == -1) {
+        perror("fork failed");
+        close(out_pipe[0]);
+        close(err_pipe[0]);
+        close(ctl_pipe[0]);
+        put_frame(c, SERVE_EXIT, "\0\0\0\1", 4);
+        return;
+    }
+
+    int job_id = add_job(pid, text, false);
+    job_t* job = find_job_by_id(job_id);
+    if (job != NULL) {
+        // The child may not have made its session yet
+        job->pgid = pid;
+        log_job_event("spawn", job);
+    }
+    c->pid = pid;
+    c->out_fd = out_pipe[0];
+    c->err_fd = err_pipe[0];
+    c->ctl_fd = ctl_pipe[0];
+    c->paused = false;
+    fcntl(c->out_fd, F_SETFL, O_NONBLOCK);
+    fcntl(c->err_fd, F_SETFL, O_NONBLOCK);
+    fcntl(c->ctl_fd, F_SETFL, O_NONBLOCK);
+    int index = (int)(c - clients);
+    watch_fd(c->out_fd, output_ready, index);
+    watch_fd(c->err_fd, output_ready, index);
+}
+
+// Act on the complete frames received, one request at a time
+static void process_frames(client_t* c) {
+    size_t used = 0;
+    while (c->pid == 0 && !c->hung_up && c->in.len - used >= SERVE_HEADER_SIZE) {
+        const unsigned char* p = (const unsigned char*)c->in.data + used;
+        uint32_t len = (uint32_t)p[1] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 8 | p[4];
+        if (len > SERVE_MAX_PAYLOAD || (p[0] != SERVE_CWD && p[0] != SERVE_RUN)) {
+            c->hung_up = true;
+            break;
+        }
+        if (c->in.len - used < SERVE_HEADER_SIZE + len) {
+            break;
+        }
+        char* payload = strndup((const char*)p + SERVE_HEADER_SIZE, len);
+        used += SERVE_HEADER_SIZE + len;
+        if (payload == NULL) {
+            c->hung_up = true;
+            break;
+        }
+        if (p[0] == SERVE_CWD) {
+            free(c->cwd);
+            c->cwd = payload;
+            continue;
+        }
+        start_request(c, payload);
+        free(payload);
+    }
+    if (used > 0) {
+        memmove(c->in.data, c->in.data + used, c->in.len - used);
+        c->in.len -= used;
+    }
+    flush_client(c);
+    if (c->hung_up && c->pid == 0) {
+        drop_client(c);
+    }
+}
+
+static void client_ready(int fd, int index) {
+    client_t* c = &clients[index];
+    if (!capture_reserve(&c->in, 65536)) {
+        c->hung_up = true;
+    } else {
+        ssize_t n = recv(fd, c->in.data + c->in.len, 65536, MSG_DONTWAIT);
+        if (n > 0) {
+            c->in.len += n;
+        } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            c->hung_up = true;
+        }
+    }
+    if (c->hung_up) {
+        // Nobody is left to read the request's output
+        unwatch_fd(fd);
+        if (c->pid != 0) {
+            signal_request(c->pid, SIGTERM);
+            return;
+        }
+    }
+    process_frames(c);
+}
+
+static void accept_ready(int fd, int arg) {
+    int conn;
+    while ((conn = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        client_t* c = NULL;
+        for (int i = 0; i < SERVE_MAX_CLIENTS && c == NULL; i++) {
+            if (clients[i].fd == -1) {
+                c = &clients[i];
+            }
+        }
+        char cwd[PATH_MAX];
+        if (c == NULL || getcwd(cwd, sizeof(cwd)) == NULL) {
+            close(conn);
+            continue;
+        }
+        memset(c, 0, sizeof(*c));
+        c->fd = conn;
+        c->out_fd = c->err_fd = c->ctl_fd = -1;
+        // Requests start where the server does until the client says
+        c->cwd = strdup(cwd);
+        watch_fd(conn, client_ready, (int)(c - clients));
+    }
+}
+
+// Bind path, replacing a socket file no server answers on any more
+static int open_listener(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "serve: socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        perror("serve: socket failed");
+        return -1;
+    }
+    // Only the user running the server may connect
+    mode_t old_umask = umask(077);
+    int bound = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    if (bound == -1 && errno == EADDRINUSE) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe != -1 && connect(probe, (struct sockaddr*)&addr, sizeof(addr)) == -1 &&
+            errno == ECONNREFUSED) {
+            unlink(path);
+            bound = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+        } else {
+            errno = EADDRINUSE;
+        }
+        if (probe != -1) close(probe);
+    }
+    umask(old_umask);
+    if (bound == -1 || listen(fd, SOMAXCONN) == -1) {
+        fprintf(stderr, "serve: %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int serve(const char* path, serve_run_fn run) {
+    run_request = run;
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+    listen_fd = open_listener(path);
+    if (listen_fd == -1) {
+        return 1;
+    }
+
+    // Requests are reaped here rather than by the SIGCHLD handler, and a
+    // signal to stop ends the loop instead of the process
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTERM);
+    sigprocmask(SIG_BLOCK, &mask, &saved_mask);
+    signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        perror("serve: signalfd failed");
+        sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+        close(listen_fd);
+        unlink(path);
+        return 1;
+    }
+    watch_fd(listen_fd, accept_ready, 0);
+
+    bool stopping = false;
+    while (!stopping) {
+        bool lagging = false;
+        for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+            lagging |= clients[i].fd != -1 && pending_output(&clients[i]) > 0;
+        }
+        double deadline = lagging ? monotonic_seconds() + SERVE_RETRY_INTERVAL : 0;
+        if (wait_readable_until(signal_fd, deadline)) {
+            struct signalfd_siginfo info;
+            bool exited = false;
+            while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+                stopping |= info.ssi_signo != SIGCHLD;
+                exited |= info.ssi_signo == SIGCHLD;
+            }
+            if (exited) {
+                reap_requests();
+            }
+        }
+        for (int i = 0; i < SERVE_MAX_CLIENTS && lagging; i++) {
+            if (clients[i].fd != -1 && pending_output(&clients[i]) > 0) {
+                flush_client(&clients[i]);
+            }
+        }
+    }
+
+    for (int i = 0; i < SERVE_MAX_CLIENTS; i++) {
+        if (clients[i].fd == -1) {
+            continue;
+        }
+        if (clients[i].pid != 0) {
+            signal_request(clients[i].pid, SIGTERM);
+            waitpid(clients[i].pid, NULL, 0);
+            close_pipe(&clients[i].out_fd);
+            close_pipe(&clients[i].err_fd);
+            close_pipe(&clients[i].ctl_fd);
+        }
+        drop_client(&clients[i]);
+    }
+    unwatch_fd(listen_fd);
+    close(listen_fd);
+    close(signal_fd);
+    unlink(path);
+    sigprocmask(SIG_SETMASK, &saved_mask, NULL);
+    return 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
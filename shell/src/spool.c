@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+#include "spool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+// ############## LLM Generated Code Begins ##############
+
+// Largest pipe buffer asked for; the kernel caps it for unprivileged users
+#define SPOOL_PIPE_MAX (1 << 20)
+
+spool_t* spool_create(size_t size) {
+    spool_t* spool = calloc(1, sizeof(spool_t));
+    if (spool == NULL) {
+        perror("calloc failed");
+        return NULL;
+    }
+    spool->read_fd = -1;
+    spool->write_fd = -1;
+    spool->ring = MAP_FAILED;
+    spool->size = size;
+
+    int fds[2];
+    spool->memfd = memfd_create("job-spool", MFD_CLOEXEC);
+    if (spool->memfd == -1) {
+        perror("memfd_create failed");
+    } else if (ftruncate(spool->memfd, size) == -1) {
+        perror("ftruncate failed");
+    } else if ((spool->ring = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                   spool->memfd, 0)) == MAP_FAILED) {
+        perror("mmap failed");
+    } else if (pipe2(fds, O_CLOEXEC) == -1) {
+        perror("pipe failed");
+    } else {
+        spool->read_fd = fds[0];
+        spool->write_fd = fds[1];
+        fcntl(spool->read_fd, F_SETFL, O_NONBLOCK);
+        // A bigger pipe means fewer wakeups; failing this is harmless
+        fcntl(spool->read_fd, F_SETPIPE_SZ, size < SPOOL_PIPE_MAX ? (int)size : SPOOL_PIPE_MAX);
+        return spool;
+    }
+    spool_free(spool);
+    return NULL;
+}
+
+void spool_close_writer(spool_t* spool) {
+    if (spool->write_fd != -1) {
+        close(spool->write_fd);
+        spool->write_fd = -1;
+    }
+}
+
+// Write len bytes of the ring starting at stream offset from
+static void write_range(const spool_t* spool, unsigned long long from, size_t len) {
+    while (len > 0) {
+        size_t pos = from % spool->size;
+        size_t chunk = spool->size - pos < len ? spool->size - pos : len;
+        ssize_t n = write(STDOUT_FILENO, spool->ring + pos, chunk);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        from += n;
+        len -= n;
+    }
+}
+
+bool spool_drain(spool_t* spool, bool passthrough) {
+    if (spool->read_fd == -1) {
+        return false;
+    }
+    while (1) {
+        // Read straight into the ring, wrapping around in one call
+        size_t pos = spool->total % spool->size;
+        struct iovec iov[2] = {
+            {spool->ring + pos, spool->size - pos},
+            {spool->ring, pos}
+        };
+        ssize_t n = readv(spool->read_fd, iov, pos > 0 ? 2 : 1);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n == -1 && errno == EAGAIN) {
+            return true;
+        }
+        if (n <= 0) {
+            close(spool->read_fd);
+            spool->read_fd = -1;
+            return false;
+        }
+        spool->total += n;
+        if (passthrough) {
+            write_range(spool, spool->total - n, n);
+            spool->shown = spool->total;
+        }
+    }
+}
+
+void spool_replay(spool_t* spool) {
+    unsigned long long from = spool->shown;
+    unsigned long long dropped = spool_dropped(spool);
+    if (dropped > from) {
+        printf("[%llu bytes dropped]\n", dropped - from);
+        from = dropped;
+    }
+    fflush(stdout);
+    write_range(spool, from, spool->total - from);
+    spool->shown = spool->total;
+}
+
+void spool_tail(const spool_t* spool, int lines) {
+    unsigned long long first = spool_dropped(spool);
+    unsigned long long from = spool->total;
+    // A final newline ends the last line rather than starting another
+    if (from > first && spool->ring[(from - 1) % spool->size] == '\n') {
+        from--;
+    }
+    while (from > first) {
+        if (spool->ring[(from - 1) % spool->size] == '\n' && --lines == 0) {
+            break;
+        }
+        from--;
+    }
+    fflush(stdout);
+    write_range(spool, from, spool->total - from);
+}
+
+size_t spool_buffered(const spool_t* spool) {
+    return (size_t)(spool->total - spool_dropped(spool));
+}
+
+unsigned long long spool_dropped(const spool_t* spool) {
+    return spool->total > spool->size ? spool->total - spool->size : 0;
+}
+
+size_t spool_unshown(const spool_t* spool) {
+    size_t buffered = spool_buffered(spool);
+    unsigned long long unshown = spool->total - spool->shown;
+    return unshown < buffered ? (size_t)unshown : buffered;
+}
+
+void spool_free(spool_t* spool) {
+    if (spool == NULL) {
+        return;
+    }
+    if (spool->read_fd != -1) close(spool->read_fd);
+    spool_close_writer(spool);
+    if (spool->ring != MAP_FAILED) munmap(spool->ring, spool->size);
+    if (spool->memfd != -1) close(spool->memfd);
+    free(spool);
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
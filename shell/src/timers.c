@@ -0,0 +1,339 @@
+#define _GNU_SOURCE
+#include "timers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+// ############## LLM Generated Code Begins ##############
+
+typedef struct {
+    double when;
+    timer_fn fn;
+    int arg;
+} timer_entry_t;
+
+// Binary min-heap on when; the timerfd is armed for the root
+static timer_entry_t* heap = NULL;
+static int heap_count = 0;
+static int heap_cap = 0;
+static int timer_fd = -1;
+static int sigchld_fd = -1;
+static pid_t owner = 0;
+
+typedef struct {
+    int fd;
+    watch_fn fn;
+    int arg;
+} watch_entry_t;
+
+// Watched fds, and the poll set built from them: the fd waited for, the
+// timerfd, then one entry per watch
+static watch_entry_t* watches = NULL;
+static int watch_count = 0;
+static int watch_cap = 0;
+static struct pollfd* poll_set = NULL;
+static int poll_cap = 0;
+static double last_watch_poll = 0;
+
+// Poll watches between commands at most this often, in seconds
+#define WATCH_POLL_INTERVAL 0.01
+
+double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A forked child must not fire, or re-arm, the timers of the shell
+static void check_owner() {
+    pid_t self = getpid();
+    if (owner == self) {
+        return;
+    }
+    if (timer_fd != -1) close(timer_fd);
+    if (sigchld_fd != -1) close(sigchld_fd);
+    timer_fd = -1;
+    sigchld_fd = -1;
+    heap_count = 0;
+    watch_count = 0;
+    owner = self;
+}
+
+static void swap_entries(int a, int b) {
+    timer_entry_t tmp = heap[a];
+    heap[a] = heap[b];
+    heap[b] = tmp;
+}
+
+static void sift_down(int i) {
+    while (1) {
+        int smallest = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if (left < heap_count && heap[left].when < heap[smallest].when) smallest = left;
+        if (right < heap_count && heap[right].when < heap[smallest].when) smallest = right;
+        if (smallest == i) {
+            return;
+        }
+        swap_entries(i, smallest);
+        i = smallest;
+    }
+}
+
+// Point the timerfd at the earliest timer, or disarm it
+static void arm_timerfd() {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (heap_count > 0) {
+        double when = heap[0].when;
+        spec.it_value.tv_sec = (time_t)when;
+        spec.it_value.tv_nsec = (long)((when - (time_t)when) * 1e9);
+        // A zero it_value would disarm the timer instead
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) spec.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+        perror("timerfd_settime failed");
+    }
+}
+
+bool add_timer(double seconds, timer_fn fn, int arg) {
+    check_owner();
+    if (timer_fd == -1 &&
+        (timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1) {
+        perror("timerfd_create failed");
+        return false;
+    }
+    if (heap_count == heap_cap) {
+        int cap = heap_cap ? heap_cap * 2 : 16;
+        timer_entry_t* grown = realloc(heap, cap * sizeof(timer_entry_t));
+        if (grown == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        heap = grown;
+        heap_cap = cap;
+    }
+
+    int i = heap_count++;
+    heap[i].when = monotonic_seconds() + seconds;
+    heap[i].fn = fn;
+    heap[i].arg = arg;
+    while (i > 0 && heap[(i - 1) / 2].when > heap[i].when) {
+        swap_entries(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+    if (i == 0) {
+        arm_timerfd();
+    }
+    return true;
+}
+
+bool timers_pending() {
+    return heap_count > 0;
+}
+
+void run_due_timers() {
+    check_owner();
+    if (heap_count == 0) {
+        return;
+    }
+    double now = monotonic_seconds();
+    if (heap[0].when > now) {
+        return;
+    }
+
+    uint64_t expirations;
+    if (read(timer_fd, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) {
+        perror("timerfd read failed");
+    }
+    // Callbacks may add timers, so each one is taken off the heap first
+    while (heap_count > 0 && heap[0].when <= now) {
+        timer_entry_t due = heap[0];
+        heap[0] = heap[--heap_count];
+        sift_down(0);
+        due.fn(due.arg);
+    }
+    arm_timerfd();
+}
+
+bool watch_fd(int fd, watch_fn fn, int arg) {
+    check_owner();
+    if (watch_count == watch_cap) {
+        int cap = watch_cap ? watch_cap * 2 : 16;
+        watch_entry_t* grown = realloc(watches, cap * sizeof(watch_entry_t));
+        if (grown == NULL) {
+            perror("realloc failed");
+            return false;
+        }
+        watches = grown;
+        watch_cap = cap;
+    }
+    watches[watch_count].fd = fd;
+    watches[watch_count].fn = fn;
+    watches[watch_count].arg = arg;
+    watch_count++;
+    return true;
+}
+
+void unwatch_fd(int fd) {
+    for (int i = 0; i < watch_count; i++) {
+        if (watches[i].fd == fd) {
+            watches[i] = watches[--watch_count];
+            return;
+        }
+    }
+}
+
+bool events_pending() {
+    return heap_count > 0 || watch_count > 0;
+}
+
+// Poll fd (which may be -1), the timerfd and the watched fds, then run
+// the callbacks of ready watches and the due timers. Returns the events
+// of fd, 0 when interrupted and -1 on error.
+static int poll_events(int fd, int timeout) {
+    if (watch_count + 2 > poll_cap) {
+        int cap = watch_cap + 2;
+        struct pollfd* grown = realloc(poll_set, cap * sizeof(struct pollfd));
+        if (grown == NULL) {
+            perror("realloc failed");
+            return -1;
+        }
+        poll_set = grown;
+        poll_cap = cap;
+    }
+    int count = watch_count + 2;
+    poll_set[0] = (struct pollfd){fd, POLLIN, 0};
+    poll_set[1] = (struct pollfd){timer_fd, POLLIN, 0};
+    for (int i = 0; i < watch_count; i++) {
+        poll_set[i + 2] = (struct pollfd){watches[i].fd, POLLIN, 0};
+    }
+    if (poll(poll_set, count, timeout) == -1) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    // A callback may unwatch any fd, so each one is looked up again
+    for (int i = 2; i < count; i++) {
+        if (poll_set[i].revents == 0) {
+            continue;
+        }
+        for (int j = 0; j < watch_count; j++) {
+            if (watches[j].fd == poll_set[i].fd) {
+                watches[j].fn(watches[j].fd, watches[j].arg);
+                break;
+            }
+        }
+    }
+    run_due_timers();
+    return poll_set[0].revents;
+}
+
+void run_due_events() {
+    run_due_timers();
+    if (watch_count == 0) {
+        return;
+    }
+    double now = monotonic_seconds();
+    if (now - last_watch_poll >= WATCH_POLL_INTERVAL) {
+        last_watch_poll = now;
+        poll_events(-1, 0);
+    }
+}
+
+bool parse_duration(const char* text, double* seconds) {
+    char* end;
+    double value = strtod(text, &end);
+    double scale = 1;
+    if (strcmp(end, "ms") == 0) scale = 0.001;
+    else if (strcmp(end, "m") == 0) scale = 60;
+    else if (strcmp(end, "h") == 0) scale = 3600;
+    else if (*end != '\0' && strcmp(end, "s") != 0) return false;
+    if (end == text || value < 0) {
+        return false;
+    }
+    *seconds = value * scale;
+    return true;
+}
+
+pid_t wait_with_timers(pid_t pid, int* status, int options, struct rusage* usage) {
+    check_owner();
+    if (!events_pending()) {
+        return wait4(pid, status, options, usage);
+    }
+
+    // SIGCHLD is blocked, so a signalfd sees it instead of the handler
+    if (sigchld_fd == -1) {
+        sigset_t chld;
+        sigemptyset(&chld);
+        sigaddset(&chld, SIGCHLD);
+        sigchld_fd = signalfd(-1, &chld, SFD_NONBLOCK | SFD_CLOEXEC);
+        if (sigchld_fd == -1) {
+            perror("signalfd failed");
+            return wait4(pid, status, options, usage);
+        }
+    }
+
+    bool consumed = false;
+    pid_t result;
+    while ((result = wait4(pid, status, options | WNOHANG, usage)) == 0) {
+        if (!events_pending()) {
+            result = wait4(pid, status, options, usage);
+            break;
+        }
+
+        int ready = poll_events(sigchld_fd, -1);
+        if (ready == -1) {
+            perror("poll failed");
+            result = wait4(pid, status, options, usage);
+            break;
+        }
+        if (ready & POLLIN) {
+            struct signalfd_siginfo info;
+            while (read(sigchld_fd, &info, sizeof(info)) > 0) {
+                consumed = true;
+            }
+        }
+    }
+
+    // Other children may have exited meanwhile; leave SIGCHLD pending so
+    // the handler reaps them once the caller unblocks it
+    if (consumed) {
+        raise(SIGCHLD);
+    }
+    return result;
+}
+
+void wait_readable_with_timers(int fd) {
+    check_owner();
+    while (events_pending()) {
+        if (poll_events(fd, -1) != 0) {
+            return;
+        }
+    }
+}
+
+bool wait_readable_until(int fd, double deadline) {
+    check_owner();
+    int timeout = -1;
+    if (deadline > 0) {
+        double left = deadline - monotonic_seconds();
+        if (left <= 0) {
+            return false;
+        }
+        timeout = (int)(left * 1000) + 1;
+    }
+    int ready = poll_events(fd, timeout);
+    if (ready == -1) {
+        perror("poll failed");
+    }
+    return ready > 0;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "parse_cache.h"
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -6,16 +7,34 @@
 #include <stdio.h>
 // ############## LLM Generated Code Begins ##############
 
+// Split a line into words with the lexer. Words are dequoted in place and
+// operators are returned as static strings, so quoted text like "a b" or
+// '|' stays one word.
 void split_command(char* input, char** argv, int* argc) {
     *argc = 0;
-    char* token = strtok(input, " \t\n");
-    
-    while (token != NULL && *argc < MAX_INPUT_SIZE / 2) {
-        argv[(*argc)++] = token;
-        token = strtok(NULL, " \t\n");
+    argv[0] = NULL;
+
+    token_list_t tokens = {NULL, 0, 0};
+    if (!lex_cached(input, strlen(input), &tokens)) {
+        free_tokens(&tokens);
+        return;
     }
-    
+
+    for (int i = 0; i < tokens.count && *argc < MAX_INPUT_SIZE / 2 - 1; i++) {
+        token_t* tok = &tokens.tokens[i];
+        if (tok->type != TOK_WORD) {
+            argv[(*argc)++] = (char*)token_text(tok->type);
+            continue;
+        }
+
+        // Dequoting only ever shrinks a word, so it can run in place
+        char* word = input + tok->offset;
+        word[lex_dequote(word, tok->length, word)] = '\0';
+        argv[(*argc)++] = word;
+    }
+
     argv[*argc] = NULL;
+    free_tokens(&tokens);
 }
 // ############## LLM Generated Code Ends ################
 char* get_home_directory(){
@@ -64,4 +83,94 @@ char* format_path(const char* current_path, const char* home_path) {
     
     return formatted_path;
 }
+// ############## LLM Generated Code Ends ################
+// ############## LLM Generated Code Begins ##############
+// Multikey quicksort: partition on one byte at a time so common prefixes
+// are compared once instead of on every strcmp
+static void insertion_sort_from(char** a, size_t n, size_t depth) {
+    for (size_t i = 1; i < n; i++) {
+        char* key = a[i];
+        size_t j = i;
+        while (j > 0 && strcmp(a[j - 1] + depth, key + depth) > 0) {
+            a[j] = a[j - 1];
+            j--;
+        }
+        a[j] = key;
+    }
+}
+
+static void multikey_sort(char** a, size_t n, size_t depth) {
+    while (n > 16) {
+        char* tmp = a[0];
+        a[0] = a[n / 2];
+        a[n / 2] = tmp;
+        int pivot = (unsigned char)a[0][depth];
+
+        // Three-way partition into <, == and > the pivot byte
+        size_t lt = 0, i = 0, gt = n;
+        while (i < gt) {
+            int c = (unsigned char)a[i][depth];
+            if (c < pivot) {
+                tmp = a[lt]; a[lt++] = a[i]; a[i++] = tmp;
+            } else if (c > pivot) {
+                tmp = a[--gt]; a[gt] = a[i]; a[i] = tmp;
+            } else {
+                i++;
+            }
+        }
+
+        multikey_sort(a, lt, depth);
+        if (pivot != 0) {
+            multikey_sort(a + lt, gt - lt, depth + 1);
+        }
+        a += gt;
+        n -= gt;
+    }
+    insertion_sort_from(a, n, depth);
+}
+
+void sort_strings(char** strings, size_t count) {
+    multikey_sort(strings, count, 0);
+}
+
+// Parse a positive count with an optional K, M or G suffix
+bool parse_size(const char* text, long long* out) {
+    char* end;
+    long long value = strtoll(text, &end, 10);
+    long long scale = 1;
+    if (*end == 'K' || *end == 'k') scale = 1LL << 10;
+    else if (*end == 'M' || *end == 'm') scale = 1LL << 20;
+    else if (*end == 'G' || *end == 'g') scale = 1LL << 30;
+    if (end == text || value <= 0) {
+        return false;
+    }
+    if (scale > 1) {
+        end++;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    *out = value * scale;
+    return true;
+}
+
+void format_size(double bytes, char* out, size_t size) {
+    const char* units = "BKMGT";
+    int unit = 0;
+    while (bytes >= 1024 && units[unit + 1] != '\0') {
+        bytes /= 1024;
+        unit++;
+    }
+    snprintf(out, size, unit == 0 ? "%.0f%c" : "%.1f%c", bytes, units[unit]);
+}
+
+void format_duration(double seconds, char* out, size_t size) {
+    if (seconds < 1e-3) {
+        snprintf(out, size, "%.1fus", seconds * 1e6);
+    } else if (seconds < 1) {
+        snprintf(out, size, "%.2fms", seconds * 1e3);
+    } else {
+        snprintf(out, size, "%.3fs", seconds);
+    }
+}
 // ############## LLM Generated Code Ends ################
\ No newline at end of file
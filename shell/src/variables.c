@@ -0,0 +1,520 @@
+#include "variables.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <errno.h>
+// ############## LLM Generated Code Begins ##############
+extern char** environ;
+
+#define INITIAL_VAR_CAPACITY 64
+
+// One slot of the open-addressing table. The entry is stored as a single
+// "NAME=value" string so it can be handed to execve without copying.
+typedef struct {
+    char* entry;
+    size_t name_len;
+    uint32_t hash;
+    bool exported;
+} var_slot_t;
+
+// Marks a deleted slot so probe sequences continue past it
+static char tombstone;
+#define TOMBSTONE (&tombstone)
+
+static var_slot_t* var_table = NULL;
+static size_t var_capacity = 0;   // Always a power of two
+static size_t var_used = 0;       // Live entries plus tombstones
+static size_t var_count = 0;      // Live entries
+static size_t exported_count = 0;
+
+static char** envp_cache = NULL;
+static bool envp_dirty = true;
+
+// Names given to export while unset; they are exported once assigned
+static char** pending_exports = NULL;
+static size_t pending_count = 0;
+
+// Bumped whenever PATH changes so cached command lookups can be dropped
+static unsigned path_generation = 0;
+
+// FNV-1a hash of the variable name
+static uint32_t hash_name(const char* name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Find the slot holding name, or NULL if it is not set
+static var_slot_t* find_slot(const char* name, size_t len, uint32_t hash) {
+    if (var_capacity == 0) {
+        return NULL;
+    }
+
+    size_t mask = var_capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        var_slot_t* slot = &var_table[i];
+        if (slot->entry == NULL) {
+            return NULL;
+        }
+        if (slot->entry != TOMBSTONE && slot->hash == hash && slot->name_len == len &&
+            memcmp(slot->entry, name, len) == 0) {
+            return slot;
+        }
+    }
+}
+
+// Find the first free slot on the probe sequence of hash
+static var_slot_t* free_slot(uint32_t hash) {
+    size_t mask = var_capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        if (var_table[i].entry == NULL || var_table[i].entry == TOMBSTONE) {
+            return &var_table[i];
+        }
+    }
+}
+
+// Rehash into a table of the given capacity, dropping tombstones
+static bool resize_table(size_t capacity) {
+    var_slot_t* old_table = var_table;
+    size_t old_capacity = var_capacity;
+
+    var_table = calloc(capacity, sizeof(var_slot_t));
+    if (var_table == NULL) {
+        perror("calloc failed");
+        var_table = old_table;
+        return false;
+    }
+    var_capacity = capacity;
+    var_used = 0;
+
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_table[i].entry != NULL && old_table[i].entry != TOMBSTONE) {
+            *free_slot(old_table[i].hash) = old_table[i];
+            var_used++;
+        }
+    }
+
+    free(old_table);
+    return true;
+}
+
+// Drop name from the pending exports; returns whether it was there
+static bool take_pending_export(const char* name) {
+    for (size_t i = 0; i < pending_count; i++) {
+        if (strcmp(pending_exports[i], name) == 0) {
+            free(pending_exports[i]);
+            pending_exports[i] = pending_exports[--pending_count];
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool add_pending_export(const char* name) {
+    for (size_t i = 0; i < pending_count; i++) {
+        if (strcmp(pending_exports[i], name) == 0) {
+            return true;
+        }
+    }
+    char** grown = realloc(pending_exports, (pending_count + 1) * sizeof(char*));
+    if (grown == NULL) {
+        perror("realloc failed");
+        return false;
+    }
+    pending_exports = grown;
+    if ((pending_exports[pending_count] = strdup(name)) == NULL) {
+        perror("strdup failed");
+        return false;
+    }
+    pending_count++;
+    return true;
+}
+
+void init_variables() {
+    resize_table(INITIAL_VAR_CAPACITY);
+
+    for (char** env = environ; env && *env; env++) {
+        char* eq = strchr(*env, '=');
+        if (eq == NULL) continue;
+
+        char* name = strndup(*env, eq - *env);
+        if (name != NULL) {
+            set_variable(name, eq + 1, true);
+            free(name);
+        }
+    }
+}
+
+const char* get_variable_n(const char* name, size_t len) {
+    var_slot_t* slot = find_slot(name, len, hash_name(name, len));
+    return slot ? slot->entry + len + 1 : NULL;
+}
+
+const char* get_variable(const char* name) {
+    return get_variable_n(name, strlen(name));
+}
+
+bool set_variable(const char* name, const char* value, bool exported) {
+    size_t name_len = strlen(name);
+    size_t value_len = strlen(value);
+    uint32_t hash = hash_name(name, name_len);
+    if (strcmp(name, "PATH") == 0) {
+        path_generation++;
+    }
+    if (pending_count > 0 && take_pending_export(name)) {
+        exported = true;
+    }
+
+    char* entry = malloc(name_len + value_len + 2);
+    if (entry == NULL) {
+        perror("malloc failed");
+        return false;
+    }
+    memcpy(entry, name, name_len);
+    entry[name_len] = '=';
+    memcpy(entry + name_len + 1, value, value_len + 1);
+
+    var_slot_t* slot = find_slot(name, name_len, hash);
+    if (slot != NULL) {
+        // Updating keeps an existing export flag
+        free(slot->entry);
+        slot->entry = entry;
+        if (exported && !slot->exported) {
+            slot->exported = true;
+            exported_count++;
+        }
+        if (slot->exported) {
+            envp_dirty = true;
+        }
+        return true;
+    }
+
+    // Keep the load factor (tombstones included) below 70%
+    if ((var_used + 1) * 10 > var_capacity * 7) {
+        size_t capacity = var_capacity ? var_capacity : INITIAL_VAR_CAPACITY;
+        while ((var_count + 1) * 10 > capacity * 5) capacity *= 2;
+        if (!resize_table(capacity)) {
+            free(entry);
+            return false;
+        }
+    }
+
+    slot = free_slot(hash);
+    if (slot->entry == NULL) {
+        var_used++;
+    }
+    slot->entry = entry;
+    slot->name_len = name_len;
+    slot->hash = hash;
+    slot->exported = exported;
+    var_count++;
+
+    if (exported) {
+        exported_count++;
+        envp_dirty = true;
+    }
+    return true;
+}
+
+bool unset_variable(const char* name) {
+    if (pending_count > 0) {
+        take_pending_export(name);
+    }
+    size_t len = strlen(name);
+    var_slot_t* slot = find_slot(name, len, hash_name(name, len));
+    if (slot == NULL) {
+        return false;
+    }
+    if (strcmp(name, "PATH") == 0) {
+        path_generation++;
+    }
+
+    if (slot->exported) {
+        exported_count--;
+        envp_dirty = true;
+    }
+    free(slot->entry);
+    slot->entry = TOMBSTONE;
+    var_count--;
+    return true;
+}
+
+char** get_envp() {
+    if (!envp_dirty && envp_cache != NULL) {
+        return envp_cache;
+    }
+
+    char** envp = realloc(envp_cache, (exported_count + 1) * sizeof(char*));
+    if (envp == NULL) {
+        perror("realloc failed");
+        return environ;
+    }
+
+    size_t n = 0;
+    for (size_t i = 0; i < var_capacity; i++) {
+        var_slot_t* slot = &var_table[i];
+        if (slot->entry != NULL && slot->entry != TOMBSTONE && slot->exported) {
+            envp[n++] = slot->entry;
+        }
+    }
+    envp[n] = NULL;
+
+    envp_cache = envp;
+    envp_dirty = false;
+    return envp;
+}
+
+void exec_file(const char* path, char** argv) {
+    char** envp = get_envp();
+    execve(path, argv, envp);
+    if (errno != ENOEXEC) {
+        return;
+    }
+
+    // /bin/sh path args...
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    char** sh_argv = malloc((argc + 2) * sizeof(char*));
+    if (sh_argv != NULL) {
+        sh_argv[0] = (char*)"/bin/sh";
+        sh_argv[1] = (char*)path;
+        memcpy(sh_argv + 2, argv + 1, argc * sizeof(char*));
+        execve("/bin/sh", sh_argv, envp);
+        free(sh_argv);
+    }
+    errno = ENOEXEC;
+}
+
+void exec_with_env(char** argv) {
+    if (strchr(argv[0], '/') != NULL) {
+        exec_file(argv[0], argv);
+        return;
+    }
+
+    const char* path = get_variable("PATH");
+    if (path == NULL) {
+        path = "/usr/local/bin:/usr/bin:/bin";
+    }
+
+    // Try every PATH entry, reporting EACCES over ENOENT like execvp
+    int saved_errno = ENOENT;
+    char candidate[PATH_MAX];
+    const char* dir = path;
+    while (1) {
+        const char* end = strchr(dir, ':');
+        int dir_len = end ? (int)(end - dir) : (int)strlen(dir);
+
+        if (dir_len == 0) {
+            snprintf(candidate, sizeof(candidate), "%s", argv[0]);
+        } else {
+            snprintf(candidate, sizeof(candidate), "%.*s/%s", dir_len, dir, argv[0]);
+        }
+
+        exec_file(candidate, argv);
+        if (errno == ENOEXEC) {
+            // Found, but not even /bin/sh could run it
+            return;
+        }
+        if (errno == EACCES) {
+            saved_errno = EACCES;
+        }
+
+        if (end == NULL) break;
+        dir = end + 1;
+    }
+
+    errno = saved_errno;
+}
+
+unsigned get_path_generation() {
+    return path_generation;
+}
+
+char* find_command_path(const char* name) {
+    if (strchr(name, '/') != NULL) {
+        return strdup(name);
+    }
+
+    const char* path = get_variable("PATH");
+    if (path == NULL) {
+        path = "/usr/local/bin:/usr/bin:/bin";
+    }
+
+    char candidate[PATH_MAX];
+    const char* dir = path;
+    while (1) {
+        const char* end = strchr(dir, ':');
+        int dir_len = end ? (int)(end - dir) : (int)strlen(dir);
+
+        if (dir_len == 0) {
+            snprintf(candidate, sizeof(candidate), "%s", name);
+        } else {
+            snprintf(candidate, sizeof(candidate), "%.*s/%s", dir_len, dir, name);
+        }
+        if (access(candidate, X_OK) == 0) {
+            return strdup(candidate);
+        }
+
+        if (end == NULL) break;
+        dir = end + 1;
+    }
+    return NULL;
+}
+
+// Length of the NAME part of NAME=value, or 0 if word is not an assignment
+static size_t assignment_name_len(const char* word) {
+    if (!isalpha((unsigned char)word[0]) && word[0] != '_') {
+        return 0;
+    }
+
+    size_t len = 1;
+    while (isalnum((unsigned char)word[len]) || word[len] == '_') {
+        len++;
+    }
+    return word[len] == '=' ? len : 0;
+}
+
+// Whether word is a valid variable name
+static bool is_name(const char* word) {
+    if (!isalpha((unsigned char)word[0]) && word[0] != '_') {
+        return false;
+    }
+    for (size_t i = 1; word[i]; i++) {
+        if (!isalnum((unsigned char)word[i]) && word[i] != '_') return false;
+    }
+    return true;
+}
+
+bool is_assignment(const char* word) {
+    return assignment_name_len(word) > 0;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    return strcmp(*(const char**)a, *(const char**)b);
+}
+
+// export [NAME[=value]...]
+bool export_command(int argc, char** argv) {
+    if (argc == 1) {
+        char** envp = get_envp();
+        size_t n = 0;
+        while (envp[n]) n++;
+
+        // Print a sorted copy so the cached envp order is untouched;
+        // names exported while unset are listed without a value
+        char** sorted = malloc((n + pending_count + 1) * sizeof(char*));
+        if (sorted == NULL) {
+            perror("malloc failed");
+            return false;
+        }
+        memcpy(sorted, envp, n * sizeof(char*));
+        memcpy(sorted + n, pending_exports, pending_count * sizeof(char*));
+        n += pending_count;
+        qsort(sorted, n, sizeof(char*), compare_entries);
+        for (size_t i = 0; i < n; i++) {
+            printf("export %s\n", sorted[i]);
+        }
+        free(sorted);
+        return true;
+    }
+
+    bool result = true;
+    for (int i = 1; i < argc; i++) {
+        size_t name_len = assignment_name_len(argv[i]);
+        if (name_len > 0) {
+            argv[i][name_len] = '\0';
+            result = set_variable(argv[i], argv[i] + name_len + 1, true) && result;
+            argv[i][name_len] = '=';
+        } else if (isalpha((unsigned char)argv[i][0]) || argv[i][0] == '_') {
+            // An unset name gets no value until it is assigned
+            const char* value = get_variable(argv[i]);
+            result = (value ? set_variable(argv[i], value, true) : add_pending_export(argv[i])) &&
+                     result;
+        } else {
+            fprintf(stderr, "export: invalid variable name: %s\n", argv[i]);
+            result = false;
+        }
+    }
+    return result;
+}
+
+// unset NAME...
+bool unset_command(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        unset_variable(argv[i]);
+    }
+    return true;
+}
+
+// read [NAME...]: assign one line of input to the names, split on IFS
+// whitespace with the rest of the line going to the last one. Input is
+// read a byte at a time so later commands still see the following lines.
+bool read_line_command(int argc, char** argv) {
+    size_t len = 0, cap = 64;
+    char* line = malloc(cap);
+    if (line == NULL) {
+        perror("malloc failed");
+        return false;
+    }
+    char c;
+    ssize_t n;
+    bool got_any = false;
+    while ((n = read(STDIN_FILENO, &c, 1)) == 1 || (n == -1 && errno == EINTR)) {
+        if (n != 1) continue;
+        got_any = true;
+        if (c == '\n') break;
+        if (len + 1 >= cap) {
+            char* grown = realloc(line, cap * 2);
+            if (grown == NULL) {
+                perror("realloc failed");
+                free(line);
+                return false;
+            }
+            line = grown;
+            cap *= 2;
+        }
+        line[len++] = c;
+    }
+    line[len] = '\0';
+
+    const char* ifs = get_variable("IFS");
+    if (ifs == NULL) ifs = " \t\n";
+    char* default_name[] = {"read", "REPLY"};
+    if (argc < 2) {
+        argc = 2;
+        argv = default_name;
+    }
+
+    char* p = line + strspn(line, ifs);
+    bool result = got_any;
+    for (int i = 1; i < argc; i++) {
+        char* end;
+        if (i == argc - 1) {
+            // The last name keeps the rest, less trailing separators
+            end = p + strlen(p);
+            while (end > p && strchr(ifs, end[-1]) != NULL) end--;
+        } else {
+            end = p + strcspn(p, ifs);
+        }
+        char saved = *end;
+        *end = '\0';
+        if (!is_name(argv[i])) {
+            fprintf(stderr, "read: invalid variable name: %s\n", argv[i]);
+            result = false;
+        } else if (!set_variable(argv[i], p, false)) {
+            result = false;
+        }
+        *end = saved;
+        p = end + strspn(end, ifs);
+    }
+    free(line);
+    return result;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
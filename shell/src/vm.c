@@ -0,0 +1,610 @@
+#include "vm.h"
+#include "executor.h"
+#include "intrinsics.h"
+#include "variables.h"
+#include "jobs.h"
+#include "timing.h"
+#include "timers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+// ############## LLM Generated Code Begins ##############
+#define MAX_CALL_DEPTH 200
+
+volatile sig_atomic_t vm_interrupted = 0;
+volatile sig_atomic_t vm_exit_requested = 0;
+
+#define INITIAL_FUNCTION_CAPACITY 16
+
+// Functions defined so far, in an open-addressing table like the
+// variables'; bodies are shared with the defining program. Functions are
+// never removed, so there are no tombstones.
+typedef struct {
+    char* name;
+    uint32_t hash;
+    program_t* body;
+} function_t;
+
+static function_t* functions = NULL;
+static size_t function_capacity = 0;  // Always a power of two
+static size_t function_count = 0;
+
+// Positional parameters of the innermost function call
+static char** positional = NULL;
+static int positional_count = 0;
+static int call_depth = 0;
+static const char* script_name = "shell";
+
+// Words of one running for loop, or the last body status of a while loop
+typedef struct {
+    word_list_t words;
+    size_t next;
+    int status;
+} loop_slot_t;
+
+program_t* new_program() {
+    program_t* prog = calloc(1, sizeof(program_t));
+    if (prog == NULL) {
+        perror("calloc failed");
+        return NULL;
+    }
+    prog->refs = 1;
+    return prog;
+}
+
+void release_program(program_t* prog) {
+    if (prog == NULL || --prog->refs > 0) {
+        return;
+    }
+
+    for (int i = 0; i < prog->cmd_count; i++) {
+        vm_cmd_t* cmd = &prog->cmds[i];
+        free(cmd->text);
+        free(cmd->tokens);
+        free(cmd->var);
+        free_word_list(&cmd->template_words);
+        free(cmd->template_argv);
+        free(cmd->path);
+        free_expanded_cmd(&cmd->scratch);
+    }
+    for (int i = 0; i < prog->func_count; i++) {
+        free(prog->funcs[i].name);
+        release_program(prog->funcs[i].body);
+    }
+    free(prog->code);
+    free(prog->cmds);
+    free(prog->funcs);
+    free(prog);
+}
+
+// Grow an array of elements of the given size to hold one more
+static bool reserve(void** items, int count, int* cap, size_t size) {
+    if (count < *cap) {
+        return true;
+    }
+    int new_cap = *cap ? *cap * 2 : 16;
+    void* grown = realloc(*items, new_cap * size);
+    if (grown == NULL) {
+        perror("realloc failed");
+        return false;
+    }
+    *items = grown;
+    *cap = new_cap;
+    return true;
+}
+
+int program_emit(program_t* prog, opcode_t op, int arg, int aux) {
+    if (!reserve((void**)&prog->code, prog->code_len, &prog->code_cap, sizeof(instr_t))) {
+        return -1;
+    }
+    instr_t* in = &prog->code[prog->code_len];
+    in->op = op;
+    in->arg = arg;
+    in->aux = aux;
+    in->jump = 0;
+    return prog->code_len++;
+}
+
+int program_add_command(program_t* prog, const char* text, const token_t* tokens, int count) {
+    if (!reserve((void**)&prog->cmds, prog->cmd_count, &prog->cmd_cap, sizeof(vm_cmd_t))) {
+        return -1;
+    }
+    vm_cmd_t* cmd = &prog->cmds[prog->cmd_count];
+    memset(cmd, 0, sizeof(*cmd));
+
+    size_t base = count > 0 ? tokens[0].offset : 0;
+    size_t end = count > 0 ? tokens[count - 1].offset + tokens[count - 1].length : 0;
+    cmd->text = strndup(text + base, end - base);
+    cmd->tokens = malloc((count + 1) * sizeof(token_t));
+    if (cmd->text == NULL || cmd->tokens == NULL) {
+        free(cmd->text);
+        free(cmd->tokens);
+        return -1;
+    }
+
+    // Offsets are rebased onto the copy; newlines continuing a pipeline
+    // or a && or || turn into plain spaces, while those separating the
+    // commands of a compound stage stay
+    for (int i = 0; i < count; i++) {
+        token_type_t before = i > 0 ? tokens[i - 1].type : TOK_NEWLINE;
+        if (tokens[i].type == TOK_NEWLINE &&
+            (before == TOK_PIPE || before == TOK_AND_IF || before == TOK_OR_IF ||
+             before == TOK_NEWLINE)) {
+            cmd->text[tokens[i].offset - base] = ' ';
+            continue;
+        }
+        cmd->tokens[cmd->count] = tokens[i];
+        cmd->tokens[cmd->count].offset -= base;
+        cmd->count++;
+    }
+    return prog->cmd_count++;
+}
+
+int program_add_function(program_t* prog, const char* name, size_t len, program_t* body) {
+    if (!reserve((void**)&prog->funcs, prog->func_count, &prog->func_cap, sizeof(func_def_t))) {
+        release_program(body);
+        return -1;
+    }
+    prog->funcs[prog->func_count].name = strndup(name, len);
+    prog->funcs[prog->func_count].body = body;
+    return prog->func_count++;
+}
+
+static uint32_t hash_function_name(const char* name) {
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// The slot holding name, or the empty slot where it would go
+static function_t* function_slot(const char* name, uint32_t hash) {
+    size_t mask = function_capacity - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        function_t* f = &functions[i];
+        if (f->name == NULL || (f->hash == hash && strcmp(f->name, name) == 0)) {
+            return f;
+        }
+    }
+}
+
+static function_t* find_function(const char* name) {
+    if (function_count == 0) {
+        return NULL;
+    }
+    function_t* f = function_slot(name, hash_function_name(name));
+    return f->name != NULL ? f : NULL;
+}
+
+// Rehash into a table of the given capacity
+static bool resize_functions(size_t capacity) {
+    function_t* old_table = functions;
+    size_t old_capacity = function_capacity;
+
+    functions = calloc(capacity, sizeof(function_t));
+    if (functions == NULL) {
+        perror("calloc failed");
+        functions = old_table;
+        return false;
+    }
+    function_capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_table[i].name != NULL) {
+            *function_slot(old_table[i].name, old_table[i].hash) = old_table[i];
+        }
+    }
+    free(old_table);
+    return true;
+}
+
+static void define_function(const func_def_t* def) {
+    if (def->name == NULL) {
+        return;
+    }
+
+    def->body->refs++;
+    function_t* f = find_function(def->name);
+    if (f != NULL) {
+        // A running body keeps its own reference until it returns
+        release_program(f->body);
+        f->body = def->body;
+        return;
+    }
+
+    // Keep the load factor below 70%
+    if ((function_count + 1) * 10 > function_capacity * 7 &&
+        !resize_functions(function_capacity ? function_capacity * 2 : INITIAL_FUNCTION_CAPACITY)) {
+        release_program(def->body);
+        return;
+    }
+    char* name = strdup(def->name);
+    if (name == NULL) {
+        perror("strdup failed");
+        release_program(def->body);
+        return;
+    }
+    uint32_t hash = hash_function_name(name);
+    f = function_slot(name, hash);
+    f->name = name;
+    f->hash = hash;
+    f->body = def->body;
+    function_count++;
+}
+
+void vm_set_script_args(const char* name, int argc, char** argv) {
+    script_name = name;
+    positional = argv;
+    positional_count = argc;
+}
+
+const char* vm_positional(int n) {
+    if (n == 0) {
+        return script_name;
+    }
+    return n <= positional_count ? positional[n - 1] : NULL;
+}
+
+int vm_positional_count() {
+    return positional_count;
+}
+
+static int call_function(program_t* body, int argc, char** argv) {
+    if (call_depth >= MAX_CALL_DEPTH) {
+        fprintf(stderr, "%s: maximum function nesting exceeded\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Copy the arguments: argv may be a buffer the body reuses
+    word_list_t args = {{NULL, 0, 0}, NULL, 0, 0};
+    char** params = malloc(argc * sizeof(char*));
+    bool ok = params != NULL;
+    for (int i = 1; ok && i < argc; i++) {
+        ok = word_list_add(&args, argv[i], strlen(argv[i]));
+    }
+    if (!ok) {
+        free(params);
+        free_word_list(&args);
+        return EXIT_FAILURE;
+    }
+    for (int i = 1; i < argc; i++) {
+        params[i - 1] = args.text.data + args.offsets[i - 1];
+    }
+
+    char** saved = positional;
+    int saved_count = positional_count;
+    positional = params;
+    positional_count = argc - 1;
+
+    // Hold the body in case the function redefines itself
+    body->refs++;
+    int status = vm_run(body);
+    release_program(body);
+
+    positional = saved;
+    positional_count = saved_count;
+    free(params);
+    free_word_list(&args);
+    return status;
+}
+
+bool vm_call_function(int argc, char** argv, int* status) {
+    function_t* f = argc > 0 ? find_function(argv[0]) : NULL;
+    if (f == NULL) {
+        return false;
+    }
+    *status = call_function(f->body, argc, argv);
+    return true;
+}
+
+// Check whether a raw word reads the same after expansion as after
+// quote removal: no $, no backquote and no unquoted wildcard. A "[" with
+// no "]" after it cannot match anything, so [ itself stays static.
+static bool is_static_word(const char* word, size_t len) {
+    char quote = '\0';
+    for (size_t i = 0; i < len; i++) {
+        char c = word[i];
+        if (quote == '\'') {
+            if (c == '\'') quote = '\0';
+        } else if (c == '$' || c == '`') {
+            return false;
+        } else if (c == '\\') {
+            i++;
+        } else if ((c == '\'' && quote == '\0') || c == '"') {
+            quote = quote == c ? '\0' : c;
+        } else if (quote == '\0' && (c == '*' || c == '?')) {
+            return false;
+        } else if (quote == '\0' && c == '[' && memchr(word + i, ']', len - i) != NULL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Classify a command the first time it runs and build its argv template
+static void prepare_command(vm_cmd_t* cmd) {
+    int assignments = 0;
+    int words = 0;
+    bool generic = false;
+    bool all_static = true;
+
+    for (int i = 0; i < cmd->count; i++) {
+        token_t* tok = &cmd->tokens[i];
+        const char* raw = cmd->text + tok->offset;
+        if (tok->type != TOK_WORD) {
+            generic = true;
+        } else if (words == 0 && is_assignment(raw)) {
+            assignments++;
+        } else {
+            words++;
+            all_static = all_static && is_static_word(raw, tok->length);
+        }
+    }
+
+    // Prefix assignments and redirections need the executor's handling
+    if (generic || (assignments > 0 && words > 0)) {
+        cmd->kind = CMD_GENERIC;
+        return;
+    }
+    if (words == 0) {
+        cmd->kind = CMD_ASSIGN;
+        return;
+    }
+
+    cmd->kind = CMD_SIMPLE;
+    if (!all_static) {
+        return;
+    }
+
+    bool ok = true;
+    for (int i = 0; ok && i < cmd->count; i++) {
+        char* word = dequote_word(cmd->text + cmd->tokens[i].offset, cmd->tokens[i].length);
+        ok = word != NULL && word_list_add(&cmd->template_words, word, strlen(word));
+        free(word);
+    }
+    cmd->template_argv = ok ? malloc((cmd->count + 1) * sizeof(char*)) : NULL;
+    if (cmd->template_argv == NULL) {
+        free_word_list(&cmd->template_words);
+        return;
+    }
+    for (int i = 0; i < cmd->count; i++) {
+        cmd->template_argv[i] = cmd->template_words.text.data + cmd->template_words.offsets[i];
+    }
+    cmd->template_argv[cmd->count] = NULL;
+    cmd->intrinsic = is_intrinsic(cmd->template_argv[0]);
+}
+
+// Resolve the program of a template, again only after PATH changes
+static const char* template_path(vm_cmd_t* cmd) {
+    unsigned generation = get_path_generation();
+    if (cmd->path == NULL || cmd->path_generation != generation) {
+        free(cmd->path);
+        cmd->path = find_command_path(cmd->template_argv[0]);
+        cmd->path_generation = generation;
+    }
+    return cmd->path;
+}
+
+// Intrinsics may modify their arguments, so each run gets a fresh copy
+static bool copy_template(vm_cmd_t* cmd) {
+    expanded_cmd_t* ex = &cmd->scratch;
+    ex->words.text.len = 0;
+    ex->words.count = 0;
+    for (int i = 0; cmd->template_argv[i] != NULL; i++) {
+        if (!word_list_add(&ex->words, cmd->template_argv[i], strlen(cmd->template_argv[i]))) {
+            return false;
+        }
+    }
+    return finish_expanded_cmd(ex);
+}
+
+static int run_command(vm_cmd_t* cmd) {
+    if (cmd->kind == CMD_UNPREPARED) {
+        prepare_command(cmd);
+    }
+
+    if (cmd->kind == CMD_GENERIC) {
+        return run_foreground(cmd->text);
+    }
+
+    expanded_cmd_t* ex = &cmd->scratch;
+    if (cmd->kind == CMD_ASSIGN) {
+        take_substitution_status();
+        if (!expand_tokens(cmd->text, cmd->tokens, cmd->count, true, ex)) {
+            return EXIT_FAILURE;
+        }
+        for (int i = 0; i < ex->argc; i++) {
+            char* eq = strchr(ex->argv[i], '=');
+            *eq = '\0';
+            set_variable(ex->argv[i], eq + 1, false);
+        }
+        int status = take_substitution_status();
+        return status >= 0 ? status : EXIT_SUCCESS;
+    }
+
+    // Programs run from the template without copying or expanding anything
+    if (cmd->template_argv != NULL && !cmd->intrinsic &&
+        find_function(cmd->template_argv[0]) == NULL) {
+        return run_argv_foreground(cmd->text, cmd->template_argv, template_path(cmd));
+    }
+
+    bool ok = cmd->template_argv != NULL ? copy_template(cmd)
+                                         : expand_tokens(cmd->text, cmd->tokens, cmd->count, false, ex);
+    if (!ok) {
+        return EXIT_FAILURE;
+    }
+    if (ex->argc == 0) {
+        return EXIT_SUCCESS;
+    }
+
+    return vm_run_argv(cmd->text, ex->argc, ex->argv);
+}
+
+int vm_run_argv(const char* text, int argc, char** argv) {
+    function_t* f = find_function(argv[0]);
+    if (f != NULL) {
+        return call_function(f->body, argc, argv);
+    }
+    if (is_intrinsic(argv[0])) {
+        return run_intrinsic_status(argv[0], argc, argv);
+    }
+    return run_argv_foreground(text, argv, NULL);
+}
+
+// Run a foreground command, printing its stats when $REPORTTIME is set
+// and it took longer
+static int run_reported(vm_cmd_t* cmd) {
+    double threshold = report_threshold();
+    if (threshold < 0) {
+        return run_command(cmd);
+    }
+
+    timing_t t;
+    timing_result_t result;
+    timing_start(&t);
+    int status = run_command(cmd);
+    timing_finish(&t, &result);
+    if (result.real >= threshold) {
+        print_timing(&result, cmd->text);
+    }
+    return status;
+}
+
+// Expand the words of a for loop into its slot
+static bool start_loop(vm_cmd_t* cmd, loop_slot_t* slot) {
+    slot->words.text.len = 0;
+    slot->words.count = 0;
+    slot->next = 0;
+
+    expanded_cmd_t* ex = &cmd->scratch;
+    if (!expand_tokens(cmd->text, cmd->tokens, cmd->count, false, ex)) {
+        return false;
+    }
+    for (int i = 0; i < ex->argc; i++) {
+        if (!word_list_add(&slot->words, ex->argv[i], strlen(ex->argv[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int vm_run(program_t* prog) {
+    if (call_depth == 0) {
+        vm_interrupted = 0;
+    }
+    call_depth++;
+
+    loop_slot_t* slots = NULL;
+    if (prog->loop_slots > 0 && (slots = calloc(prog->loop_slots, sizeof(loop_slot_t))) == NULL) {
+        perror("calloc failed");
+        call_depth--;
+        return EXIT_FAILURE;
+    }
+
+    timing_t* timers = NULL;
+    if (prog->timer_slots > 0 && (timers = calloc(prog->timer_slots, sizeof(timing_t))) == NULL) {
+        perror("calloc failed");
+        free(slots);
+        call_depth--;
+        return EXIT_FAILURE;
+    }
+
+    int pc = 0;
+    while (pc < prog->code_len) {
+        if (vm_interrupted) {
+            set_last_status(130);
+            break;
+        }
+        if (vm_exit_requested) {
+            break;
+        }
+
+        // Queued jobs take the slots of jobs that finished meanwhile
+        if (jobs_reaped) {
+            dispatch_jobs();
+        }
+        if (events_pending()) {
+            run_due_events();
+        }
+
+        const instr_t* in = &prog->code[pc++];
+        switch (in->op) {
+        case OP_RUN:
+            set_last_status(run_reported(&prog->cmds[in->arg]));
+            break;
+        case OP_RUN_BG:
+            set_last_status(run_background(prog->cmds[in->arg].text));
+            break;
+        case OP_JUMP:
+            pc = in->jump;
+            break;
+        case OP_JUMP_IF_FAIL:
+            if (get_last_status() != 0) pc = in->jump;
+            break;
+        case OP_JUMP_IF_OK:
+            if (get_last_status() == 0) pc = in->jump;
+            break;
+        case OP_SET_STATUS:
+            set_last_status(in->arg);
+            break;
+        case OP_FOR_INIT:
+            if (!start_loop(&prog->cmds[in->arg], &slots[in->aux])) {
+                set_last_status(EXIT_FAILURE);
+                pc = prog->code_len;
+            }
+            break;
+        case OP_FOR_NEXT: {
+            loop_slot_t* slot = &slots[in->aux];
+            if (slot->next == slot->words.count) {
+                pc = in->jump;
+            } else {
+                const char* word = slot->words.text.data + slot->words.offsets[slot->next++];
+                set_variable(prog->cmds[in->arg].var, word, false);
+            }
+            break;
+        }
+        case OP_DEFINE:
+            define_function(&prog->funcs[in->arg]);
+            set_last_status(EXIT_SUCCESS);
+            break;
+        case OP_RETURN:
+            if (in->arg >= 0) {
+                vm_cmd_t* cmd = &prog->cmds[in->arg];
+                char* word = expand_word(cmd->text, strlen(cmd->text));
+                set_last_status(word ? atoi(word) & 0xFF : EXIT_FAILURE);
+                free(word);
+            }
+            if (in->aux) {
+                vm_exit_requested = 1;
+            }
+            pc = prog->code_len;
+            break;
+        case OP_TIME_START:
+            timing_start(&timers[in->aux]);
+            break;
+        case OP_TIME_END: {
+            timing_result_t result;
+            timing_finish(&timers[in->aux], &result);
+            print_timing(&result, NULL);
+            break;
+        }
+        case OP_SAVE_STATUS:
+            slots[in->aux].status = get_last_status();
+            break;
+        case OP_RESTORE_STATUS:
+            set_last_status(slots[in->aux].status);
+            break;
+        }
+    }
+
+    for (int i = 0; i < prog->loop_slots; i++) {
+        free_word_list(&slots[i].words);
+    }
+    free(slots);
+    free(timers);
+    call_depth--;
+    return get_last_status();
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
@@ -0,0 +1,453 @@
+#define _GNU_SOURCE
+#include "wildcard.h"
+#include "expand.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+// ############## LLM Generated Code Begins ##############
+#define MAX_GLOB_TOKENS 63
+#define DIR_CACHE_BUCKETS 1024
+
+// A pattern component compiled to a shift-and automaton. Bit i of the state
+// means the first i tokens have been matched; every input byte advances all
+// live states at once, so matching never backtracks.
+typedef struct {
+    uint64_t accepts[256];   // Bit i set if non-star token i accepts the byte
+    uint64_t stars;          // Bit i set if token i is '*'
+    uint64_t final;          // State reached after the last token
+    bool leading_dot;        // Pattern starts with a literal '.'
+    const char* fallback;    // Too long to compile; matched with fnmatch
+} glob_matcher_t;
+
+typedef enum {
+    COMP_LITERAL,
+    COMP_GLOB,
+    COMP_GLOBSTAR
+} comp_kind_t;
+
+// Directory listings read during one expansion, keyed by path
+typedef struct dir_cache_entry {
+    char* path;
+    bool ok;
+    dir_listing_t listing;
+    struct dir_cache_entry* next;
+} dir_cache_entry_t;
+
+struct dir_cache {
+    dir_cache_entry_t* buckets[DIR_CACHE_BUCKETS];
+};
+
+// State of expanding one pattern
+typedef struct {
+    char** comps;
+    comp_kind_t* kinds;
+    glob_matcher_t* matchers;
+    int ncomps;
+    dir_cache_t* cache;
+    word_list_t* matches;
+    char path[PATH_MAX];
+} glob_walk_t;
+
+bool read_dir_listing(const char* path, dir_listing_t* listing) {
+    memset(listing, 0, sizeof(*listing));
+
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return false;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        size_t len = strlen(name) + 1;
+        if (listing->names_len + len > listing->names_cap) {
+            size_t cap = listing->names_cap ? listing->names_cap * 2 : 4096;
+            while (cap < listing->names_len + len) cap *= 2;
+            char* names = realloc(listing->names, cap);
+            if (names == NULL) break;
+            listing->names = names;
+            listing->names_cap = cap;
+        }
+        if (listing->count == listing->cap) {
+            size_t cap = listing->cap ? listing->cap * 2 : 64;
+            dir_entry_t* entries = realloc(listing->entries, cap * sizeof(dir_entry_t));
+            if (entries == NULL) break;
+            listing->entries = entries;
+            listing->cap = cap;
+        }
+
+        memcpy(listing->names + listing->names_len, name, len);
+        listing->entries[listing->count].name = listing->names_len;
+        listing->entries[listing->count].type = entry->d_type;
+        listing->names_len += len;
+        listing->count++;
+    }
+
+    closedir(dir);
+    return true;
+}
+
+void free_dir_listing(dir_listing_t* listing) {
+    free(listing->names);
+    free(listing->entries);
+    memset(listing, 0, sizeof(*listing));
+}
+
+// Check whether a pattern component has unescaped *, ? or [ characters
+static bool has_wildcards(const char* word) {
+    bool wild = false;
+    for (const char* p = word; *p; p++) {
+        if (*p == '\\' && p[1] != '\0') {
+            p++;
+        } else if (*p == '*' || *p == '?' || *p == '[') {
+            wild = true;
+        }
+    }
+    return wild;
+}
+
+// Parse a [...] class starting at p into the byte set; returns the position
+// after the closing ']' or NULL if the class is unterminated
+static const char* compile_class(const char* p, bool set[256]) {
+    const char* q = p + 1;
+    bool negate = false;
+    if (*q == '!' || *q == '^') {
+        negate = true;
+        q++;
+    }
+
+    memset(set, 0, 256 * sizeof(bool));
+    bool first = true;
+    while (*q && (*q != ']' || first)) {
+        unsigned char lo = (unsigned char)*q;
+        if (q[1] == '-' && q[2] != '\0' && q[2] != ']') {
+            unsigned char hi = (unsigned char)q[2];
+            for (int c = lo; c <= hi; c++) set[c] = true;
+            q += 3;
+        } else {
+            set[lo] = true;
+            q++;
+        }
+        first = false;
+    }
+
+    if (*q != ']') {
+        return NULL;
+    }
+
+    if (negate) {
+        for (int c = 0; c < 256; c++) set[c] = !set[c];
+    }
+    set['/'] = false;
+    return q + 1;
+}
+
+static void compile_matcher(const char* pattern, glob_matcher_t* m) {
+    memset(m, 0, sizeof(*m));
+    m->leading_dot = pattern[0] == '.';
+
+    int n = 0;
+    bool set[256];
+    const char* class_end;
+    for (const char* p = pattern; *p; ) {
+        if (n == MAX_GLOB_TOKENS) {
+            m->fallback = pattern;
+            return;
+        }
+
+        uint64_t bit = (uint64_t)1 << n;
+        if (*p == '*') {
+            // Consecutive stars behave like one
+            if (n == 0 || !(m->stars & (bit >> 1))) {
+                m->stars |= bit;
+                n++;
+            }
+            p++;
+        } else if (*p == '?') {
+            for (int c = 0; c < 256; c++) m->accepts[c] |= bit;
+            m->accepts['/'] &= ~bit;
+            n++;
+            p++;
+        } else if (*p == '[' && (class_end = compile_class(p, set)) != NULL) {
+            for (int c = 0; c < 256; c++) {
+                if (set[c]) m->accepts[c] |= bit;
+            }
+            n++;
+            p = class_end;
+        } else {
+            // Literal byte; an unterminated '[' is literal too
+            if (*p == '\\' && p[1] != '\0') p++;
+            m->accepts[(unsigned char)*p] |= bit;
+            n++;
+            p++;
+        }
+    }
+
+    m->final = (uint64_t)1 << n;
+}
+
+// Follow zero-length '*' transitions; stars are never adjacent after compiling
+static inline uint64_t glob_closure(const glob_matcher_t* m, uint64_t state) {
+    return state | ((state & m->stars) << 1);
+}
+
+static bool glob_match(const glob_matcher_t* m, const char* name) {
+    // Wildcards never match a leading '.'
+    if (name[0] == '.' && !m->leading_dot) {
+        return false;
+    }
+
+    if (m->fallback) {
+        return fnmatch(m->fallback, name, FNM_PERIOD) == 0;
+    }
+
+    uint64_t state = glob_closure(m, 1);
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        state = ((state & m->accepts[*p]) << 1) | (state & m->stars);
+        state = glob_closure(m, state);
+        if (state == 0) {
+            return false;
+        }
+    }
+    return (state & m->final) != 0;
+}
+
+static uint32_t hash_path(const char* path) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash;
+}
+
+// Return the listing of a directory, reading it at most once per expansion
+static const dir_listing_t* cached_listing(dir_cache_t* cache, const char* path) {
+    uint32_t bucket = hash_path(path) % DIR_CACHE_BUCKETS;
+    for (dir_cache_entry_t* e = cache->buckets[bucket]; e; e = e->next) {
+        if (strcmp(e->path, path) == 0) {
+            return e->ok ? &e->listing : NULL;
+        }
+    }
+
+    dir_cache_entry_t* e = malloc(sizeof(dir_cache_entry_t));
+    if (e == NULL) {
+        return NULL;
+    }
+    e->path = strdup(path);
+    e->ok = e->path != NULL && read_dir_listing(path, &e->listing);
+    e->next = cache->buckets[bucket];
+    cache->buckets[bucket] = e;
+    return e->ok ? &e->listing : NULL;
+}
+
+void free_dir_cache(dir_cache_t* cache) {
+    if (cache == NULL) {
+        return;
+    }
+    for (int i = 0; i < DIR_CACHE_BUCKETS; i++) {
+        dir_cache_entry_t* e = cache->buckets[i];
+        while (e) {
+            dir_cache_entry_t* next = e->next;
+            if (e->ok) free_dir_listing(&e->listing);
+            free(e->path);
+            free(e);
+            e = next;
+        }
+    }
+    free(cache);
+}
+
+// Append "/name" to the current path; returns the new length or 0 if too long
+static size_t join_path(glob_walk_t* w, size_t len, const char* name) {
+    size_t name_len = strlen(name);
+    bool slash = len > 0 && w->path[len - 1] != '/';
+    if (len + slash + name_len + 1 > sizeof(w->path)) {
+        return 0;
+    }
+    if (slash) w->path[len++] = '/';
+    memcpy(w->path + len, name, name_len + 1);
+    return len + name_len;
+}
+
+static bool entry_is_dir(glob_walk_t* w, unsigned char type, bool follow_links) {
+    if (type == DT_DIR) return true;
+    if (type != DT_UNKNOWN && (type != DT_LNK || !follow_links)) return false;
+
+    struct stat st;
+    int rc = follow_links ? stat(w->path, &st) : lstat(w->path, &st);
+    return rc == 0 && S_ISDIR(st.st_mode);
+}
+
+static void walk(glob_walk_t* w, size_t len, int comp, bool verified) {
+    w->path[len] = '\0';
+
+    if (comp == w->ncomps) {
+        struct stat st;
+        if (len > 0 && (verified || lstat(w->path, &st) == 0)) {
+            word_list_add(w->matches, w->path, len);
+        }
+        return;
+    }
+
+    if (w->kinds[comp] == COMP_LITERAL) {
+        size_t next = join_path(w, len, w->comps[comp]);
+        if (next > 0 || w->comps[comp][0] == '\0') {
+            walk(w, next > 0 ? next : len, comp + 1, false);
+        }
+        return;
+    }
+
+    bool last = comp == w->ncomps - 1;
+    if (w->kinds[comp] == COMP_GLOBSTAR && !last) {
+        // "**" may match no directories at all; that walk extends the path
+        walk(w, len, comp + 1, verified);
+        w->path[len] = '\0';
+    }
+
+    // Copy the directory path; the listing outlives changes to w->path
+    char dir_path[PATH_MAX];
+    memcpy(dir_path, len > 0 ? w->path : ".", len > 0 ? len + 1 : 2);
+    const dir_listing_t* listing = cached_listing(w->cache, dir_path);
+    if (listing == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < listing->count; i++) {
+        const char* name = LISTING_NAME(listing, i);
+        unsigned char type = listing->entries[i].type;
+
+        if (w->kinds[comp] == COMP_GLOBSTAR) {
+            if (name[0] == '.') continue;
+            size_t next = join_path(w, len, name);
+            if (next == 0) continue;
+            if (last) {
+                word_list_add(w->matches, w->path, next);
+            }
+            // Symlinks are not followed, so cycles cannot recurse forever
+            if (entry_is_dir(w, type, false)) {
+                walk(w, next, comp, true);
+            }
+        } else if (glob_match(&w->matchers[comp], name)) {
+            size_t next = join_path(w, len, name);
+            if (next == 0) continue;
+            if (last) {
+                word_list_add(w->matches, w->path, next);
+            } else if (entry_is_dir(w, type, true)) {
+                walk(w, next, comp + 1, true);
+            }
+        }
+    }
+}
+
+// Expand one pattern, appending its matches
+static void expand_pattern(const char* pattern, dir_cache_t* cache, word_list_t* matches) {
+    char* copy = strdup(pattern);
+    if (copy == NULL) return;
+
+    int max_comps = 1;
+    for (const char* p = pattern; *p; p++) {
+        if (*p == '/') max_comps++;
+    }
+
+    glob_walk_t* w = malloc(sizeof(glob_walk_t));
+    char** comps = malloc(max_comps * sizeof(char*));
+    comp_kind_t* kinds = malloc(max_comps * sizeof(comp_kind_t));
+    glob_matcher_t* matchers = malloc(max_comps * sizeof(glob_matcher_t));
+    if (w == NULL || comps == NULL || kinds == NULL || matchers == NULL) {
+        free(w); free(comps); free(kinds); free(matchers); free(copy);
+        return;
+    }
+
+    // Split into components; only those containing wildcards are compiled
+    char* p = copy;
+    size_t root_len = 0;
+    if (*p == '/') {
+        w->path[root_len++] = '/';
+        p++;
+    }
+
+    int n = 0;
+    while (1) {
+        char* slash = strchr(p, '/');
+        if (slash) *slash = '\0';
+
+        comps[n] = p;
+        if (strcmp(p, "**") == 0) {
+            kinds[n] = COMP_GLOBSTAR;
+        } else if (has_wildcards(p)) {
+            kinds[n] = COMP_GLOB;
+            compile_matcher(p, &matchers[n]);
+        } else {
+            kinds[n] = COMP_LITERAL;
+            // Drop escapes from literal components
+            char* out = p;
+            for (char* q = p; *q; q++) {
+                if (*q == '\\' && q[1] != '\0') q++;
+                *out++ = *q;
+            }
+            *out = '\0';
+        }
+        n++;
+
+        if (slash == NULL) break;
+        p = slash + 1;
+    }
+
+    w->comps = comps;
+    w->kinds = kinds;
+    w->matchers = matchers;
+    w->ncomps = n;
+    w->cache = cache;
+    w->matches = matches;
+    walk(w, root_len, 0, false);
+
+    free(w);
+    free(comps);
+    free(kinds);
+    free(matchers);
+    free(copy);
+}
+
+size_t glob_expand(const char* pattern, dir_cache_t** cache, word_list_t* list) {
+    if (*cache == NULL && (*cache = calloc(1, sizeof(dir_cache_t))) == NULL) {
+        return 0;
+    }
+
+    size_t first = list->count;
+    expand_pattern(pattern, *cache, list);
+    size_t count = list->count - first;
+    if (count < 2) {
+        return count;
+    }
+
+    char** paths = malloc(count * sizeof(char*));
+    if (paths == NULL) {
+        return count;
+    }
+    for (size_t i = 0; i < count; i++) {
+        paths[i] = list->text.data + list->offsets[first + i];
+    }
+
+    // Sort the new range and rewrite its offsets, dropping duplicates
+    sort_strings(paths, count);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (i == 0 || strcmp(paths[i], paths[i - 1]) != 0) {
+            list->offsets[first + kept++] = paths[i] - list->text.data;
+        }
+    }
+    list->count = first + kept;
+
+    free(paths);
+    return kept;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file
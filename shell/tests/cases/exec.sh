@@ -0,0 +1,14 @@
+# Scripts without a #! line run through /bin/sh, as execvp does
+printf 'echo script ran with $1\n' > plain.sh
+chmod +x plain.sh
+./plain.sh arg
+echo "status: $?"
+./plain.sh piped | cat
+mkdir bin
+cp plain.sh bin/plain-in-path
+PATH=$(pwd)/bin:$PATH
+plain-in-path found
+x=$(plain-in-path captured)
+echo $x
+./missing-command
+echo "missing: $?"
@@ -0,0 +1,14 @@
+sh -c 'exit 3'
+echo status $?
+x=$(echo sub; exit 6; echo no)
+echo $x $?
+leave() {
+  echo in function
+  exit 4
+  echo not reached
+}
+for i in 1 2; do
+  echo loop $i
+  if test $i = 2; then leave; fi
+done
+echo not reached
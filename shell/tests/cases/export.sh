@@ -0,0 +1,15 @@
+# export marks a name; an unset one reaches children only once assigned
+export SHELL_TEST_LATER
+env | grep -c '^SHELL_TEST_LATER'
+export | grep SHELL_TEST_LATER
+SHELL_TEST_LATER=now
+env | grep '^SHELL_TEST_LATER'
+SHELL_TEST_LOCAL=local
+env | grep -c '^SHELL_TEST_LOCAL'
+export SHELL_TEST_LOCAL
+env | grep '^SHELL_TEST_LOCAL'
+export SHELL_TEST_DROPPED
+unset SHELL_TEST_DROPPED
+SHELL_TEST_DROPPED=x
+env | grep -c '^SHELL_TEST_DROPPED'
+SHELL_TEST_PREFIX=prefix env | grep '^SHELL_TEST_PREFIX'
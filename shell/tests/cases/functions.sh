@@ -0,0 +1,42 @@
+greet() {
+    echo "hello $1, $# args"
+}
+greet world
+greet a b c
+function twice { "$@"; "$@"; }
+twice echo again
+fact() {
+    if [ $1 -le 1 ]; then
+        echo 1
+    else
+        echo $(( $1 * $(fact $(( $1 - 1 ))) ))
+    fi
+}
+fact 6
+check() {
+    if [ $1 -gt 10 ]; then echo big
+    elif [ $1 -gt 5 ]; then echo medium
+    else echo small
+    fi
+}
+check 20; check 7; check 1
+early() { echo before; return 3; echo after; }
+early
+echo "status $?"
+args() { for a in "$@"; do echo "[$a]"; done; }
+args 'x y' z ''
+echo "outside: $# args"
+redefine() { echo first; }
+redefine
+redefine() { echo second; }
+redefine
+true && echo and-ok
+false && echo not-shown
+false || echo or-ok
+true || echo not-shown
+n=0
+until [ $n -eq 3 ]; do n=$((n + 1)); done
+echo "until: $n"
+total=0
+for i in 1 2 3 4 5 6 7 8 9 10; do total=$((total + i)); done
+echo "sum: $total"
@@ -0,0 +1,18 @@
+mkdir -p src/a/b src/c logs
+touch main.c util.c util.h README .hidden.c src/x.c src/a/y.c src/a/b/z.c logs/1.log logs/2.log logs/10.log
+echo *.c
+echo util.?
+echo [mu]*.c
+echo [!m]*.c
+echo *.[ch]
+echo src/*.c src/*/*.c
+echo **/*.c
+echo logs/*.log
+echo *.none
+echo "*.c" '*.c' \*.c
+pat='*.h'
+echo $pat "$pat"
+echo .*.c
+for f in src/**/*.c; do echo file $f; done
+hop src
+echo ../*.h
@@ -0,0 +1,38 @@
+name=world
+cat <<EOF
+hello $name
+literal \$name
+EOF
+cat <<'EOF'
+quoted $name
+EOF
+cat <<-EOF
+	stripped $name
+	EOF
+show() {
+    cat <<EOF
+in function $1
+EOF
+}
+show one
+show two
+# Bodies of queued jobs must survive until the job starts
+sched -j 1
+cat <<EOF > first.txt &
+queued $name
+EOF
+cat <<EOF > second.txt &
+queued again
+EOF
+wait
+cat first.txt second.txt
+# Bodies stay out of the event log
+EVENTLOG=events.jsonl
+cat <<EOF > logged.txt &
+secret body
+EOF
+wait
+cat logged.txt
+# Events reach the file within a fraction of a second
+sleep 0.5
+grep -o '"command":"[^"]*logged.txt"' events.jsonl | sort -u
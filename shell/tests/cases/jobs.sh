@@ -0,0 +1,11 @@
+# With a limit of one the second job waits for the first to finish
+sched -j 1
+sh -c 'sleep 0.2; echo first > first.txt' &
+sh -c 'cat first.txt; echo second' > second.txt &
+sched
+wait
+cat second.txt
+sched -j 0
+sh -c 'echo unlimited' > third.txt &
+wait
+cat third.txt
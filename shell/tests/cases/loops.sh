@@ -0,0 +1,25 @@
+# A loop exits with the status of the last body command it ran, or 0
+for i in 1 2; do false; done
+echo "for, body failed: $?"
+false
+for i in; do false; done
+echo "for, no iterations: $?"
+n=0
+while [ $n -lt 2 ]; do n=$((n + 1)); false; done
+echo "while, body failed: $?"
+false
+while false; do true; done
+echo "while, no iterations: $?"
+n=0
+until [ $n -ge 2 ]; do n=$((n + 1)); sh -c 'exit 5'; done
+echo "until, body status 5: $?"
+for i in 1 2; do false; break; done
+echo "break: $?"
+n=0
+while [ $n -lt 2 ]; do n=$((n + 1)); false; continue; done
+echo "continue: $?"
+for i in a b; do for j in 1 2; do echo $i$j; break 2; done; done
+for i in a b c; do
+    if [ $i = b ]; then continue; fi
+    echo "visited $i"
+done
@@ -0,0 +1,6 @@
+parallel -X -j1 echo {} ::: a b c
+parallel -X -j1 echo x{} ::: a b c
+parallel -X -j1 echo {} y{}z ::: a b c
+parallel -X -j1 echo pre ::: a b c
+parallel -j1 echo x{} ::: a b c
+printf 'p\nq\n' | parallel -X -j1 echo in:{}
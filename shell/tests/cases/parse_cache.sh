@@ -0,0 +1,19 @@
+stats reset
+x=1
+echo value $x
+x=2
+echo value $x
+mkdir d
+hop d
+echo *
+touch f
+echo *
+hop ..
+echo value $x | tr a-z A-Z
+x=3
+echo value $x | tr a-z A-Z
+show() { echo called $1; }
+show one
+show two
+show one
+stats | grep -E '^ *(lex|parse):'
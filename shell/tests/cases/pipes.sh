@@ -0,0 +1,15 @@
+printf 'a\nb\n' > f
+while read x; do echo line $x; done < f
+echo hi | while read y; do echo got $y; done
+for i in 3 1 2; do echo $i; done | sort
+{ echo a; echo b; } > out
+cat out
+if true; then echo x; fi | cat
+while read x
+do
+  echo multi $x
+done < f | sort -r
+for j in x y; do while read n; do echo $j$n; done < f; done
+while read n; do false; done < f; echo status $?
+read first rest < out; echo $first
+echo '  p  q  r  ' | { read a b; echo "[$a][$b]"; }
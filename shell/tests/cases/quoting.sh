@@ -0,0 +1,14 @@
+echo 'single  quoted' "double  quoted" plain\ escaped
+echo 'a;b|c&d>e<f' "g;h|i&j"
+echo adj'ac'"ent"\!words
+echo "it's" 'say "hi"' "back\\slash" 'back\slash'
+echo a|cat
+echo b>out; cat<out
+echo c;echo d
+echo "$HOME" | grep -c /
+echo ''  ""  x
+echo "tab	inside" 'tab	inside'
+printf '%s\n' one\ two "three four"
+echo "escaped \"quote\" and \$dollar"
+echo xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"quote spanning yyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyyy chunk" xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx'a|b;c'
+echo 'w0' 'w1' 'w2' 'w3' 'w4' 'w5' 'w6' 'w7' 'w8' 'w9' 'w10' 'w11' 'w12' 'w13' 'w14' 'w15' 'w16' 'w17' 'w18' 'w19' 'w20' 'w21' 'w22' 'w23' 'w24' 'w25' 'w26' 'w27' 'w28' 'w29'
@@ -0,0 +1,19 @@
+shell_bin=$(readlink /proc/$$/exe)
+# Show where the rc file was loaded from and the command's output
+start() {
+    HOME=$PWD sh -c '"$0" --startup-time -c "$1" 2>&1' $shell_bin "$1" > out.txt
+    grep -o 'load .*(\(compiled\|snapshot\|failed\)' out.txt | grep -o '[a-z]*$'
+    grep -v '^startup\|^  [a-z]' out.txt | sed 's|^/.*/\.shellrc:|~/.shellrc:|'
+}
+printf 'greet() { echo "hello from rc $1"; }\nRC_VALUE=first\n' > .shellrc
+start 'greet one; echo $RC_VALUE'
+test -s .shellrc.snap && echo snapshot written
+start 'greet two; echo $RC_VALUE'
+printf 'greet() { echo "changed rc $1"; }\nRC_VALUE=second\n' > .shellrc
+start 'greet three; echo $RC_VALUE'
+start 'greet four; echo $RC_VALUE'
+# A damaged snapshot is recompiled, not trusted
+printf 'garbage' > .shellrc.snap
+start 'greet five'
+printf 'broken() {\n' > .shellrc
+start 'echo still runs'
@@ -0,0 +1,13 @@
+shell_bin=$(readlink /proc/$$/exe)
+printf 'echo one\nx=5\necho value $x\nfalse\nmkdir sub\nhop sub\npwd | grep -o sub$\n' > session.txt
+$shell_bin --record session.rec < session.txt > recorded.txt
+test -s session.rec && echo recorded
+cat recorded.txt
+# mkdir fails on replay since sub exists now, so its status and output differ
+$shell_bin --replay session.rec > replay.txt
+echo "replay status $?"
+grep -v '^ *[0-9]* ' replay.txt | grep -v 'commands: recorded'
+grep -o '[0-9>]* *\(same\|differs\) .*' replay.txt
+grep -o '[0-9]* outputs.*' replay.txt
+$shell_bin --replay session.rec --quiet > quiet.txt
+grep -c '^one$\|^value 5$' quiet.txt
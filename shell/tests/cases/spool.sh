@@ -0,0 +1,16 @@
+sched -o 64K
+sh -c 'for i in 1 2 3 4 5; do echo line $i; done; sleep 0.5; echo late' &
+sleep 0.3
+peek -n 3
+activities | grep -o 'spooled [0-9.]*[KMB]*'
+fg
+echo after fg
+sh -c 'i=0; while [ $i -lt 5000 ]; do echo filler line $i; i=$((i+1)); done; sleep 1' &
+sleep 0.6
+peek -n 2
+activities | grep -o 'spooled [0-9.]*[KMB]* (dropped [0-9.]*[KMB]*)'
+wait
+sched -o 0
+sleep 0.2 &
+peek
+wait
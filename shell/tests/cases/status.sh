@@ -0,0 +1,23 @@
+false
+echo "false: $?"
+true
+echo "true: $?"
+x=$(false)
+echo "x=\$(false): $?"
+y=$(sh -c 'exit 3')
+echo "y=\$(exit 3): $?"
+z=$(echo value)
+echo "z=\$(echo value): $? $z"
+a=$(false) b=$(echo b)
+echo "last substitution wins: $? $b"
+false
+c=plain
+echo "plain assignment: $?"
+echo $(false) > /dev/null
+echo "command after substitution: $?"
+x=$(false) && echo and || echo or
+sh -c 'exit 7' | true
+echo "pipeline: $?"
+f() { return 4; }
+f
+echo "function: $?"
@@ -0,0 +1,10 @@
+timeout 0.2 sleep 5 2> /dev/null
+echo timed out $?
+timeout 5 sh -c 'exit 3'
+echo finished $?
+timeout -g 0.2 0.1 sleep 5 2> /dev/null
+echo killed $?
+limit -T 1 sleep 5 &
+activities -w 100 -n 20 > frames
+test $(grep -c 'sleep 5$' frames) -lt 15 && echo deadline ran during the watch
+activities
@@ -0,0 +1,15 @@
+sched -j 1
+sleep 0.2 &
+sh -c 'sleep 0.1; exit 3' &
+wait --timeout 5 2
+echo queued job $?
+sh -c 'exit 5' &
+sh -c 'sleep 0.1; exit 7' &
+wait
+echo all $?
+sched -j 0
+sleep 1 &
+wait --timeout 0.2
+echo timeout $?
+wait 99
+echo missing $?
@@ -0,0 +1,106 @@
+#!/bin/sh
+# Behavioural tests: run.sh SHELL CLIENT
+#
+# Every cases/NAME.sh is run by the shell twice, as a script file and as
+# the text of -c, in a scratch directory; both outputs must match
+# cases/NAME.out. Job notices like "[1] 1234" carry pids and are dropped.
+# A cases/NAME.status file holds the exit code the -c run must return.
+# The serve test then checks that hanging up and stopping the server end
+# every job a request started.
+
+shell=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+client=$(cd "$(dirname "$2")" && pwd)/$(basename "$2")
+cases=$(cd "$(dirname "$0")" && pwd)/cases
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+failed=0
+passed=0
+
+pass() {
+    passed=$((passed + 1))
+    echo "PASS $1"
+}
+
+fail() {
+    failed=$((failed + 1))
+    echo "FAIL $1"
+}
+
+# Run a case in an empty directory; mode is "file" or "-c"
+run_case() {
+    rm -rf "$scratch/work"
+    mkdir "$scratch/work"
+    if [ "$2" = file ]; then
+        (cd "$scratch/work" && "$shell" "$1" 2>&1)
+    else
+        (cd "$scratch/work" && "$shell" -c "$(cat "$1")" 2>&1)
+    fi | grep -Ev '^\[[0-9]+\] ([0-9]+|queued)$'
+}
+
+for script in "$cases"/*.sh; do
+    name=$(basename "$script" .sh)
+    for mode in file -c; do
+        run_case "$script" "$mode" > "$scratch/actual"
+        if diff -u "$cases/$name.out" "$scratch/actual"; then
+            pass "$name ($mode)"
+        else
+            fail "$name ($mode)"
+        fi
+    done
+done
+
+# A case's exit code is the status of its last command, or of exit
+for script in "$cases"/*.sh; do
+    name=$(basename "$script" .sh)
+    [ -f "$cases/$name.status" ] || continue
+    rm -rf "$scratch/work"
+    mkdir "$scratch/work"
+    (cd "$scratch/work" && "$shell" -c "$(cat "$script")" > /dev/null 2>&1)
+    actual=$?
+    if [ "$actual" = "$(cat "$cases/$name.status")" ]; then
+        pass "$name (status)"
+    else
+        fail "$name (status $actual)"
+    fi
+done
+
+# Count the processes running exactly "sleep SECONDS"
+sleepers() {
+    ps -eo args | grep -c "^sleep $1\$"
+}
+
+serve_test() {
+    sock="$scratch/sock"
+    "$shell" --serve "$sock" > "$scratch/serve.log" 2>&1 &
+    server=$!
+    tries=0
+    while [ ! -S "$sock" ] && [ $tries -lt 50 ]; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+
+    out=$("$client" "$sock" 'echo served')
+    if [ "$out" = served ]; then pass "serve request"; else fail "serve request"; fi
+
+    # A client that hangs up takes the request's jobs with it
+    timeout 1 "$client" "$sock" 'sleep 91 & sleep 92' > /dev/null 2>&1
+    sleep 0.5
+    if [ "$(sleepers '9[12]')" -eq 0 ]; then pass "serve hangup"; else fail "serve hangup"; fi
+
+    out=$(timeout 5 "$client" "$sock" 'echo still serving')
+    if [ "$out" = "still serving" ]; then pass "serve after hangup"; else fail "serve after hangup"; fi
+
+    # So does stopping the server while a request runs
+    "$client" "$sock" 'sleep 93 & sleep 94' > /dev/null 2>&1 &
+    sleep 0.5
+    kill "$server"
+    wait "$server"
+    sleep 0.2
+    if [ "$(sleepers '9[34]')" -eq 0 ]; then pass "serve stop"; else fail "serve stop"; fi
+    wait
+}
+
+serve_test
+
+echo "$passed passed, $failed failed"
+[ $failed -eq 0 ]
@@ -0,0 +1,157 @@
+#define _GNU_SOURCE
+#include "serve.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+// ############## LLM Generated Code Begins ##############
+// Client of shell.out --serve: runs one request and exits with its status.
+//
+//   shell_client.out SOCKET COMMAND...   run the words joined by spaces
+//   shell_client.out SOCKET              run all of stdin as one script
+//
+// The request runs in the client's working directory; its stdout and
+// stderr are copied to ours as they arrive.
+
+static bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool read_all(int fd, char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, data, len);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool send_frame(int fd, char type, const char* data, size_t len) {
+    char header[SERVE_HEADER_SIZE] = {type, (char)(len >> 24), (char)(len >> 16),
+                                      (char)(len >> 8), (char)len};
+    return write_all(fd, header, sizeof(header)) && write_all(fd, data, len);
+}
+
+// The script from stdin, or the command words joined by spaces
+static char* request_text(int argc, char** argv, size_t* len) {
+    size_t cap = 4096;
+    char* text = malloc(cap);
+    *len = 0;
+    if (text == NULL) {
+        return NULL;
+    }
+    if (argc > 2) {
+        for (int i = 2; i < argc; i++) {
+            size_t word = strlen(argv[i]);
+            while (*len + word + 2 > cap) {
+                char* grown = realloc(text, cap *= 2);
+                if (grown == NULL) {
+                    free(text);
+                    return NULL;
+                }
+                text = grown;
+            }
+            if (i > 2) text[(*len)++] = ' ';
+            memcpy(text + *len, argv[i], word);
+            *len += word;
+        }
+        return text;
+    }
+    ssize_t n;
+    while ((n = read(STDIN_FILENO, text + *len, cap - *len)) > 0) {
+        *len += n;
+        if (*len == cap) {
+            char* grown = realloc(text, cap *= 2);
+            if (grown == NULL) {
+                free(text);
+                return NULL;
+            }
+            text = grown;
+        }
+    }
+    return text;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s SOCKET [COMMAND...]\n", argv[0]);
+        return 2;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", argv[0]);
+        return 2;
+    }
+    strcpy(addr.sun_path, argv[1]);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        fprintf(stderr, "%s: %s: %s\n", argv[0], argv[1], strerror(errno));
+        return 2;
+    }
+
+    size_t len;
+    char* text = request_text(argc, argv, &len);
+    char cwd[PATH_MAX];
+    if (text == NULL || len > SERVE_MAX_PAYLOAD) {
+        fprintf(stderr, "%s: request too large\n", argv[0]);
+        return 2;
+    }
+    if ((getcwd(cwd, sizeof(cwd)) != NULL && !send_frame(fd, SERVE_CWD, cwd, strlen(cwd))) ||
+        !send_frame(fd, SERVE_RUN, text, len)) {
+        fprintf(stderr, "%s: send failed: %s\n", argv[0], strerror(errno));
+        return 2;
+    }
+    free(text);
+
+    // Copy output frames until the exit status arrives
+    char* payload = malloc(SERVE_MAX_PAYLOAD);
+    unsigned char header[SERVE_HEADER_SIZE];
+    while (payload != NULL && read_all(fd, (char*)header, sizeof(header))) {
+        uint32_t size = (uint32_t)header[1] << 24 | (uint32_t)header[2] << 16 |
+                        (uint32_t)header[3] << 8 | header[4];
+        if (size > SERVE_MAX_PAYLOAD || !read_all(fd, payload, size)) {
+            break;
+        }
+        if (header[0] == SERVE_STDOUT) {
+            write_all(STDOUT_FILENO, payload, size);
+        } else if (header[0] == SERVE_STDERR) {
+            write_all(STDERR_FILENO, payload, size);
+        } else if (header[0] == SERVE_EXIT && size == 4) {
+            const unsigned char* code = (const unsigned char*)payload;
+            int status = (int)((uint32_t)code[0] << 24 | (uint32_t)code[1] << 16 |
+                               (uint32_t)code[2] << 8 | code[3]);
+            free(payload);
+            close(fd);
+            return status;
+        }
+    }
+    fprintf(stderr, "%s: connection lost\n", argv[0]);
+    free(payload);
+    return 2;
+}
+// ############## LLM Generated Code Ends ################
\ No newline at end of file